@@ -0,0 +1,160 @@
+/*
+ * fmcs.c -- Compare Fmcs against Fmutex and pthread_mutex_t for throughput and fairness under contention
+ * Usage: bench_fmcs [largest number of threads], defaults to 128.
+ * Runs with 8 threads and doubles up to the largest number of threads.
+ * Fairness is Jain's index over how often each thread got the lock, 1.0 meaning every thread got it equally often.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <fmcs.h>
+#include <fmutex.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define BENCH_FMCS_MILLISECONDS (200)
+
+enum bench_fmcs_kind {
+    BENCH_FMCS_FMCS,
+    BENCH_FMCS_FMUTEX,
+    BENCH_FMCS_PTHREAD
+};
+
+struct bench_fmcs_count {
+    uint64_t acquired;
+} __attribute__((aligned(64)));
+
+struct bench_fmcs_shared {
+    enum bench_fmcs_kind kind;
+    Fmcs *fmcs;
+    Fmutex *fmutex;
+    pthread_mutex_t pmutex;
+    // threads only start counting once every one of them exists
+    _Atomic bool go;
+    _Atomic bool stop;
+    uint64_t counter;
+};
+
+struct bench_fmcs_arg {
+    struct bench_fmcs_shared *shared;
+    struct bench_fmcs_count *count;
+};
+
+uint64_t bench_fmcs_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void *bench_fmcs_worker(void *varg) {
+    struct bench_fmcs_arg *arg = varg;
+    struct bench_fmcs_shared *shared = arg->shared;
+    Fmcs_node node;
+
+    while(!atomic_load_explicit(&(shared->go), memory_order_acquire)) {
+        usleep(100);
+    }
+    while(!atomic_load_explicit(&(shared->stop), memory_order_relaxed)) {
+        switch(shared->kind) {
+        case BENCH_FMCS_FMCS:
+            assert(fmcs_lock(shared->fmcs, &node) == 0);
+            shared->counter++;
+            assert(fmcs_unlock(shared->fmcs, &node) == 0);
+            break;
+        case BENCH_FMCS_FMUTEX:
+            assert(fmutex_lock(shared->fmutex) == 0);
+            shared->counter++;
+            assert(fmutex_unlock(shared->fmutex) == 0);
+            break;
+        case BENCH_FMCS_PTHREAD:
+            assert(pthread_mutex_lock(&(shared->pmutex)) == 0);
+            shared->counter++;
+            assert(pthread_mutex_unlock(&(shared->pmutex)) == 0);
+            break;
+        }
+        arg->count->acquired++;
+    }
+
+    return NULL;
+}
+
+void bench_fmcs_run(const char *name, enum bench_fmcs_kind kind, size_t num_threads) {
+    struct bench_fmcs_shared shared;
+    struct bench_fmcs_count *counts;
+    struct bench_fmcs_arg args[num_threads];
+    pthread_t threads[num_threads];
+    uint64_t start, elapsed, total = 0, min = UINT64_MAX, max = 0;
+    double sum_squares = 0;
+
+    counts = aligned_alloc(64, num_threads * sizeof(struct bench_fmcs_count));
+    assert(counts != NULL);
+    shared.kind = kind;
+    shared.fmcs = fmcs_create();
+    shared.fmutex = fmutex_create();
+    assert(shared.fmcs != NULL && shared.fmutex != NULL);
+    assert(pthread_mutex_init(&(shared.pmutex), NULL) == 0);
+    atomic_store(&(shared.go), false);
+    atomic_store(&(shared.stop), false);
+    shared.counter = 0;
+
+    for(size_t i = 0; i < num_threads; i++) {
+        counts[i].acquired = 0;
+        args[i].shared = &shared;
+        args[i].count = &(counts[i]);
+        assert(pthread_create(&(threads[i]), NULL, bench_fmcs_worker, &(args[i])) == 0);
+    }
+    start = bench_fmcs_now();
+    atomic_store(&(shared.go), true);
+    usleep(BENCH_FMCS_MILLISECONDS * 1000);
+    atomic_store(&(shared.stop), true);
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+    elapsed = bench_fmcs_now() - start;
+
+    for(size_t i = 0; i < num_threads; i++) {
+        total += counts[i].acquired;
+        sum_squares += ((double) counts[i].acquired) * counts[i].acquired;
+        min = counts[i].acquired < min ? counts[i].acquired : min;
+        max = counts[i].acquired > max ? counts[i].acquired : max;
+    }
+    assert(total == shared.counter);
+
+    printf("%-16s %8zu %14.0f %10.3f %12lu %12lu\n", name, num_threads, total / (elapsed / 1000000000.0),
+           sum_squares == 0 ? 0 : (((double) total) * total) / (num_threads * sum_squares), min, max);
+    fmcs_destroy(shared.fmcs);
+    fmutex_destroy(shared.fmutex);
+    pthread_mutex_destroy(&(shared.pmutex));
+    free(counts);
+}
+
+int main(int argc, char **argv) {
+    size_t max_threads = 128;
+
+    if(argc > 1) {
+        max_threads = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(max_threads < 8) {
+        max_threads = 8;
+    }
+
+    printf("every thread increments a shared counter under the lock for %i ms\n", BENCH_FMCS_MILLISECONDS);
+    printf("%-16s %8s %14s %10s %12s %12s\n", "lock", "threads", "locks per s", "fairness", "fewest", "most");
+    for(size_t num_threads = 8; num_threads <= max_threads; num_threads *= 2) {
+        bench_fmcs_run("Fmcs", BENCH_FMCS_FMCS, num_threads);
+        bench_fmcs_run("Fmutex", BENCH_FMCS_FMUTEX, num_threads);
+        bench_fmcs_run("pthread_mutex_t", BENCH_FMCS_PTHREAD, num_threads);
+    }
+    return 0;
+}
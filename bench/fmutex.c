@@ -0,0 +1,99 @@
+/*
+ * fmutex.c -- Compare Fmutex against pthread_mutex_t for short critical sections
+ * Usage: bench_fmutex [number of threads], defaults to 4.
+ * Every run is repeated with a single thread to show the cost of locking without contention.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <fmutex.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#define BENCH_FMUTEX_OPERATIONS (1000000)
+
+struct bench_fmutex_shared {
+    bool use_fmutex;
+    Fmutex *fmutex;
+    pthread_mutex_t pmutex;
+    uint64_t counter;
+};
+
+uint64_t bench_fmutex_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void *bench_fmutex_worker(void *arg) {
+    struct bench_fmutex_shared *shared = arg;
+
+    for(size_t i = 0; i < BENCH_FMUTEX_OPERATIONS; i++) {
+        if(shared->use_fmutex) {
+            assert(fmutex_lock(shared->fmutex) == 0);
+            shared->counter++;
+            assert(fmutex_unlock(shared->fmutex) == 0);
+        } else {
+            assert(pthread_mutex_lock(&(shared->pmutex)) == 0);
+            shared->counter++;
+            assert(pthread_mutex_unlock(&(shared->pmutex)) == 0);
+        }
+    }
+
+    return NULL;
+}
+
+void bench_fmutex_run(const char *name, bool use_fmutex, size_t num_threads) {
+    struct bench_fmutex_shared shared;
+    pthread_t threads[num_threads];
+    uint64_t start, elapsed;
+
+    shared.use_fmutex = use_fmutex;
+    shared.fmutex = fmutex_create();
+    assert(shared.fmutex != NULL);
+    assert(pthread_mutex_init(&(shared.pmutex), NULL) == 0);
+    shared.counter = 0;
+
+    start = bench_fmutex_now();
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_create(&(threads[i]), NULL, bench_fmutex_worker, &shared) == 0);
+    }
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+    elapsed = bench_fmutex_now() - start;
+    assert(shared.counter == num_threads * BENCH_FMUTEX_OPERATIONS);
+
+    printf("%-16s %8zu %12.3f %12.2f\n", name, num_threads, elapsed / 1000000.0,
+           ((double) elapsed) / (num_threads * BENCH_FMUTEX_OPERATIONS));
+    fmutex_destroy(shared.fmutex);
+    pthread_mutex_destroy(&(shared.pmutex));
+}
+
+int main(int argc, char **argv) {
+    size_t num_threads = 4;
+
+    if(argc > 1) {
+        num_threads = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(num_threads == 0) {
+        num_threads = 1;
+    }
+
+    printf("%i lock and unlock pairs per thread around an increment\n", BENCH_FMUTEX_OPERATIONS);
+    printf("%-16s %8s %12s %12s\n", "mutex", "threads", "total (ms)", "ns per op");
+    bench_fmutex_run("Fmutex", true, 1);
+    bench_fmutex_run("pthread_mutex_t", false, 1);
+    bench_fmutex_run("Fmutex", true, num_threads);
+    bench_fmutex_run("pthread_mutex_t", false, num_threads);
+    return 0;
+}
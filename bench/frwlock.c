@@ -0,0 +1,137 @@
+/*
+ * frwlock.c -- Compare Frwlock against pthread_rwlock_t at several read ratios
+ * Usage: bench_frwlock [number of threads], defaults to 4.
+ * Readers sum a small struct, writers increment every field of it.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <frwlock.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#define BENCH_FRWLOCK_OPERATIONS (500000)
+#define BENCH_FRWLOCK_FIELDS (8)
+
+enum bench_frwlock_kind {
+    BENCH_FRWLOCK_PREFER_READER,
+    BENCH_FRWLOCK_PREFER_WRITER,
+    BENCH_FRWLOCK_PTHREAD
+};
+
+struct bench_frwlock_shared {
+    enum bench_frwlock_kind kind;
+    Frwlock *frwlock;
+    pthread_rwlock_t prwlock;
+    // out of every 1000 operations, how many are reads
+    unsigned reads_per_1000;
+    uint64_t fields[BENCH_FRWLOCK_FIELDS];
+};
+
+uint64_t bench_frwlock_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void *bench_frwlock_worker(void *arg) {
+    struct bench_frwlock_shared *shared = arg;
+    // xorshift so the ratio is random without contending on rand
+    uint64_t random = (uint64_t) (uintptr_t) &random | 1;
+    volatile uint64_t sum = 0;
+
+    for(size_t i = 0; i < BENCH_FRWLOCK_OPERATIONS; i++) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        bool read = (random % 1000) < shared->reads_per_1000;
+
+        if(read) {
+            if(shared->kind == BENCH_FRWLOCK_PTHREAD) {
+                assert(pthread_rwlock_rdlock(&(shared->prwlock)) == 0);
+            } else {
+                assert(frwlock_read_lock(shared->frwlock) == 0);
+            }
+            for(size_t j = 0; j < BENCH_FRWLOCK_FIELDS; j++) {
+                sum += shared->fields[j];
+            }
+            if(shared->kind == BENCH_FRWLOCK_PTHREAD) {
+                assert(pthread_rwlock_unlock(&(shared->prwlock)) == 0);
+            } else {
+                assert(frwlock_read_unlock(shared->frwlock) == 0);
+            }
+        } else {
+            if(shared->kind == BENCH_FRWLOCK_PTHREAD) {
+                assert(pthread_rwlock_wrlock(&(shared->prwlock)) == 0);
+            } else {
+                assert(frwlock_write_lock(shared->frwlock) == 0);
+            }
+            for(size_t j = 0; j < BENCH_FRWLOCK_FIELDS; j++) {
+                shared->fields[j]++;
+            }
+            if(shared->kind == BENCH_FRWLOCK_PTHREAD) {
+                assert(pthread_rwlock_unlock(&(shared->prwlock)) == 0);
+            } else {
+                assert(frwlock_write_unlock(shared->frwlock) == 0);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void bench_frwlock_run(const char *name, enum bench_frwlock_kind kind, unsigned reads_per_1000, size_t num_threads) {
+    struct bench_frwlock_shared shared = { 0 };
+    pthread_t threads[num_threads];
+    uint64_t start, elapsed;
+
+    shared.kind = kind;
+    shared.reads_per_1000 = reads_per_1000;
+    shared.frwlock = frwlock_create(kind == BENCH_FRWLOCK_PREFER_WRITER ? FRWLOCK_KIND_PREFER_WRITER : FRWLOCK_KIND_PREFER_READER);
+    assert(shared.frwlock != NULL);
+    assert(pthread_rwlock_init(&(shared.prwlock), NULL) == 0);
+
+    start = bench_frwlock_now();
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_create(&(threads[i]), NULL, bench_frwlock_worker, &shared) == 0);
+    }
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+    elapsed = bench_frwlock_now() - start;
+
+    printf("%-18s %8.1f%% %12.3f %12.2f\n", name, reads_per_1000 / 10.0, elapsed / 1000000.0,
+           ((double) elapsed) / (num_threads * BENCH_FRWLOCK_OPERATIONS));
+    frwlock_destroy(shared.frwlock);
+    pthread_rwlock_destroy(&(shared.prwlock));
+}
+
+int main(int argc, char **argv) {
+    unsigned ratios[] = { 500, 900, 990, 1000 };
+    size_t num_threads = 4;
+
+    if(argc > 1) {
+        num_threads = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(num_threads == 0) {
+        num_threads = 1;
+    }
+
+    printf("%zu threads, %i operations each\n", num_threads, BENCH_FRWLOCK_OPERATIONS);
+    printf("%-18s %9s %12s %12s\n", "lock", "reads", "total (ms)", "ns per op");
+    for(size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++) {
+        bench_frwlock_run("Frwlock reader", BENCH_FRWLOCK_PREFER_READER, ratios[i], num_threads);
+        bench_frwlock_run("Frwlock writer", BENCH_FRWLOCK_PREFER_WRITER, ratios[i], num_threads);
+        bench_frwlock_run("pthread_rwlock_t", BENCH_FRWLOCK_PTHREAD, ratios[i], num_threads);
+    }
+    return 0;
+}
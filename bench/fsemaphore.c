@@ -0,0 +1,137 @@
+/*
+ * fsemaphore.c -- Compare Fsemaphore against sem_t for producer/consumer handoffs
+ * Usage: bench_fsemaphore [number of producer and consumer pairs], defaults to 2.
+ * Every run is repeated with a single thread posting and waiting to show the cost without contention.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <fsemaphore.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#define BENCH_FSEMAPHORE_OPERATIONS (1000000)
+// same ceiling as sem_t so neither side waits on a full semaphore
+#define BENCH_FSEMAPHORE_MAX (SEM_VALUE_MAX)
+
+struct bench_fsemaphore_shared {
+    bool use_fsemaphore;
+    Fsemaphore *fsemaphore;
+    sem_t psem;
+};
+
+uint64_t bench_fsemaphore_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void bench_fsemaphore_post(struct bench_fsemaphore_shared *shared) {
+    if(shared->use_fsemaphore) {
+        // full, let the consumers catch up
+        while(fsemaphore_post(shared->fsemaphore) == EDEADLK) {
+            sched_yield();
+        }
+    } else {
+        assert(sem_post(&(shared->psem)) == 0);
+    }
+}
+
+void bench_fsemaphore_wait(struct bench_fsemaphore_shared *shared) {
+    if(shared->use_fsemaphore) {
+        assert(fsemaphore_wait(shared->fsemaphore) == 0);
+    } else {
+        assert(sem_wait(&(shared->psem)) == 0);
+    }
+}
+
+void *bench_fsemaphore_producer(void *arg) {
+    for(size_t i = 0; i < BENCH_FSEMAPHORE_OPERATIONS; i++) {
+        bench_fsemaphore_post(arg);
+    }
+
+    return NULL;
+}
+
+void *bench_fsemaphore_consumer(void *arg) {
+    for(size_t i = 0; i < BENCH_FSEMAPHORE_OPERATIONS; i++) {
+        bench_fsemaphore_wait(arg);
+    }
+
+    return NULL;
+}
+
+void *bench_fsemaphore_alone(void *arg) {
+    for(size_t i = 0; i < BENCH_FSEMAPHORE_OPERATIONS; i++) {
+        bench_fsemaphore_post(arg);
+        bench_fsemaphore_wait(arg);
+    }
+
+    return NULL;
+}
+
+void bench_fsemaphore_run(const char *name, bool use_fsemaphore, size_t num_pairs) {
+    struct bench_fsemaphore_shared shared;
+    pthread_t threads[(2 * num_pairs) + 1];
+    size_t num_threads;
+    uint64_t start, elapsed;
+
+    shared.use_fsemaphore = use_fsemaphore;
+    shared.fsemaphore = fsemaphore_create(0, BENCH_FSEMAPHORE_MAX);
+    assert(shared.fsemaphore != NULL);
+    assert(sem_init(&(shared.psem), 0, 0) == 0);
+
+    start = bench_fsemaphore_now();
+    if(num_pairs == 0) {
+        num_threads = 1;
+        assert(pthread_create(&(threads[0]), NULL, bench_fsemaphore_alone, &shared) == 0);
+    } else {
+        num_threads = 2 * num_pairs;
+        for(size_t i = 0; i < num_pairs; i++) {
+            assert(pthread_create(&(threads[2 * i]), NULL, bench_fsemaphore_producer, &shared) == 0);
+            assert(pthread_create(&(threads[(2 * i) + 1]), NULL, bench_fsemaphore_consumer, &shared) == 0);
+        }
+    }
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+    elapsed = bench_fsemaphore_now() - start;
+    assert(atomic_load(&(shared.fsemaphore->counter)) == 0);
+
+    printf("%-12s %8zu %12.3f %12.2f\n", name, num_threads, elapsed / 1000000.0,
+           ((double) elapsed) / ((num_pairs == 0 ? 1 : num_pairs) * BENCH_FSEMAPHORE_OPERATIONS));
+    fsemaphore_destroy(shared.fsemaphore);
+    sem_destroy(&(shared.psem));
+}
+
+int main(int argc, char **argv) {
+    size_t num_pairs = 2;
+
+    if(argc > 1) {
+        num_pairs = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(num_pairs == 0) {
+        num_pairs = 1;
+    }
+
+    printf("%i posts and waits per producer and consumer pair\n", BENCH_FSEMAPHORE_OPERATIONS);
+    printf("%-12s %8s %12s %12s\n", "semaphore", "threads", "total (ms)", "ns per pair");
+    bench_fsemaphore_run("Fsemaphore", true, 0);
+    bench_fsemaphore_run("sem_t", false, 0);
+    bench_fsemaphore_run("Fsemaphore", true, num_pairs);
+    bench_fsemaphore_run("sem_t", false, num_pairs);
+    return 0;
+}
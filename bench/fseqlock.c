@@ -0,0 +1,170 @@
+/*
+ * fseqlock.c -- Compare Fseqlock against Frwlock and pthread_rwlock_t for publishing a small struct
+ * Usage: bench_fseqlock [number of threads], defaults to 4.
+ * Readers copy out and sum a small struct, writers increment every field of it.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <fseqlock.h>
+#include <frwlock.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#define BENCH_FSEQLOCK_OPERATIONS (500000)
+#define BENCH_FSEQLOCK_FIELDS (8)
+
+enum bench_fseqlock_kind {
+    BENCH_FSEQLOCK_FSEQLOCK,
+    BENCH_FSEQLOCK_FRWLOCK,
+    BENCH_FSEQLOCK_PTHREAD
+};
+
+struct bench_fseqlock_shared {
+    enum bench_fseqlock_kind kind;
+    Fseqlock *fseqlock;
+    Frwlock *frwlock;
+    pthread_rwlock_t prwlock;
+    // out of every 1000 operations, how many are reads
+    unsigned reads_per_1000;
+    uint64_t fields[BENCH_FSEQLOCK_FIELDS];
+};
+
+uint64_t bench_fseqlock_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void bench_fseqlock_read(struct bench_fseqlock_shared *shared, uint64_t *dest) {
+    switch(shared->kind) {
+    case BENCH_FSEQLOCK_FSEQLOCK:
+        assert(fseqlock_read(shared->fseqlock, dest, shared->fields, sizeof(shared->fields)) == 0);
+        break;
+    case BENCH_FSEQLOCK_FRWLOCK:
+        assert(frwlock_read_lock(shared->frwlock) == 0);
+        for(size_t j = 0; j < BENCH_FSEQLOCK_FIELDS; j++) {
+            dest[j] = shared->fields[j];
+        }
+        assert(frwlock_read_unlock(shared->frwlock) == 0);
+        break;
+    default:
+        assert(pthread_rwlock_rdlock(&(shared->prwlock)) == 0);
+        for(size_t j = 0; j < BENCH_FSEQLOCK_FIELDS; j++) {
+            dest[j] = shared->fields[j];
+        }
+        assert(pthread_rwlock_unlock(&(shared->prwlock)) == 0);
+        break;
+    }
+}
+
+void bench_fseqlock_write(struct bench_fseqlock_shared *shared) {
+    switch(shared->kind) {
+    case BENCH_FSEQLOCK_FSEQLOCK:
+        assert(fseqlock_write_lock(shared->fseqlock) == 0);
+        // readers may be reading at the same time, so store atomically
+        for(size_t j = 0; j < BENCH_FSEQLOCK_FIELDS; j++) {
+            __atomic_store_n(&(shared->fields[j]), shared->fields[j] + 1, __ATOMIC_RELAXED);
+        }
+        assert(fseqlock_write_unlock(shared->fseqlock) == 0);
+        break;
+    case BENCH_FSEQLOCK_FRWLOCK:
+        assert(frwlock_write_lock(shared->frwlock) == 0);
+        for(size_t j = 0; j < BENCH_FSEQLOCK_FIELDS; j++) {
+            shared->fields[j]++;
+        }
+        assert(frwlock_write_unlock(shared->frwlock) == 0);
+        break;
+    default:
+        assert(pthread_rwlock_wrlock(&(shared->prwlock)) == 0);
+        for(size_t j = 0; j < BENCH_FSEQLOCK_FIELDS; j++) {
+            shared->fields[j]++;
+        }
+        assert(pthread_rwlock_unlock(&(shared->prwlock)) == 0);
+        break;
+    }
+}
+
+void *bench_fseqlock_worker(void *arg) {
+    struct bench_fseqlock_shared *shared = arg;
+    // xorshift so the ratio is random without contending on rand
+    uint64_t random = (uint64_t) (uintptr_t) &random | 1;
+    uint64_t copy[BENCH_FSEQLOCK_FIELDS];
+    volatile uint64_t sum = 0;
+
+    for(size_t i = 0; i < BENCH_FSEQLOCK_OPERATIONS; i++) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+
+        if((random % 1000) < shared->reads_per_1000) {
+            bench_fseqlock_read(shared, copy);
+            for(size_t j = 0; j < BENCH_FSEQLOCK_FIELDS; j++) {
+                sum += copy[j];
+            }
+        } else {
+            bench_fseqlock_write(shared);
+        }
+    }
+
+    return NULL;
+}
+
+void bench_fseqlock_run(const char *name, enum bench_fseqlock_kind kind, unsigned reads_per_1000, size_t num_threads) {
+    struct bench_fseqlock_shared shared = { 0 };
+    pthread_t threads[num_threads];
+    uint64_t start, elapsed;
+
+    shared.kind = kind;
+    shared.reads_per_1000 = reads_per_1000;
+    shared.fseqlock = fseqlock_create();
+    assert(shared.fseqlock != NULL);
+    shared.frwlock = frwlock_create(FRWLOCK_KIND_PREFER_WRITER);
+    assert(shared.frwlock != NULL);
+    assert(pthread_rwlock_init(&(shared.prwlock), NULL) == 0);
+
+    start = bench_fseqlock_now();
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_create(&(threads[i]), NULL, bench_fseqlock_worker, &shared) == 0);
+    }
+    for(size_t i = 0; i < num_threads; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+    elapsed = bench_fseqlock_now() - start;
+
+    printf("%-18s %8.1f%% %12.3f %12.2f\n", name, reads_per_1000 / 10.0, elapsed / 1000000.0,
+           ((double) elapsed) / (num_threads * BENCH_FSEQLOCK_OPERATIONS));
+    fseqlock_destroy(shared.fseqlock);
+    frwlock_destroy(shared.frwlock);
+    pthread_rwlock_destroy(&(shared.prwlock));
+}
+
+int main(int argc, char **argv) {
+    unsigned ratios[] = { 900, 990, 999, 1000 };
+    size_t num_threads = 4;
+
+    if(argc > 1) {
+        num_threads = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(num_threads == 0) {
+        num_threads = 1;
+    }
+
+    printf("%zu threads, %i operations each\n", num_threads, BENCH_FSEQLOCK_OPERATIONS);
+    printf("%-18s %9s %12s %12s\n", "lock", "reads", "total (ms)", "ns per op");
+    for(size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++) {
+        bench_fseqlock_run("Fseqlock", BENCH_FSEQLOCK_FSEQLOCK, ratios[i], num_threads);
+        bench_fseqlock_run("Frwlock", BENCH_FSEQLOCK_FRWLOCK, ratios[i], num_threads);
+        bench_fseqlock_run("pthread_rwlock_t", BENCH_FSEQLOCK_PTHREAD, ratios[i], num_threads);
+    }
+    return 0;
+}
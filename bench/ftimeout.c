@@ -0,0 +1,195 @@
+/*
+ * ftimeout.c -- Measure how closely Fmutex and Fsemaphore timed waits keep to their deadlines, and what they cost
+ * Usage: bench_ftimeout [number of timed out waits per timeout], defaults to 100.
+ * Overshoot is how long after the deadline a timed out wait returned, compared against sem_clockwait.
+ * Overhead is the cost of the timed and try variants when they succeed immediately, next to the plain ones.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+// sem_clockwait
+#define _GNU_SOURCE (1)
+
+#include <fmutex.h>
+#include <fsemaphore.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <semaphore.h>
+
+#define BENCH_FTIMEOUT_OPERATIONS (1000000)
+
+enum bench_ftimeout_kind {
+    BENCH_FTIMEOUT_FMUTEX,
+    BENCH_FTIMEOUT_FSEMAPHORE,
+    BENCH_FTIMEOUT_SEM
+};
+
+uint64_t bench_ftimeout_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+struct timespec bench_ftimeout_timespec(uint64_t ns) {
+    struct timespec ret;
+
+    ret.tv_sec = ns / 1000000000;
+    ret.tv_nsec = ns % 1000000000;
+    return ret;
+}
+
+// Time out num_waits times after timeout_ns each, on a mutex that is held or a semaphore with no permits
+void bench_ftimeout_accuracy(const char *name, enum bench_ftimeout_kind kind, uint64_t timeout_ns, size_t num_waits) {
+    Fmutex *fmutex;
+    Fsemaphore *fsemaphore;
+    sem_t psem;
+    uint64_t deadline, overshoot, total = 0, max = 0;
+    struct timespec abstime;
+    int res;
+
+    fmutex = fmutex_create();
+    assert(fmutex != NULL);
+    assert(fmutex_lock(fmutex) == 0);
+    fsemaphore = fsemaphore_create(0, 1);
+    assert(fsemaphore != NULL);
+    assert(sem_init(&psem, 0, 0) == 0);
+
+    for(size_t i = 0; i < num_waits; i++) {
+        deadline = bench_ftimeout_now() + timeout_ns;
+        abstime = bench_ftimeout_timespec(deadline);
+        switch(kind) {
+        case BENCH_FTIMEOUT_FMUTEX:
+            res = fmutex_timedlock(fmutex, &abstime);
+            break;
+        case BENCH_FTIMEOUT_FSEMAPHORE:
+            res = fsemaphore_timedwait(fsemaphore, &abstime);
+            break;
+        default:
+            res = sem_clockwait(&psem, CLOCK_MONOTONIC, &abstime) == 0 ? 0 : errno;
+            break;
+        }
+        overshoot = bench_ftimeout_now() - deadline;
+        assert(res == ETIMEDOUT);
+
+        total += overshoot;
+        if(overshoot > max) {
+            max = overshoot;
+        }
+    }
+
+    printf("%-16s %12.3f %14.3f %14.3f\n", name, timeout_ns / 1000.0,
+           (total / (double) num_waits) / 1000.0, max / 1000.0);
+    assert(fmutex_unlock(fmutex) == 0);
+    fmutex_destroy(fmutex);
+    fsemaphore_destroy(fsemaphore);
+    sem_destroy(&psem);
+}
+
+// Average cost of operation in nanoseconds when it never has to wait
+void bench_ftimeout_overhead(const char *name, int (*operation)(Fmutex *, Fsemaphore *, struct timespec *)) {
+    Fmutex *fmutex;
+    Fsemaphore *fsemaphore;
+    struct timespec abstime;
+    uint64_t start, elapsed;
+
+    fmutex = fmutex_create();
+    assert(fmutex != NULL);
+    fsemaphore = fsemaphore_create(1, 1);
+    assert(fsemaphore != NULL);
+    abstime = bench_ftimeout_timespec(bench_ftimeout_now() + 1000000000);
+
+    start = bench_ftimeout_now();
+    for(size_t i = 0; i < BENCH_FTIMEOUT_OPERATIONS; i++) {
+        assert(operation(fmutex, fsemaphore, &abstime) == 0);
+    }
+    elapsed = bench_ftimeout_now() - start;
+
+    printf("%-32s %12.2f\n", name, ((double) elapsed) / BENCH_FTIMEOUT_OPERATIONS);
+    fmutex_destroy(fmutex);
+    fsemaphore_destroy(fsemaphore);
+}
+
+int bench_ftimeout_lock(Fmutex *fmutex, Fsemaphore *fsemaphore, struct timespec *abstime) {
+    (void)(fsemaphore);
+    (void)(abstime);
+
+    assert(fmutex_lock(fmutex) == 0);
+    return fmutex_unlock(fmutex);
+}
+
+int bench_ftimeout_trylock(Fmutex *fmutex, Fsemaphore *fsemaphore, struct timespec *abstime) {
+    (void)(fsemaphore);
+    (void)(abstime);
+
+    assert(fmutex_trylock(fmutex) == 0);
+    return fmutex_unlock(fmutex);
+}
+
+int bench_ftimeout_timedlock(Fmutex *fmutex, Fsemaphore *fsemaphore, struct timespec *abstime) {
+    (void)(fsemaphore);
+
+    assert(fmutex_timedlock(fmutex, abstime) == 0);
+    return fmutex_unlock(fmutex);
+}
+
+int bench_ftimeout_wait(Fmutex *fmutex, Fsemaphore *fsemaphore, struct timespec *abstime) {
+    (void)(fmutex);
+    (void)(abstime);
+
+    assert(fsemaphore_wait(fsemaphore) == 0);
+    return fsemaphore_post(fsemaphore);
+}
+
+int bench_ftimeout_trywait(Fmutex *fmutex, Fsemaphore *fsemaphore, struct timespec *abstime) {
+    (void)(fmutex);
+    (void)(abstime);
+
+    assert(fsemaphore_trywait(fsemaphore) == 0);
+    return fsemaphore_post(fsemaphore);
+}
+
+int bench_ftimeout_timedwait(Fmutex *fmutex, Fsemaphore *fsemaphore, struct timespec *abstime) {
+    (void)(fmutex);
+
+    assert(fsemaphore_timedwait(fsemaphore, abstime) == 0);
+    return fsemaphore_post(fsemaphore);
+}
+
+int main(int argc, char **argv) {
+    size_t num_waits = 100;
+    uint64_t timeouts[] = { 10000, 100000, 1000000, 10000000 };
+
+    if(argc > 1) {
+        num_waits = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(num_waits == 0) {
+        num_waits = 1;
+    }
+
+    printf("%zu timed out waits per timeout\n", num_waits);
+    printf("%-16s %12s %14s %14s\n", "wait", "timeout (us)", "mean over (us)", "max over (us)");
+    for(size_t i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+        bench_ftimeout_accuracy("fmutex_timedlock", BENCH_FTIMEOUT_FMUTEX, timeouts[i], num_waits);
+        bench_ftimeout_accuracy("fsemaphore_timed", BENCH_FTIMEOUT_FSEMAPHORE, timeouts[i], num_waits);
+        bench_ftimeout_accuracy("sem_clockwait", BENCH_FTIMEOUT_SEM, timeouts[i], num_waits);
+    }
+
+    printf("\n%i uncontended operations each\n", BENCH_FTIMEOUT_OPERATIONS);
+    printf("%-32s %12s\n", "operation", "ns per op");
+    bench_ftimeout_overhead("fmutex_lock + unlock", bench_ftimeout_lock);
+    bench_ftimeout_overhead("fmutex_trylock + unlock", bench_ftimeout_trylock);
+    bench_ftimeout_overhead("fmutex_timedlock + unlock", bench_ftimeout_timedlock);
+    bench_ftimeout_overhead("fsemaphore_wait + post", bench_ftimeout_wait);
+    bench_ftimeout_overhead("fsemaphore_trywait + post", bench_ftimeout_trywait);
+    bench_ftimeout_overhead("fsemaphore_timedwait + post", bench_ftimeout_timedwait);
+    return 0;
+}
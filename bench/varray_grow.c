@@ -0,0 +1,108 @@
+/*
+ * varray_grow.c -- Time spent growing a Varray from 1 MiB to a few GiB
+ * Compares the default allocator, which grows large buffers using mremap, against one that always copies.
+ * Usage: bench_varray_grow [max MiB], defaults to 1024. 16384 measures up to 16 GiB given enough memory.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <varray.h>
+#include <vallocator.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_VARRAY_GROW_START ((size_t) 1 << 20)
+
+uint64_t bench_varray_grow_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void *bench_varray_grow_copy_alloc(void *ctx, size_t num_bytes) {
+    (void)(ctx);
+    return malloc(num_bytes);
+}
+
+// What realloc costs when the buffer cannot be extended in place
+void *bench_varray_grow_copy_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+    void *ret;
+
+    (void)(ctx);
+    ret = malloc(new_bytes);
+    if(ret == NULL) {
+        return NULL;
+    }
+    memcpy(ret, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+    free(ptr);
+    return ret;
+}
+
+void bench_varray_grow_copy_free(void *ctx, void *ptr, size_t num_bytes) {
+    (void)(ctx);
+    (void)(num_bytes);
+    free(ptr);
+}
+
+// Double a byte Varray from BENCH_VARRAY_GROW_START to max_bytes, filling it as it goes
+// Time spent in growth for the step ending at (BENCH_VARRAY_GROW_START << i) is placed in step_ns[i]
+uint64_t bench_varray_grow_run(Vallocator *allocator, size_t max_bytes, uint64_t *step_ns) {
+    Varray *array;
+    uint64_t start, total = 0;
+    size_t step = 0;
+
+    array = varray_create(1, allocator);
+    assert(array != NULL);
+    for(size_t bytes = BENCH_VARRAY_GROW_START; bytes <= max_bytes; bytes <<= 1, step++) {
+        start = bench_varray_grow_now();
+        assert(varray_reserve(array, bytes) == 0);
+        step_ns[step] = bench_varray_grow_now() - start;
+        total += step_ns[step];
+
+        // contents must really exist, otherwise copying would be free
+        assert(varray_resize(array, bytes) == 0);
+        memset(varray_get_direct(array, bytes / 2), (int) step, bytes / 2);
+    }
+    varray_destroy(array);
+
+    return total;
+}
+
+int main(int argc, char **argv) {
+    Vallocator copying = {
+        .alloc = bench_varray_grow_copy_alloc,
+        .realloc = bench_varray_grow_copy_realloc,
+        .free = bench_varray_grow_copy_free,
+        .ctx = NULL
+    };
+    uint64_t mapped_ns[64] = { 0 }, copied_ns[64] = { 0 };
+    uint64_t mapped_total, copied_total;
+    size_t max_bytes = (size_t) 1024 << 20;
+    size_t step = 0;
+
+    if(argc > 1) {
+        max_bytes = (size_t) strtoull(argv[1], NULL, 10) << 20;
+    }
+    if(max_bytes < BENCH_VARRAY_GROW_START) {
+        max_bytes = BENCH_VARRAY_GROW_START;
+    }
+
+    mapped_total = bench_varray_grow_run(NULL, max_bytes, mapped_ns);
+    copied_total = bench_varray_grow_run(&copying, max_bytes, copied_ns);
+
+    printf("%12s %14s %14s\n", "size (MiB)", "mremap (us)", "copy (us)");
+    for(size_t bytes = BENCH_VARRAY_GROW_START; bytes <= max_bytes; bytes <<= 1, step++) {
+        printf("%12zu %14.1f %14.1f\n", bytes >> 20, mapped_ns[step] / 1000.0, copied_ns[step] / 1000.0);
+    }
+    printf("%12s %14.1f %14.1f\n", "total", mapped_total / 1000.0, copied_total / 1000.0);
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * varray_sort.c -- Compare varray_sort against qsort on 16 byte records with a 64-bit key
+ * Usage: bench_varray_sort [number of records], defaults to 1000000.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <varray.h>
+#include <varray_sort.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+struct bench_varray_sort_record {
+    uint64_t key;
+    uint64_t value;
+};
+
+uint64_t bench_varray_sort_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+int bench_varray_sort_compare(const void *src1, const void *src2) {
+    const struct bench_varray_sort_record *record1 = src1, *record2 = src2;
+
+    return (record1->key > record2->key) - (record1->key < record2->key);
+}
+
+int main(int argc, char **argv) {
+    struct bench_varray_sort_record record;
+    Varray *array;
+    void *copy;
+    uint64_t start, qsort_ns, radix_ns, state = 88172645463325252ULL;
+    size_t len = 1000000;
+
+    if(argc > 1) {
+        len = (size_t) strtoull(argv[1], NULL, 10);
+    }
+
+    array = varray_create(sizeof(struct bench_varray_sort_record), NULL);
+    assert(array != NULL);
+    for(size_t i = 0; i < len; i++) {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        record.key = state;
+        record.value = i;
+        assert(varray_push(array, &record) == 0);
+    }
+    copy = malloc(len * sizeof(struct bench_varray_sort_record));
+    assert(copy != NULL || len == 0);
+    if(len != 0) {
+        memcpy(copy, varray_get_direct(array, 0), len * sizeof(struct bench_varray_sort_record));
+    }
+
+    start = bench_varray_sort_now();
+    qsort(copy, len, sizeof(struct bench_varray_sort_record), bench_varray_sort_compare);
+    qsort_ns = bench_varray_sort_now() - start;
+
+    start = bench_varray_sort_now();
+    assert(varray_sort(array, offsetof(struct bench_varray_sort_record, key), sizeof(uint64_t),
+                       VARRAY_SORT_KEY_UNSIGNED) == 0);
+    radix_ns = bench_varray_sort_now() - start;
+
+    for(size_t i = 0; i < len; i++) {
+        assert(((struct bench_varray_sort_record *) copy)[i].key ==
+               ((struct bench_varray_sort_record *) varray_get_direct(array, i))->key);
+    }
+
+    printf("%zu records\n", len);
+    printf("qsort:       %10.3f ms\n", qsort_ns / 1000000.0);
+    printf("varray_sort: %10.3f ms\n", radix_ns / 1000000.0);
+
+    free(copy);
+    varray_destroy(array);
+    return 0;
+}
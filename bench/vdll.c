@@ -0,0 +1,78 @@
+/*
+ * vdll.c -- Compare VDLL_KIND_NODE against VDLL_KIND_UNROLLED, each with and without an index,
+ * for appends, random reads, and random inserts
+ * Usage: bench_vdll [number of elements], defaults to 100000.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <vdll.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_VDLL_OPERATIONS (10000)
+
+uint64_t bench_vdll_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+void bench_vdll_run(const char *name, Vdll_kind kind, bool indexed, size_t len) {
+    uint64_t start, grow_ns, get_ns, insert_ns;
+    long value;
+    Vdll *dll;
+
+    dll = vdll_create(sizeof(long), kind, NULL, NULL);
+    assert(dll != NULL);
+    if(indexed) {
+        assert(vdll_index_enable(dll) == 0);
+    }
+
+    srand(1);
+    start = bench_vdll_now();
+    assert(vdll_grow(dll, len) == 0);
+    grow_ns = bench_vdll_now() - start;
+
+    start = bench_vdll_now();
+    for(size_t i = 0; i < BENCH_VDLL_OPERATIONS; i++) {
+        assert(vdll_get(dll, ((size_t) rand()) % len, &value) == 0);
+    }
+    get_ns = bench_vdll_now() - start;
+
+    start = bench_vdll_now();
+    for(size_t i = 0; i < BENCH_VDLL_OPERATIONS; i++) {
+        assert(vdll_insert(dll, ((size_t) rand()) % vdll_len(dll), 1) == 0);
+    }
+    insert_ns = bench_vdll_now() - start;
+
+    printf("%-18s %12.3f %12.3f %12.3f\n", name, grow_ns / 1000000.0, get_ns / 1000000.0, insert_ns / 1000000.0);
+    vdll_destroy(dll);
+}
+
+int main(int argc, char **argv) {
+    size_t len = 100000;
+
+    if(argc > 1) {
+        len = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if(len == 0) {
+        len = 1;
+    }
+
+    printf("%zu elements, %i random reads and inserts\n", len, BENCH_VDLL_OPERATIONS);
+    printf("%-18s %12s %12s %12s\n", "kind", "grow (ms)", "get (ms)", "insert (ms)");
+    bench_vdll_run("node", VDLL_KIND_NODE, false, len);
+    bench_vdll_run("unrolled", VDLL_KIND_UNROLLED, false, len);
+    bench_vdll_run("node indexed", VDLL_KIND_NODE, true, len);
+    bench_vdll_run("unrolled indexed", VDLL_KIND_UNROLLED, true, len);
+    return 0;
+}
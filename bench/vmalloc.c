@@ -0,0 +1,136 @@
+/*
+ * vmalloc.c -- Allocation heavy workloads that only use the standard allocation functions
+ * Run once normally and once with LD_PRELOAD=./libdert_malloc.so to compare allocators.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#define _GNU_SOURCE 1
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define BENCH_VMALLOC_ROUNDS (2000000)
+#define BENCH_VMALLOC_LIVE (4096)
+#define BENCH_VMALLOC_THREADS (4)
+
+struct bench_vmalloc_node {
+    struct bench_vmalloc_node *next;
+    uint64_t payload[3];
+};
+
+uint64_t bench_vmalloc_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+uint64_t bench_vmalloc_rand(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Randomly sized allocations replacing each other in a fixed size working set
+void *bench_vmalloc_churn(void *arg) {
+    void *live[BENCH_VMALLOC_LIVE] = { 0 };
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ (uintptr_t) arg;
+    size_t slot, size;
+
+    for(size_t i = 0; i < BENCH_VMALLOC_ROUNDS; i++) {
+        slot = bench_vmalloc_rand(&state) % BENCH_VMALLOC_LIVE;
+        size = 8 + (bench_vmalloc_rand(&state) % 512);
+        free(live[slot]);
+        live[slot] = malloc(size);
+        assert(live[slot] != NULL);
+        memset(live[slot], (int) i, 8);
+    }
+
+    for(size_t i = 0; i < BENCH_VMALLOC_LIVE; i++) {
+        free(live[i]);
+    }
+    return NULL;
+}
+
+// Build and then tear down linked lists of small nodes
+void bench_vmalloc_lists(void) {
+    struct bench_vmalloc_node *head, *node;
+
+    for(size_t round = 0; round < 20; round++) {
+        head = NULL;
+        for(size_t i = 0; i < BENCH_VMALLOC_ROUNDS / 20; i++) {
+            node = malloc(sizeof(struct bench_vmalloc_node));
+            assert(node != NULL);
+            node->payload[0] = i;
+            node->next = head;
+            head = node;
+        }
+        while(head != NULL) {
+            node = head->next;
+            free(head);
+            head = node;
+        }
+    }
+}
+
+// Grow many strings one realloc at a time
+void bench_vmalloc_strings(void) {
+    char *strings[64] = { 0 };
+    size_t lens[64] = { 0 };
+
+    for(size_t i = 0; i < BENCH_VMALLOC_ROUNDS; i++) {
+        size_t which = i % 64;
+        strings[which] = realloc(strings[which], lens[which] + 2);
+        assert(strings[which] != NULL);
+        strings[which][lens[which]] = 'a';
+        lens[which]++;
+        strings[which][lens[which]] = 0;
+        if(lens[which] > 100000) {
+            free(strings[which]);
+            strings[which] = NULL;
+            lens[which] = 0;
+        }
+    }
+
+    for(size_t i = 0; i < 64; i++) {
+        free(strings[i]);
+    }
+}
+
+int main(void) {
+    pthread_t threads[BENCH_VMALLOC_THREADS];
+    uint64_t start;
+
+    start = bench_vmalloc_now();
+    bench_vmalloc_churn(NULL);
+    printf("churn, 1 thread:   %8.2f ns/op\n", (double) (bench_vmalloc_now() - start) / BENCH_VMALLOC_ROUNDS);
+
+    start = bench_vmalloc_now();
+    for(size_t i = 0; i < BENCH_VMALLOC_THREADS; i++) {
+        assert(pthread_create(&threads[i], NULL, bench_vmalloc_churn, (void *) (i + 1)) == 0);
+    }
+    for(size_t i = 0; i < BENCH_VMALLOC_THREADS; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+    printf("churn, %d threads: %8.2f ns/op\n", BENCH_VMALLOC_THREADS,
+           (double) (bench_vmalloc_now() - start) / (BENCH_VMALLOC_THREADS * BENCH_VMALLOC_ROUNDS));
+
+    start = bench_vmalloc_now();
+    bench_vmalloc_lists();
+    printf("linked lists:      %8.2f ns/op\n", (double) (bench_vmalloc_now() - start) / (2 * BENCH_VMALLOC_ROUNDS));
+
+    start = bench_vmalloc_now();
+    bench_vmalloc_strings();
+    printf("growing strings:   %8.2f ns/op\n", (double) (bench_vmalloc_now() - start) / BENCH_VMALLOC_ROUNDS);
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+
+# Runs allocation heavy workloads with the system allocator and then with libdert_malloc.so
+# Expects to be run from the root of the repository after `make libdert_malloc.so bench_vmalloc`
+
+set -eou pipefail
+
+shim="$(pwd)/libdert_malloc.so"
+words="$(mktemp)"
+trap 'rm -f "${words}"' EXIT
+seq 1 500000 | sed 's/$/ lorem ipsum dolor sit amet/' > "${words}"
+
+workload() {
+    local name="$1"
+    shift
+    local start end
+    start="$(date +%s%N)"
+    "$@" > /dev/null
+    end="$(date +%s%N)"
+    printf '%-28s %8d ms\n' "${name}" "$(( (end - start) / 1000000 ))"
+}
+
+run_all() {
+    ./bench_vmalloc
+    workload "sort" sort -R "${words}"
+    workload "awk word count" awk '{ count[$1 % 1000 " " $2]++ } END { for (w in count) print w, count[w] }' "${words}"
+    if command -v python3 > /dev/null; then
+        workload "python dict churn" python3 -c 'd = {}
+for i in range(1000000): d[str(i)] = [i] * 3
+for i in range(0, 1000000, 2): del d[str(i)]'
+    fi
+}
+
+echo "== system allocator =="
+run_all
+
+echo "== libdert_malloc.so =="
+export LD_PRELOAD="${shim}"
+run_all
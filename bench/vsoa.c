@@ -0,0 +1,88 @@
+/*
+ * vsoa.c -- Compare scanning two fields of 64 byte records stored in a Varray against the same fields in a Vsoa
+ * Usage: bench_vsoa [number of records], defaults to 4000000.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#include <varray.h>
+#include <vsoa.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_VSOA_PASSES (10)
+
+struct bench_vsoa_record {
+    double price;
+    double quantity;
+    double unused[6];
+};
+
+uint64_t bench_vsoa_now(void) {
+    struct timespec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (((uint64_t) spec.tv_sec) * 1000000000) + spec.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    size_t column_sizes[8] = {
+        sizeof(double), sizeof(double), sizeof(double), sizeof(double),
+        sizeof(double), sizeof(double), sizeof(double), sizeof(double)
+    };
+    struct bench_vsoa_record record = { 0 }, *records;
+    void *row[8] = { &(record.price), &(record.quantity), NULL, NULL, NULL, NULL, NULL, NULL };
+    double *prices, *quantities, aos_total = 0, soa_total = 0;
+    uint64_t start, aos_ns, soa_ns;
+    size_t len = 4000000;
+    Varray *array;
+    Vsoa *soa;
+
+    if(argc > 1) {
+        len = (size_t) strtoull(argv[1], NULL, 10);
+    }
+
+    array = varray_create(sizeof(struct bench_vsoa_record), NULL);
+    soa = vsoa_create(8, column_sizes, NULL);
+    assert(array != NULL && soa != NULL);
+    for(size_t i = 0; i < len; i++) {
+        record.price = (double) (i % 1000);
+        record.quantity = (double) (i % 7);
+        assert(varray_push(array, &record) == 0);
+        assert(vsoa_push(soa, row) == 0);
+    }
+
+    start = bench_vsoa_now();
+    for(size_t pass = 0; pass < BENCH_VSOA_PASSES; pass++) {
+        records = varray_get_direct(array, 0);
+        for(size_t i = 0; i < len; i++) {
+            aos_total += records[i].price * records[i].quantity;
+        }
+    }
+    aos_ns = bench_vsoa_now() - start;
+
+    start = bench_vsoa_now();
+    for(size_t pass = 0; pass < BENCH_VSOA_PASSES; pass++) {
+        prices = VSOA_COLUMN(soa, 0, double);
+        quantities = VSOA_COLUMN(soa, 1, double);
+        for(size_t i = 0; i < len; i++) {
+            soa_total += prices[i] * quantities[i];
+        }
+    }
+    soa_ns = bench_vsoa_now() - start;
+
+    assert(aos_total == soa_total);
+    printf("%zu records, %i passes\n", len, BENCH_VSOA_PASSES);
+    printf("Varray: %10.3f ms\n", aos_ns / 1000000.0);
+    printf("Vsoa:   %10.3f ms\n", soa_ns / 1000000.0);
+
+    varray_destroy(array);
+    vsoa_destroy(soa);
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * fbarrier.h -- Barrier implemented using futex.
+ * Relies on Linux system calls.
+ *
+ * Every thread calling fbarrier_wait blocks until count threads have called it, then all of them continue.
+ * The barrier can then be used again by the same number of threads.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Returned by fbarrier_wait to exactly one of the threads of each round, like PTHREAD_BARRIER_SERIAL_THREAD
+#define FBARRIER_SERIAL_THREAD (-1)
+
+typedef struct fbarrier {
+    // Number of threads waiting in the current round
+    _Atomic uint32_t arrived;
+
+    // Threads sleep on this, changed when a round completes
+    _Atomic uint32_t generation;
+
+    // Number of threads that complete a round
+    uint32_t count;
+} Fbarrier;
+
+// Allocates memory for and create
+Fbarrier *fbarrier_create(uint32_t count);
+
+// Advise how much memory is needed
+size_t fbarrier_advise(uint32_t count);
+
+// Advise for many
+size_t fbarrier_advisev(size_t num_barriers, uint32_t count);
+
+// Initialize
+int fbarrier_init(Fbarrier **dest, void *memory, uint32_t count);
+
+// Initialize for many
+int fbarrier_initv(size_t num_barriers, Fbarrier *dest[], void *memory, uint32_t count);
+
+// Deinitialize
+void fbarrier_deinit(Fbarrier *barrier);
+
+/*
+ * Destroys a Fbarrier that was allocated by fbarrier_create.
+ * Please, only use with memory allocated by fbarrier_create!
+ */
+void fbarrier_destroy(Fbarrier *barrier);
+
+// block until count threads are waiting
+// returns FBARRIER_SERIAL_THREAD to the last thread to arrive and 0 to the rest
+int fbarrier_wait(Fbarrier *barrier);
@@ -0,0 +1,66 @@
+/*
+ * fcond.h -- Condition variable implemented using futex, used together with Fmutex.
+ * Relies on Linux system calls.
+ *
+ * Signalling or broadcasting with no thread waiting makes no system call.
+ * Broadcasting wakes a single waiter and moves the rest directly onto the mutex they will need next,
+ * so they are released one unlock at a time instead of all waking only to sleep on the mutex again.
+ * As with pthread_cond_t waiters may wake without being signalled, so wait in a loop checking the condition.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <fmutex.h>
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct fcond {
+    // Waiters sleep on this, changed by every signal and broadcast
+    _Atomic uint32_t seq;
+
+    // Number of threads that may be sleeping on seq
+    _Atomic uint32_t waiters;
+
+    // Mutex passed by the most recent waiter, every waiter must pass the same one
+    Fmutex *_Atomic mutex;
+} Fcond;
+
+// Allocates memory for and create
+Fcond *fcond_create(void);
+
+// Advise how much memory is needed
+size_t fcond_advise(void);
+
+// Advise for many
+size_t fcond_advisev(size_t num_conds);
+
+// Initialize
+int fcond_init(Fcond **dest, void *memory);
+
+// Initialize for many
+int fcond_initv(size_t num_conds, Fcond *dest[], void *memory);
+
+// Deinitialize
+void fcond_deinit(Fcond *cond);
+
+/*
+ * Destroys a Fcond that was allocated by fcond_create.
+ * Please, only use with memory allocated by fcond_create!
+ */
+void fcond_destroy(Fcond *cond);
+
+// unlock mutex, which the caller must hold, and sleep until signalled
+// mutex is locked again before returning
+int fcond_wait(Fcond *cond, Fmutex *mutex);
+
+// wake one waiting thread
+int fcond_signal(Fcond *cond);
+
+// wake every waiting thread
+int fcond_broadcast(Fcond *cond);
@@ -0,0 +1,75 @@
+/*
+ * fevent.h -- Event implemented using futex.
+ * Relies on Linux system calls.
+ *
+ * Threads wait until the event is set.
+ * FEVENT_KIND_MANUAL_RESET events release every waiter and stay set until fevent_reset is called.
+ * FEVENT_KIND_AUTO_RESET events release a single waiter, which resets the event as it leaves.
+ * Setting an event nobody waits for makes no system call.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum fevent_kind {
+    // Setting releases one waiter and the event is reset once it has
+    FEVENT_KIND_AUTO_RESET,
+
+    // Setting releases every waiter until reset
+    FEVENT_KIND_MANUAL_RESET
+} Fevent_kind;
+
+typedef struct fevent {
+    // Linux FUTEX syscall requires a uint32_t*
+    // So, use this uint32_t as a boolean
+    _Atomic uint32_t set;
+
+    // Number of threads that may be sleeping on set
+    _Atomic uint32_t waiters;
+
+    Fevent_kind kind;
+} Fevent;
+
+// Allocates memory for and create
+Fevent *fevent_create(Fevent_kind kind, bool set);
+
+// Advise how much memory is needed
+size_t fevent_advise(Fevent_kind kind, bool set);
+
+// Advise for many
+size_t fevent_advisev(size_t num_events, Fevent_kind kind, bool set);
+
+// Initialize
+int fevent_init(Fevent **dest, void *memory, Fevent_kind kind, bool set);
+
+// Initialize for many
+int fevent_initv(size_t num_events, Fevent *dest[], void *memory, Fevent_kind kind, bool set);
+
+// Deinitialize
+void fevent_deinit(Fevent *event);
+
+/*
+ * Destroys a Fevent that was allocated by fevent_create.
+ * Please, only use with memory allocated by fevent_create!
+ */
+void fevent_destroy(Fevent *event);
+
+// block until event is set
+// resets event before returning when FEVENT_KIND_AUTO_RESET
+int fevent_wait(Fevent *event);
+
+// set event, waking one waiter when FEVENT_KIND_AUTO_RESET or every waiter when FEVENT_KIND_MANUAL_RESET
+int fevent_set(Fevent *event);
+
+// reset event so that waiters block
+int fevent_reset(Fevent *event);
+
+// whether event is currently set
+bool fevent_is_set(Fevent *event);
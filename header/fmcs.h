@@ -0,0 +1,87 @@
+/*
+ * fmcs.h -- MCS queue lock, waiters spin on their own node and then sleep using futex.
+ * Relies on Linux system calls.
+ *
+ * Threads waiting for the lock form a queue and the lock is handed to them in the order they arrived.
+ * Each waiter only ever reads its own Fmcs_node, so heavy contention does not have every waiter
+ * hammering one shared cache line the way it does with Fmutex.
+ * A waiter spins on its node for a short while and then sleeps until the thread ahead of it hands over the lock.
+ *
+ * Every lock and unlock pair passes the same Fmcs_node, which the caller provides.
+ * It must stay valid until fmcs_unlock returns and cannot be used for another lock in the meantime.
+ * Declaring it on the stack of the function taking the lock is the usual way.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Nodes are aligned to this so that no two waiters spin on the same cache line
+#define FMCS_CACHE_LINE_SIZE (64)
+
+// Values of Fmcs_node.state
+// Queued, spinning
+#define FMCS_WAITING (0)
+// Queued, sleeping on state
+#define FMCS_PARKED (1)
+// The lock was handed over
+#define FMCS_GRANTED (2)
+
+typedef struct fmcs_node {
+    // Waiter queued directly after this one
+    struct fmcs_node *_Atomic next;
+
+    // Linux FUTEX syscall requires a uint32_t*
+    // Holds one of FMCS_WAITING, FMCS_PARKED, or FMCS_GRANTED
+    _Atomic uint32_t state;
+} __attribute__((aligned(FMCS_CACHE_LINE_SIZE))) Fmcs_node;
+
+typedef struct fmcs {
+    // Last waiter in the queue, or holder if nobody waits, NULL when unlocked
+    Fmcs_node *_Atomic tail;
+} Fmcs;
+
+// Allocates memory for and create
+// Default state is unlocked
+Fmcs *fmcs_create(void);
+
+// Advise how much memory is needed
+size_t fmcs_advise(void);
+
+// Advise for many
+size_t fmcs_advisev(size_t num_locks);
+
+// Initialize
+// Default state is unlocked
+int fmcs_init(Fmcs **dest, void *memory);
+
+// Initialize for many
+int fmcs_initv(size_t num_locks, Fmcs *dest[], void *memory);
+
+// Deinitialize
+void fmcs_deinit(Fmcs *lock);
+
+/*
+ * Destroys a Fmcs that was allocated by fmcs_create.
+ * Please, only use with memory allocated by fmcs_create!
+ */
+void fmcs_destroy(Fmcs *lock);
+
+// lock, queueing node behind any thread already holding or waiting for lock
+// forces calling thread to wait if currently locked
+// can lead to deadlock
+int fmcs_lock(Fmcs *lock, Fmcs_node *node);
+
+// take lock only if nobody holds it
+// fails with EBUSY if lock is held
+int fmcs_trylock(Fmcs *lock, Fmcs_node *node);
+
+// unlock, handing the lock to the next thread in the queue
+// node must be the one passed to fmcs_lock
+int fmcs_unlock(Fmcs *lock, Fmcs_node *node);
@@ -2,6 +2,12 @@
  * fmutex.h -- Mutex data structure implemented using futex.
  * Relies on Linux system calls.
  *
+ * Locking an unlocked mutex and unlocking a mutex nobody waits for are a single atomic operation each.
+ * A thread that finds the mutex held spins for a short while before sleeping in the kernel,
+ * and only unlocking a mutex that a thread may be sleeping on makes a system call.
+ * Timed variants take an absolute deadline on CLOCK_MONOTONIC, which the kernel enforces while sleeping.
+ * Built with DERT_STATS, each mutex also counts how often and how long threads waited for it, see fstats.h.
+ *
  * DERT - Miscellaneous Data Structures Library
  * https://github.com/moretiles/dert
  * Project licensed under Apache-2.0 license
@@ -9,14 +15,32 @@
 
 #pragma once
 
+#include <fstats.h>
+
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
+
+// Values of Fmutex.locked
+// Unlocked
+#define FMUTEX_UNLOCKED (0)
+// Locked with no thread sleeping on it
+#define FMUTEX_LOCKED (1)
+// Locked with threads that may be sleeping on it
+#define FMUTEX_CONTENDED (2)
 
 typedef struct fmutex {
     // Linux FUTEX syscall requires a uint32_t*
-    // So, use this uint32_t as a boolean
+    // Holds one of FMUTEX_UNLOCKED, FMUTEX_LOCKED, or FMUTEX_CONTENDED
     _Atomic uint32_t locked;
+
+#ifdef DERT_STATS
+    // When the current holder took the mutex, only touched by the holder
+    uint64_t locked_at;
+
+    Fstats_stripes stats;
+#endif
 } Fmutex;
 
 // Allocates memory for and create
@@ -46,10 +70,26 @@ void fmutex_deinit(Fmutex *mutex);
 void fmutex_destroy(Fmutex *mutex);
 
 // lock mutex
-// forces calling thread to wait if currently locked
+// forces calling thread to wait if currently locked, spinning briefly before sleeping
 // can lead to deadlock
 int fmutex_lock(Fmutex *mutex);
 
+// lock mutex only if that can be done without waiting
+// fails with EBUSY if currently locked
+int fmutex_trylock(Fmutex *mutex);
+
+// lock mutex, waiting no later than abstime, an absolute time on CLOCK_MONOTONIC
+// fails with ETIMEDOUT if mutex was still locked at abstime, and EINVAL if abstime is malformed
+// succeeds without waiting if mutex is unlocked, even when abstime has passed
+int fmutex_timedlock(Fmutex *mutex, const struct timespec *abstime);
+
 // unlock mutex
-// fails if mutex is already unlocked
+// fails with EPERM if mutex is already unlocked
 int fmutex_unlock(Fmutex *mutex);
+
+// Add up the contention stats of mutex into dest
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS
+int fmutex_stats(Fmutex *mutex, Fstats *dest);
+
+// Set the contention stats of mutex to 0
+void fmutex_stats_reset(Fmutex *mutex);
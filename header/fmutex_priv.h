@@ -0,0 +1,55 @@
+/*
+ * fmutex_priv.h -- Mutex data structure implemented using futex.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <fmutex.h>
+#include <fstats.h>
+
+#include <stdatomic.h>
+
+// Number of times fmutex_lock checks whether a held mutex was released before parking in the kernel
+// Enough to cover a short critical section, a few hundred nanoseconds to a couple of microseconds
+#define FMUTEX_SPIN (100)
+
+// Tell the processor the caller is busy waiting so it can save power and yield to a sibling hyperthread
+#if defined(__x86_64__) || defined(__i386__)
+#define FMUTEX_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define FMUTEX_PAUSE() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define FMUTEX_PAUSE() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#ifdef DERT_STATS
+// Record mutex being taken by the calling thread, without waiting or after waiting since name
+#define FMUTEX_STATS_ACQUIRE(mutex) ((mutex)->locked_at = fstats_acquire(&((mutex)->stats), 0))
+#define FMUTEX_STATS_ACQUIRE_CONTENDED(mutex, name) ((mutex)->locked_at = fstats_acquire(&((mutex)->stats), (name)))
+
+// Record mutex being released by its holder, before it is unlocked so that locked_at still belongs to the holder
+// A mutex that was not locked has no holder to record
+#define FMUTEX_STATS_RELEASE(mutex) do { \
+    if(atomic_load_explicit(&((mutex)->locked), memory_order_relaxed) != FMUTEX_UNLOCKED) { \
+        fstats_release(&((mutex)->stats), (mutex)->locked_at); \
+    } \
+} while(0)
+#else
+#define FMUTEX_STATS_ACQUIRE(mutex) do {} while(0)
+#define FMUTEX_STATS_ACQUIRE_CONTENDED(mutex, name) do {} while(0)
+#define FMUTEX_STATS_RELEASE(mutex) do {} while(0)
+#endif
+
+// Sleep until mutex can be taken, leaving it marked FMUTEX_CONTENDED
+// Used by threads that may have been moved onto mutex from elsewhere, which unlock must then wake
+int fmutex_lock_contended(Fmutex *mutex);
+
+// Same as fmutex_lock_contended but gives up with ETIMEDOUT at abstime, NULL means never give up
+int fmutex_lock_contended_until(Fmutex *mutex, const struct timespec *abstime);
+
+// Whether abstime is a time the kernel accepts as a futex timeout
+#define FMUTEX_TIMESPEC_VALID(abstime) ((abstime)->tv_sec >= 0 && (abstime)->tv_nsec >= 0 && (abstime)->tv_nsec < 1000000000)
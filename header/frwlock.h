@@ -0,0 +1,85 @@
+/*
+ * frwlock.h -- Reader-writer lock implemented using futex.
+ * Relies on Linux system calls.
+ *
+ * Any number of readers can hold the lock at once, or a single writer.
+ * Taking the lock for reading while no writer holds it is a single atomic add,
+ * and unlocking only makes a system call when a thread may be sleeping on the lock.
+ * FRWLOCK_KIND_PREFER_WRITER stops new readers from entering while a writer waits,
+ * so a steady stream of readers cannot starve writers.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum frwlock_kind {
+    // Readers enter whenever no writer holds the lock, even if writers are waiting
+    FRWLOCK_KIND_PREFER_READER,
+
+    // Readers wait while any writer holds or waits for the lock
+    FRWLOCK_KIND_PREFER_WRITER
+} Frwlock_kind;
+
+typedef struct frwlock {
+    // Number of readers holding the lock, number of writers waiting, and whether a writer holds the lock
+    _Atomic uint32_t state;
+
+    // Writers sleep on this, changed whenever a waiting writer may be able to take the lock
+    _Atomic uint32_t writer_seq;
+
+    // Number of readers that may be sleeping on state
+    _Atomic uint32_t waiting_readers;
+
+    Frwlock_kind kind;
+} Frwlock;
+
+// Allocates memory for and create
+// Default state is unlocked
+Frwlock *frwlock_create(Frwlock_kind kind);
+
+// Advise how much memory is needed
+size_t frwlock_advise(Frwlock_kind kind);
+
+// Advise for many
+size_t frwlock_advisev(size_t num_locks, Frwlock_kind kind);
+
+// Initialize
+// Default state is unlocked
+int frwlock_init(Frwlock **dest, void *memory, Frwlock_kind kind);
+
+// Initialize for many
+int frwlock_initv(size_t num_locks, Frwlock *dest[], void *memory, Frwlock_kind kind);
+
+// Deinitialize
+void frwlock_deinit(Frwlock *lock);
+
+/*
+ * Destroys a Frwlock that was allocated by frwlock_create.
+ * Please, only use with memory allocated by frwlock_create!
+ */
+void frwlock_destroy(Frwlock *lock);
+
+// lock for reading
+// forces calling thread to wait while a writer holds the lock, or waits for it when FRWLOCK_KIND_PREFER_WRITER
+// fails with EAGAIN if FRWLOCK_READERS_MAX readers already hold the lock
+int frwlock_read_lock(Frwlock *lock);
+
+// unlock after reading
+// fails with EPERM if no reader holds the lock
+int frwlock_read_unlock(Frwlock *lock);
+
+// lock for writing
+// forces calling thread to wait while anyone else holds the lock
+// can lead to deadlock
+int frwlock_write_lock(Frwlock *lock);
+
+// unlock after writing
+// fails with EPERM if no writer holds the lock
+int frwlock_write_unlock(Frwlock *lock);
@@ -0,0 +1,34 @@
+/*
+ * frwlock_priv.h -- Reader-writer lock implemented using futex.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <frwlock.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Layout of Frwlock.state
+// Low 16 bits count readers holding the lock
+#define FRWLOCK_READER (UINT32_C(1))
+#define FRWLOCK_READERS_MASK (UINT32_C(0xffff))
+#define FRWLOCK_READERS_MAX (FRWLOCK_READERS_MASK - 1)
+// Next 15 bits count writers waiting for the lock
+#define FRWLOCK_WAITING_WRITER (UINT32_C(1) << 16)
+#define FRWLOCK_WAITING_WRITERS_MASK (UINT32_C(0x7fff) << 16)
+// Top bit is set while a writer holds the lock
+#define FRWLOCK_WRITER (UINT32_C(1) << 31)
+
+// Whether a reader has to wait when the lock is in state
+bool frwlock_read_blocked(Frwlock *lock, uint32_t state);
+
+// Wake one writer sleeping on writer_seq, if there may be one
+int frwlock_wake_writer(Frwlock *lock);
+
+// Wake every reader sleeping on state, if there may be one
+int frwlock_wake_readers(Frwlock *lock);
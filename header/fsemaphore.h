@@ -2,6 +2,11 @@
  * fsemaphore.h -- Semaphore data structure implemented using futex.
  * Relies on Linux system calls.
  *
+ * Waiting while permits are available and posting are a single compare and swap each, no lock is taken.
+ * Posting only makes a system call when a thread may be sleeping on the semaphore.
+ * Timed variants take an absolute deadline on CLOCK_MONOTONIC, which the kernel enforces while sleeping.
+ * Built with DERT_STATS, each semaphore also counts how often and how long threads waited for permits, see fstats.h.
+ *
  * DERT - Miscellaneous Data Structures Library
  * https://github.com/moretiles/dert
  * Project licensed under Apache-2.0 license
@@ -9,20 +14,34 @@
 
 #pragma once
 
-#include <fmutex.h>
+#include <fstats.h>
 
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 
 typedef struct fsemaphore {
-    Fmutex *mutex;
-    _Atomic uint64_t counter;
-    uint64_t max;
+    // Linux FUTEX syscall requires a uint32_t*
+    // Number of permits available
+    _Atomic uint32_t counter;
+
+    // Number of threads that may be sleeping on counter
+    _Atomic uint32_t waiters;
+
+    // Number of those threads waiting for more than one permit
+    _Atomic uint32_t batch_waiters;
+
+    // Most permits counter can hold
+    uint32_t max;
+
+#ifdef DERT_STATS
+    Fstats_stripes stats;
+#endif
 } Fsemaphore;
 
 // Allocates memory for and create
-// Default state is unlocked
+// val is the starting number of permits, max can be at most UINT32_MAX
 Fsemaphore *fsemaphore_create(uint64_t val, uint64_t max);
 
 // Advise how much memory is needed
@@ -50,12 +69,39 @@ void fsemaphore_destroy(Fsemaphore *sem);
 // Set count for sem to 0
 int fsemaphore_exhaust(Fsemaphore *sem);
 
-// Decreate count for sem by decrement if count is greater than 0
+// Decrease count for sem by 1 if count is greater than 0
 // Else, block until available
 int fsemaphore_wait(Fsemaphore *sem);
 
-// Increment count for sem by increment
+// Decrease count for sem by num_permits once that many are available, taking all of them at once
+// Fails with EINVAL if num_permits is 0 or more than max
+int fsemaphore_wait_n(Fsemaphore *sem, uint32_t num_permits);
+
+// Decrease count for sem by 1 or num_permits only if that can be done without waiting
+// Fails with EAGAIN if not enough permits are available
+int fsemaphore_trywait(Fsemaphore *sem);
+int fsemaphore_trywait_n(Fsemaphore *sem, uint32_t num_permits);
+
+// Decrease count for sem by 1 or num_permits, waiting no later than abstime, an absolute time on CLOCK_MONOTONIC
+// Fails with ETIMEDOUT if not enough permits were available by abstime, and EINVAL if abstime is malformed
+// Succeeds without waiting if enough permits are available, even when abstime has passed
+int fsemaphore_timedwait(Fsemaphore *sem, const struct timespec *abstime);
+int fsemaphore_timedwait_n(Fsemaphore *sem, uint32_t num_permits, const struct timespec *abstime);
+
+// Increase count for sem by 1
+// Fails with EDEADLK if count is already max
 int fsemaphore_post(Fsemaphore *sem);
 
+// Increase count for sem by num_permits
+// Fails with EDEADLK, leaving count unchanged, if that would take count past max
+int fsemaphore_post_n(Fsemaphore *sem, uint32_t num_permits);
+
 // Set count for sem to its max
 int fsemaphore_reset(Fsemaphore *sem);
+
+// Add up the contention stats of sem into dest, a semaphore has no holder so dest->hold_histogram stays empty
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS
+int fsemaphore_stats(Fsemaphore *sem, Fstats *dest);
+
+// Set the contention stats of sem to 0
+void fsemaphore_stats_reset(Fsemaphore *sem);
@@ -0,0 +1,85 @@
+/*
+ * fseqlock.h -- Sequence lock for publishing small structs to many readers.
+ * Relies on Linux system calls.
+ *
+ * Readers never write to the lock, so any number of them can read at once without moving its cache line around.
+ * A reader notes the sequence number before reading and checks it afterwards,
+ * reading again if a writer got in between, which fseqlock_read does for a plain copy.
+ * Writers are serialized by an Fmutex and make the sequence number odd while they are writing.
+ * Best for data that is read far more often than it is written and is cheap to read again.
+ *
+ * Data read between fseqlock_read_begin and fseqlock_read_retry may be torn by a concurrent writer.
+ * It must only be used once fseqlock_read_retry returns false, and must not be followed as a pointer before then.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <fmutex.h>
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct fseqlock {
+    // Incremented when a writer starts and again when it finishes, so odd while a write is in progress
+    _Atomic uint32_t seq;
+
+    // Held by the writer
+    Fmutex mutex;
+} Fseqlock;
+
+// Allocates memory for and create
+// Default state is unlocked
+Fseqlock *fseqlock_create(void);
+
+// Advise how much memory is needed
+size_t fseqlock_advise(void);
+
+// Advise for many
+size_t fseqlock_advisev(size_t num_locks);
+
+// Initialize
+// Default state is unlocked
+int fseqlock_init(Fseqlock **dest, void *memory);
+
+// Initialize for many
+int fseqlock_initv(size_t num_locks, Fseqlock *dest[], void *memory);
+
+// Deinitialize
+void fseqlock_deinit(Fseqlock *lock);
+
+/*
+ * Destroys a Fseqlock that was allocated by fseqlock_create.
+ * Please, only use with memory allocated by fseqlock_create!
+ */
+void fseqlock_destroy(Fseqlock *lock);
+
+// start reading, returning the sequence number to pass to fseqlock_read_retry
+// waits, without sleeping, while a writer is writing
+uint32_t fseqlock_read_begin(Fseqlock *lock);
+
+// finish reading started with fseqlock_read_begin
+// returns true if a writer may have changed the data since, in which case it must be read again
+bool fseqlock_read_retry(Fseqlock *lock, uint32_t start);
+
+// lock for writing
+// forces calling thread to wait while another writer holds the lock, readers never hold it up
+int fseqlock_write_lock(Fseqlock *lock);
+
+// lock for writing only if that can be done without waiting
+// fails with EBUSY if another writer holds the lock
+int fseqlock_write_trylock(Fseqlock *lock);
+
+// unlock after writing
+// fails with EPERM if no writer holds the lock
+int fseqlock_write_unlock(Fseqlock *lock);
+
+// copy size bytes from src, which is protected by lock, to dest, reading again until no writer got in between
+int fseqlock_read(Fseqlock *lock, void *dest, const void *src, size_t size);
+
+// copy size bytes from src to dest, which is protected by lock, while holding lock for writing
+int fseqlock_write(Fseqlock *lock, void *dest, const void *src, size_t size);
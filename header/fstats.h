@@ -0,0 +1,100 @@
+/*
+ * fstats.h -- Opt-in contention accounting for futex locks
+ *
+ * Build everything with DERT_STATS defined to enable.
+ * Otherwise the FSTATS_* macros expand to nothing and locks carry no extra fields.
+ * Each lock keeps its counters in FSTATS_STRIPES cache line sized stripes and every thread updates only one of them,
+ * so threads contending for a lock do not also contend for its counters.
+ * Reading the stats of a lock adds up its stripes, which may be done from any thread at any time.
+ * Stripes are aligned to cache lines, so with DERT_STATS the locks holding them are too.
+ * The *_create functions allocate aligned memory, memory passed to *_init must be aligned for the lock as well.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of stripes each lock spreads its counters over
+#define FSTATS_STRIPES (8)
+
+// Alignment and size granularity of each stripe
+#define FSTATS_CACHE_LINE_SIZE (64)
+
+// Bucket 0 counts holds shorter than 1 nanosecond, bucket i counts holds of [2^(i - 1), 2^i) nanoseconds
+// The last bucket also counts everything longer, from about half a second
+#define FSTATS_HISTOGRAM_BUCKETS (31)
+
+typedef struct fstats {
+    // Number of times the lock was taken
+    uint64_t acquisitions;
+
+    // Number of those times the lock could not be taken straight away
+    uint64_t contended;
+
+    // Number of times a thread went to sleep in the kernel, including waits that timed out
+    uint64_t futex_waits;
+
+    // Nanoseconds spent waiting by contended acquisitions, summed and longest
+    uint64_t wait_ns;
+    uint64_t wait_max_ns;
+
+    // How long the lock was held, by powers of two of nanoseconds
+    // Only kept by locks with an owner, so always empty for Fsemaphore
+    uint64_t hold_histogram[FSTATS_HISTOGRAM_BUCKETS];
+} Fstats;
+
+// One thread's share of the counters of a lock, starting on a cache line and padded to whole cache lines
+struct fstats_stripe {
+    _Alignas(FSTATS_CACHE_LINE_SIZE) _Atomic uint64_t acquisitions;
+    _Atomic uint64_t contended;
+    _Atomic uint64_t futex_waits;
+    _Atomic uint64_t wait_ns;
+    _Atomic uint64_t wait_max_ns;
+    _Atomic uint64_t hold_histogram[FSTATS_HISTOGRAM_BUCKETS];
+};
+
+typedef struct fstats_stripes {
+    struct fstats_stripe stripes[FSTATS_STRIPES];
+} Fstats_stripes;
+
+#ifdef DERT_STATS
+// Start timing a wait for a lock, name is declared as a local variable
+#define FSTATS_WAIT_START(name) const uint64_t name = fstats_now()
+
+// Record taking the lock without waiting
+#define FSTATS_ACQUIRE(stats) fstats_acquire((stats), 0)
+
+// Record taking the lock after waiting since a time started with FSTATS_WAIT_START
+#define FSTATS_ACQUIRE_CONTENDED(stats, name) fstats_acquire((stats), (name))
+
+// Record going to sleep in the kernel
+#define FSTATS_FUTEX_WAIT(stats) fstats_futex_wait((stats))
+#else
+#define FSTATS_WAIT_START(name) do {} while(0)
+#define FSTATS_ACQUIRE(stats) do {} while(0)
+#define FSTATS_ACQUIRE_CONTENDED(stats, name) do {} while(0)
+#define FSTATS_FUTEX_WAIT(stats) do {} while(0)
+#endif
+
+// Nanoseconds from a monotonic clock
+uint64_t fstats_now(void);
+
+// Count an acquisition, contended when wait_start_ns is not 0, and return the time it happened
+uint64_t fstats_acquire(Fstats_stripes *stats, uint64_t wait_start_ns);
+
+// Count a sleep in the kernel
+void fstats_futex_wait(Fstats_stripes *stats);
+
+// Count the lock being held from acquired_ns until now
+void fstats_release(Fstats_stripes *stats, uint64_t acquired_ns);
+
+// Add up every stripe of stats into dest
+void fstats_sum(Fstats_stripes *stats, Fstats *dest);
+
+// Set every counter of stats to 0
+void fstats_clear(Fstats_stripes *stats);
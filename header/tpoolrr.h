@@ -196,6 +196,10 @@ int tpoolrr_handler_call(Tpoolrr *pool, void *arg, void **retval);
 // When freshness is not 0 then this job is allowed to run only if less than expiration milliseconds have passed
 int tpoolrr_jobs_add(Tpoolrr *pool, uint64_t user_tag, void *((*function)(Tpoolrr*,void*)), void *arg, size_t expiration);
 
+// Add one job to the thread at index
+// Fails with EBUSY if that thread does not have a free job space in its queue
+int tpoolrr_jobs_add_to(Tpoolrr *pool, size_t index, uint64_t user_tag, void *((*function)(Tpoolrr*,void*)), void *arg, size_t expiration);
+
 // Add many jobs to the thread_pool
 // When freshness is not 0 then each job added is allowed to run only if less than expiration milliseconds have passed
 // Some among the jobs added may start if they begin before expiration milliseconds have passed while while others die
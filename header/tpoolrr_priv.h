@@ -40,3 +40,6 @@ struct tpoolrr_worker_arg tpoolrr_worker_arg_construct(Tpoolrr *pool, size_t ind
 void *tpoolrr_worker(void *void_arg);
 
 int _tpoolrr_jobs_add(Tpoolrr *pool, struct tpoolrr_job job);
+
+// Enqueue job on the thread at index and wake it, EBUSY if its queue is full
+int _tpoolrr_jobs_add_to(Tpoolrr *pool, size_t index, struct tpoolrr_job job);
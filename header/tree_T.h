@@ -8,6 +8,7 @@
 #pragma once
 
 #include <vqueue.h>
+#include <vallocator.h>
 
 #include <stdint.h>
 #include <stddef.h>
@@ -41,10 +42,14 @@ typedef struct tree_tree {
 
     // Total number of nodes that can be placed on the tree
     size_t max_nodes;
+
+    // Where the tree came from when created by tree_create, NULL means malloc
+    Vallocator *allocator;
 } Tree_tree;
 
 // Standard API
-struct tree_tree *tree_create(size_t max_nodes);
+// tree_create obtains memory from allocator, pass NULL to use malloc
+struct tree_tree *tree_create(size_t max_nodes, Vallocator *allocator);
 size_t tree_advise(size_t max_nodes);
 int tree_init(struct tree_tree **dest, void *memory, size_t max_nodes);
 void tree_deinit(struct tree_tree *tree);
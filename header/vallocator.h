@@ -0,0 +1,79 @@
+/*
+ * vallocator.h -- Allocator interface accepted by containers
+ *
+ * Every container that allocates takes a nullable Vallocator *, passing NULL uses malloc/realloc/free.
+ * When NULL, requests of at least VALLOCATOR_MAP_THRESHOLD bytes instead get their own mapping.
+ * Those grow using mremap so the kernel moves page tables rather than copying bytes (Linux only).
+ * The Vallocator must outlive every container that was given it.
+ * Sizes are passed back on realloc and free so allocators that do not track sizes, like arenas, can be used.
+ * When NULL the size passed back is also what tells a mapping from malloc memory, nothing else is recorded.
+ * It must therefore be exactly the size last requested for the pointer, or the wrong one of free and munmap is used.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <varena.h>
+#include <vpool.h>
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Requests at least this large get their own mapping when no Vallocator is given
+#define VALLOCATOR_MAP_THRESHOLD ((size_t) 1 << 20)
+
+/*
+ * User defined functions for obtaining and releasing memory
+ * ctx is passed unchanged to every function
+ */
+typedef struct vallocator {
+    // Non-null pointer returned on success.
+    void *(*alloc)(void *ctx, size_t num_bytes);
+
+    // Resize memory obtained from alloc, old_bytes is the size last requested for ptr
+    // Non-null pointer returned on success, ptr is left untouched on failure.
+    void *(*realloc)(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes);
+
+    // Release memory obtained from alloc or realloc, num_bytes is the size last requested for ptr
+    void (*free)(void *ctx, void *ptr, size_t num_bytes);
+
+    void *ctx;
+} Vallocator;
+
+// Allocate num_bytes bytes using allocator, or malloc when allocator is NULL
+// Non-null pointer returned on success.
+void *vallocator_alloc(Vallocator *allocator, size_t num_bytes);
+
+// Allocate num_items * elem_size zeroed bytes using allocator, or calloc when allocator is NULL
+// Non-null pointer returned on success.
+void *vallocator_calloc(Vallocator *allocator, size_t num_items, size_t elem_size);
+
+// Resize memory using allocator, or realloc when allocator is NULL
+// old_bytes must be the size last requested for ptr, when allocator is NULL it decides how ptr was obtained
+// Non-null pointer returned on success, ptr is left untouched on failure.
+void *vallocator_realloc(Vallocator *allocator, void *ptr, size_t old_bytes, size_t new_bytes);
+
+// Release memory using allocator, or free when allocator is NULL
+// num_bytes must be the size last requested for ptr, when allocator is NULL it decides between free and munmap
+// Passing NULL for ptr causes nothing to happen
+void vallocator_free(Vallocator *allocator, void *ptr, size_t num_bytes);
+
+// True when growing memory to new_bytes using allocator already leaves the added bytes zeroed
+bool vallocator_grows_zeroed(Vallocator *allocator, size_t new_bytes);
+
+/*
+ * Fill dest so memory comes from the current frame of *arena_ptr
+ * Memory is only released once the frame is disclaimed, realloc extends the newest allocation in place.
+ * Returns 0 on success.
+ */
+int vallocator_varena(Vallocator *dest, Varena **arena_ptr);
+
+/*
+ * Fill dest so memory comes from pool
+ * Requests larger than the elements of pool fail.
+ * Returns 0 on success.
+ */
+int vallocator_vpool(Vallocator *dest, Vpool *pool);
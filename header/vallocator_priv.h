@@ -0,0 +1,27 @@
+/*
+ * vallocator_priv.h -- Allocator interface accepted by containers
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Used when no Vallocator is given and the request is at least VALLOCATOR_MAP_THRESHOLD bytes
+// Mapped memory is always zeroed past the number of bytes last requested
+void *vallocator_map_alloc(size_t num_bytes);
+void *vallocator_map_realloc(void *ptr, size_t old_bytes, size_t new_bytes);
+void vallocator_map_free(void *ptr, size_t num_bytes);
+
+// Functions used by vallocator_varena, ctx is a Varena **
+void *vallocator_varena_alloc(void *ctx, size_t num_bytes);
+void *vallocator_varena_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes);
+void vallocator_varena_free(void *ctx, void *ptr, size_t num_bytes);
+
+// Functions used by vallocator_vpool, ctx is a Vpool *
+void *vallocator_vpool_alloc(void *ctx, size_t num_bytes);
+void *vallocator_vpool_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes);
+void vallocator_vpool_free(void *ctx, void *ptr, size_t num_bytes);
@@ -13,11 +13,53 @@
 
 // All structs that are typedefined are public.
 
+// Controls how to handle when the arena is out of memory
+typedef enum varena_kind {
+    // Total amount of memory cannot change, claims and allocations fail once capacity is reached
+    VARENA_KIND_STATIC,
+
+    // New blocks are linked on demand, each at least double the size of the last
+    // Memory already allocated never moves
+    VARENA_KIND_CHAINED,
+
+    // One contiguous range of address space is reserved up front and pages are committed as allocations reach them
+    // Committed pages above the retain threshold are given back to the operating system on disclaim
+    // Relies on Linux system calls.
+    VARENA_KIND_VIRTUAL,
+
+    // Total amount of memory cannot change, any number of threads may call varena_alloc at once
+    // There are no frames, everything allocated is released together by varena_reset
+    VARENA_KIND_CONCURRENT
+} Varena_kind;
+
+// Default number of bytes a VARENA_KIND_VIRTUAL arena keeps committed after disclaiming
+#define VARENA_VIRTUAL_RETAIN_DEFAULT (1 << 20)
+
+// Bytes a VARENA_KIND_VIRTUAL arena commits at once as allocations advance through a frame
+#define VARENA_VIRTUAL_COMMIT_GRANULE (64 * 1024)
+
+// Bytes each thread takes at once from a VARENA_KIND_CONCURRENT arena and then hands out without atomics
+// Larger allocations go directly to the shared arena
+#define VARENA_CONCURRENT_CHUNK_BYTES (16 * 1024)
+
+// Alignments commonly passed to varena_alloc_aligned
+#define VARENA_CACHE_LINE_SIZE (64)
+#define VARENA_VECTOR_ALIGNMENT (32)
+
+// Allocate num_items items of type from the current frame aligned as type requires
+#define VARENA_ALLOC_ARRAY(arena_ptr, type, num_items) \
+    ((type *) varena_alloc_array((arena_ptr), (num_items), sizeof(type), _Alignof(type)))
+
+// Allocate num_items items of type from the current frame starting on a new cache line
+#define VARENA_ALLOC_ARRAY_CACHE_LINE(arena_ptr, type, num_items) \
+    ((type *) varena_alloc_array((arena_ptr), (num_items), sizeof(type), VARENA_CACHE_LINE_SIZE))
+
 /*
  * Arena that allocates memory in variable length frames.
  */
 typedef struct varena {
     // items stores what we allocate.
+    // When VARENA_KIND_CHAINED this is the newest block.
     void *bytes;
 
     // top of the current stack frame.
@@ -28,13 +70,42 @@ typedef struct varena {
 
     // how many items we can possible store without reallocating.
     size_t capacity;
+
+    // Kind of Varena
+    Varena_kind kind;
+
+    // Total capacity of all blocks before the newest block
+    // Only not 0 when VARENA_KIND_CHAINED
+    size_t chained;
+
+    // Block kept after being released by varena_disclaim so it can be linked again without allocating
+    // Only not NULL when VARENA_KIND_CHAINED
+    struct varena_block *spare;
+
+    // Bytes from the start of the reservation that may be resident
+    // Only used when VARENA_KIND_VIRTUAL
+    size_t committed;
+
+    // Bytes that stay committed after a disclaim, even if no frame uses them
+    // Only used when VARENA_KIND_VIRTUAL
+    size_t retain;
+
+    // Bytes handed out to threads so far
+    // Only used when VARENA_KIND_CONCURRENT
+    _Atomic size_t shared;
+
+    // Unique to this arena until the next varena_reset, invalidates chunks cached by threads
+    // Only used when VARENA_KIND_CONCURRENT
+    uint64_t epoch;
 } Varena;
 
 /*
  * Create new arena of num_bytes bytes.
+ * When VARENA_KIND_CHAINED num_bytes is only the size of the first block.
+ * When VARENA_KIND_VIRTUAL num_bytes is how much address space to reserve, nothing is committed yet.
  * Non-null pointer returned on success.
  */
-Varena *varena_create(size_t num_bytes);
+Varena *varena_create(size_t num_bytes, Varena_kind kind);
 
 /*
  * Destroy existing arena.
@@ -42,18 +113,34 @@ Varena *varena_create(size_t num_bytes);
  */
 void varena_destroy(Varena **arena_ptr);
 
+/*
+ * Release everything allocated from a VARENA_KIND_CONCURRENT arena
+ * No other thread may be allocating from arena while it is reset.
+ * Returns 0 on success.
+ */
+int varena_reset(Varena *arena);
+
+/*
+ * Set how many bytes a VARENA_KIND_VIRTUAL arena keeps committed after disclaiming
+ * Returns 0 on success.
+ */
+int varena_retain(Varena *arena, size_t num_bytes);
+
 /*
  * Return the current number of bytes in-use across the whole arena
+ * Blocks before the newest block count as entirely in-use
  */
 size_t varena_arena_used(Varena *arena);
 
 /*
  * Return the current number of bytes not-in-use across the whole arena
+ * Only space in the newest block is counted
  */
 size_t varena_arena_unused(Varena *arena);
 
 /*
  * Return the current capacity of the whole arena
+ * Includes every block currently linked
  */
 size_t varena_arena_cap(Varena *arena);
 
@@ -69,18 +156,40 @@ size_t varena_frame_unused(Varena *arena);
 
 /*
  * Claim num_bytes bytes from arena and creates a new frame.
+ * When VARENA_KIND_CHAINED a new block is linked if the newest block cannot fit the frame.
+ * When VARENA_KIND_VIRTUAL only the pages holding the frame's bookkeeping are committed.
+ * Fails when VARENA_KIND_CONCURRENT.
  * Returns 0 on success.
  */
 int varena_claim(Varena **arena_ptr, size_t num_bytes);
 
 /*
  * Remove claim on the top frame.
+ * When VARENA_KIND_CHAINED blocks linked since the frame was claimed are freed, or kept to be reused.
+ * When VARENA_KIND_VIRTUAL committed pages beyond the retain threshold are released.
  * Returns 0 on success.
  */
 int varena_disclaim(Varena **arena_ptr);
 
 /*
  * Allocates num_bytes bytes from current arena frame.
+ * When VARENA_KIND_CHAINED the frame continues after itself, or in a new block, if it does not have num_bytes bytes left.
+ * When VARENA_KIND_CONCURRENT memory comes from the whole arena and this may be called by many threads at once.
  * Non-null pointer returned on success.
  */
 void *varena_alloc(Varena **arena_ptr, size_t num_bytes);
+
+/*
+ * Allocates num_bytes bytes from current arena frame starting at an address that is a multiple of alignment.
+ * alignment must be a power of two, bytes skipped to reach it stay part of the frame.
+ * When VARENA_KIND_CHAINED the frame continues after itself, or in a new block, if it does not have enough bytes left.
+ * Non-null pointer returned on success.
+ */
+void *varena_alloc_aligned(Varena **arena_ptr, size_t num_bytes, size_t alignment);
+
+/*
+ * Allocates num_items * elem_size bytes from current arena frame aligned to alignment.
+ * Fails rather than overflowing when num_items * elem_size does not fit in size_t.
+ * Non-null pointer returned on success.
+ */
+void *varena_alloc_array(Varena **arena_ptr, size_t num_items, size_t elem_size, size_t alignment);
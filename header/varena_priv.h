@@ -11,9 +11,97 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <stdbool.h>
+
+// Stored at the end of every frame, describes the arena before the frame was claimed
 struct varena_frame {
     size_t top;
     size_t bottom;
+
+    // Newest block before the frame was claimed
+    void *bytes;
+
+    // Frame was created because a VARENA_KIND_CHAINED frame ran out of space
+    // Disclaiming it must also disclaim the frame below
+    bool continued;
+};
+
+// Frame records are stored at addresses that are a multiple of this
+#define VARENA_FRAME_ALIGNMENT (_Alignof(struct varena_frame))
+
+// Placed before the bytes of every block
+struct varena_block {
+    // Block linked before this one
+    struct varena_block *prev;
+
+    // Number of bytes after this header
+    size_t capacity;
 };
 
 struct varena_frame *varena_frame_top(Varena *arena);
+
+// Largest offset no greater than bottom that places the frame record below it at an aligned address
+size_t varena_frame_align(Varena *arena, size_t bottom);
+
+// Where the top frame starts in the newest block
+size_t varena_frame_start(Varena *arena, struct varena_frame *frame);
+
+// Allocates memory for a block capable of holding capacity bytes
+struct varena_block *varena_block_create(size_t capacity, struct varena_block *prev);
+
+// Get the block bytes belongs to
+struct varena_block *varena_block_of(void *bytes);
+
+// Link a block able to hold at least num_bytes bytes, reusing the spare block if it is large enough
+int varena_chain(Varena *arena, size_t num_bytes);
+
+// Unlink blocks until the newest block is the one holding bytes
+void varena_unchain(Varena *arena, void *bytes);
+
+// Continue the top frame in the rest of the newest block or a new block with room for at least num_bytes bytes
+int varena_frame_continue(Varena *arena, size_t num_bytes);
+
+// Size of pages committed by VARENA_KIND_VIRTUAL
+size_t varena_page_size(void);
+
+// Commit pages so that the first num_bytes bytes of a VARENA_KIND_VIRTUAL arena can be used
+int varena_commit(Varena *arena, size_t num_bytes);
+
+// Commit the pages holding the frame record that ends at bottom, leaving the pages below it to varena_commit
+int varena_commit_record(Varena *arena, size_t bottom);
+
+// Grow the newest allocation of the top frame by num_bytes, committing the pages it reaches
+int varena_bump(Varena *arena, size_t num_bytes);
+
+// Release committed pages of a VARENA_KIND_VIRTUAL arena above both bottom and the retain threshold
+// end is the bottom of the highest frame released, its record may lie beyond the committed pages
+int varena_decommit(Varena *arena, size_t end);
+
+// Bytes needed after top so the next allocation starts at a multiple of alignment
+size_t varena_align_padding(Varena *arena, size_t alignment);
+
+// Chunk of a VARENA_KIND_CONCURRENT arena owned by one thread
+struct varena_local {
+    // Arena and epoch the chunk was taken from, stale once either changes
+    Varena *arena;
+    uint64_t epoch;
+
+    // Offsets into arena->bytes
+    size_t next;
+    size_t end;
+};
+
+// Number of VARENA_KIND_CONCURRENT arenas each thread keeps a chunk for at once
+#define VARENA_LOCAL_SLOTS (4)
+
+// Chunk the calling thread holds for arena, slots are taken over in turn when it holds none
+struct varena_local *varena_local_of(Varena *arena);
+
+// Epoch that has never been given to any arena
+uint64_t varena_epoch_next(void);
+
+// Allocate from a VARENA_KIND_CONCURRENT arena, safe to call from many threads at once
+void *varena_concurrent_alloc(Varena *arena, size_t num_bytes, size_t alignment);
+
+// Take num_bytes bytes from the shared part of a VARENA_KIND_CONCURRENT arena and place their offset in *offset
+int varena_concurrent_take(Varena *arena, size_t num_bytes, size_t *offset);
@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <vallocator.h>
+#include <vstats.h>
+
 #include <stddef.h>
 
 typedef struct varray {
@@ -22,20 +25,56 @@ typedef struct varray {
 
     // total number of elements the Varray can (currently) support
     size_t cap;
+
+    // where elems comes from, NULL means malloc
+    Vallocator *allocator;
+
+    // number of elements that fit directly after the Varray, elems points there until more are needed
+    size_t inline_cap;
+
+#ifdef DERT_STATS
+    Vstats stats;
+#endif
 } Varray;
 
+// Offset from the start of a Varray to its inline elements
+#define VARRAY_INLINE_OFFSET \
+    (((sizeof(Varray) + _Alignof(max_align_t) - 1) / _Alignof(max_align_t)) * _Alignof(max_align_t))
+
+// Declare name as a pointer to memory that holds a Varray with room for inline_cap elem_type elements
+// name must still be initialized using varray_init_inline(name, sizeof(elem_type), inline_cap, allocator)
+#define VARRAY_INLINE(name, elem_type, inline_cap) \
+_Alignas(max_align_t) unsigned char name##_memory[VARRAY_INLINE_OFFSET + (sizeof(elem_type) * (inline_cap))]; \
+Varray *name = (Varray *) name##_memory
+
 // Allocates memory for and initializes an empty Varray
-Varray *varray_create(size_t elem_size);
+// The Varray itself and its elements come from allocator, pass NULL to use malloc
+Varray *varray_create(size_t elem_size, Vallocator *allocator);
+
+// Initializes a Varray whose elements come from allocator, pass NULL to use malloc
+int varray_init(Varray *array, size_t elem_size, Vallocator *allocator);
 
-// Initializes a Varray
-int varray_init(Varray *array, size_t elem_size);
+// Number of bytes needed for a Varray followed by room for inline_cap elements, 0 on overflow
+size_t varray_advise_inline(size_t elem_size, size_t inline_cap);
+
+// Allocates memory for and initializes an empty Varray with room for inline_cap elements directly after it
+// Only one allocation is made until more than inline_cap elements are stored
+Varray *varray_create_inline(size_t elem_size, size_t inline_cap, Vallocator *allocator);
+
+/*
+ * Initializes a Varray in memory of at least varray_advise_inline(elem_size, inline_cap) bytes.
+ * The first inline_cap elements are stored in that same memory, only when more are needed do elements move to allocator.
+ * Shrinking to inline_cap elements or less moves them back.
+ * Because elems points into the Varray itself, an inline Varray must not be copied or moved once initialized.
+ */
+int varray_init_inline(Varray *array, size_t elem_size, size_t inline_cap, Vallocator *allocator);
 
 // Deinitializes a Varray
 void varray_deinit(Varray *array);
 
 /*
- * Destroys a Varray that was allocated by varray_create.
- * Please, only use with memory allocated by varray_create!
+ * Destroys a Varray that was allocated by varray_create or varray_create_inline.
+ * Please, only use with memory allocated by varray_create or varray_create_inline!
  */
 void varray_destroy(Varray *array);
 
@@ -52,14 +91,33 @@ void *varray_get_direct(Varray *array, size_t pos);
 // Copies the element at src to pos of array.
 int varray_set(Varray *array, size_t pos, void *src);
 
-// Resize varray (does not reallocate memory)
+// Resize varray, capacity grows geometrically when new_size does not fit
 int varray_resize(Varray *array, size_t new_size);
 
 // Reallocate memory required for varray (does reallocate memory)
 int varray_realloc(Varray *array, size_t new_size);
 
+// Copy src to a new element after the last element, amortized O(1).
+int varray_push(Varray *array, void *src);
+
+// Copy the last element to dest, unless dest is NULL, and remove it.
+int varray_pop(Varray *array, void *dest);
+
+// Copy num_elems elements from src to after the last element, amortized O(num_elems).
+int varray_append_many(Varray *array, void *src, size_t num_elems);
+
+// Make sure at least num_elems elements fit without reallocating, does not change the length.
+int varray_reserve(Varray *array, size_t num_elems);
+
+// Reallocate so the capacity is exactly the current length.
+int varray_shrink_to_fit(Varray *array);
+
 // Provide the current number of positions at which elements can be stored.
 size_t varray_len(Varray *array);
 
 // Provide the cap for number of elements that can currently be stored without resizing.
 size_t varray_cap(Varray *array);
+
+// Copy the memory stats of array to dest.
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS.
+int varray_stats(Varray *array, Vstats *dest);
@@ -0,0 +1,60 @@
+/*
+ * varray_parallel.h -- Run for-each, map, and reduce over a Varray using a Tpoolrr
+ *
+ * The Varray is split into chunks of consecutive elements and each chunk is submitted to the pool as one job.
+ * Functions are given a whole chunk at a time so the cost of a job is paid once per chunk and not per element.
+ * Chunks hold a multiple of 64 bytes and, after the first, start on a 64 byte boundary of the Varray being written.
+ * Two workers then never write the same cache line, unless the element size makes no element start on one.
+ *
+ * The calling thread waits until every chunk is done before returning.
+ * Each worker is given at most pool->jobs_per_thread chunks at once so that its completion queue cannot overflow.
+ * The pool must be active and must not have other queued jobs or unpopped completions.
+ * Passing a NULL pool runs every chunk on the calling thread.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <varray.h>
+#include <tpoolrr.h>
+
+#include <stddef.h>
+
+// Called for num_elems consecutive elements starting at first, pos is the position of first in the Varray
+typedef void (*Varray_parallel_fn)(void *first, size_t pos, size_t num_elems, void *ctx);
+
+// Called for num_elems consecutive elements of src starting at src_first
+// dest_first is the element at the same position in dest
+typedef void (*Varray_parallel_map_fn)(void *dest_first, void *src_first, size_t pos, size_t num_elems, void *ctx);
+
+// Fold num_elems consecutive elements starting at first into acc
+typedef void (*Varray_parallel_fold_fn)(void *acc, void *first, size_t pos, size_t num_elems, void *ctx);
+
+// Combine other into acc, where both were produced by a Varray_parallel_fold_fn
+typedef void (*Varray_parallel_combine_fn)(void *acc, void *other, void *ctx);
+
+/*
+ * Call fn once for each chunk of array using pool
+ * grain is the minimum number of elements in a chunk, pass 0 to pick one based on the number of threads.
+ * Returns 0 on success.
+ */
+int varray_parallel_for(Varray *array, Tpoolrr *pool, size_t grain, Varray_parallel_fn fn, void *ctx);
+
+/*
+ * Resize dest to the length of src and call fn once for each chunk of src using pool
+ * dest and src may have different element sizes but must not be the same Varray.
+ * Returns 0 on success.
+ */
+int varray_parallel_map(Varray *dest, Varray *src, Tpoolrr *pool, size_t grain, Varray_parallel_map_fn fn, void *ctx);
+
+/*
+ * Fold every chunk of array into its own accumulator of acc_size bytes starting as a copy of identity
+ * The accumulators are then combined into dest, which also starts as a copy of identity, in order of position.
+ * The result is therefore the same from run to run even when combine is not commutative.
+ * Returns 0 on success.
+ */
+int varray_parallel_reduce(Varray *array, Tpoolrr *pool, size_t grain, size_t acc_size, void *identity,
+                           Varray_parallel_fold_fn fold, Varray_parallel_combine_fn combine, void *ctx, void *dest);
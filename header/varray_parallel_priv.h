@@ -0,0 +1,75 @@
+/*
+ * varray_parallel_priv.h -- Run for-each, map, and reduce over a Varray using a Tpoolrr
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <varray.h>
+#include <tpoolrr.h>
+
+#include <stddef.h>
+
+// Chunks are sized so that each one starts this many bytes after the previous one, or a multiple of it
+#define VARRAY_PARALLEL_CACHE_LINE_SIZE (64)
+
+// Number of chunks given to each thread when no grain is requested
+#define VARRAY_PARALLEL_CHUNKS_PER_THREAD (4)
+
+enum varray_parallel_kind {
+    VARRAY_PARALLEL_KIND_FOR,
+    VARRAY_PARALLEL_KIND_MAP,
+    VARRAY_PARALLEL_KIND_REDUCE
+};
+
+// Shared by every chunk of one call
+struct varray_parallel_task {
+    enum varray_parallel_kind kind;
+    Varray *array;
+
+    // Only used by VARRAY_PARALLEL_KIND_MAP
+    Varray *dest;
+
+    union {
+        Varray_parallel_fn for_fn;
+        Varray_parallel_map_fn map_fn;
+        Varray_parallel_fold_fn fold_fn;
+    };
+    void *ctx;
+};
+
+// Argument of one job
+struct varray_parallel_chunk {
+    struct varray_parallel_task *task;
+    size_t pos;
+    size_t num_elems;
+
+    // Only used by VARRAY_PARALLEL_KIND_REDUCE
+    void *acc;
+};
+
+// Smallest number of elements whose total size is a multiple of VARRAY_PARALLEL_CACHE_LINE_SIZE
+size_t varray_parallel_unit(Varray *array);
+
+// Number of elements before the first one that starts on a cache line, 0 if no element does
+size_t varray_parallel_head(Varray *array);
+
+// Number of elements in each chunk, a multiple of what keeps chunks VARRAY_PARALLEL_CACHE_LINE_SIZE apart
+size_t varray_parallel_grain(Varray *array, Tpoolrr *pool, size_t grain);
+
+// Split task into chunks and run them
+// For reductions each chunk folds into its own accumulator, which are then combined into dest
+int varray_parallel_run(struct varray_parallel_task *task, Tpoolrr *pool, size_t grain,
+                        size_t acc_size, void *identity, Varray_parallel_combine_fn combine, void *dest);
+
+// Submit every chunk to pool and wait until all of them are done
+int varray_parallel_dispatch(Tpoolrr *pool, struct varray_parallel_chunk *chunks, size_t num_chunks);
+
+// Run a single chunk
+void varray_parallel_chunk_run(struct varray_parallel_chunk *chunk);
+
+// Tpoolrr job wrapping varray_parallel_chunk_run
+void *varray_parallel_job(Tpoolrr *pool, void *arg);
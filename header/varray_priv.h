@@ -11,8 +11,24 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+// Smallest capacity allocated once elements are pushed or appended
+#define VARRAY_MIN_CAP (8)
+
 // Append increase new elements to the end of the Varray.
 int varray_grow(Varray *array, size_t increase);
 
 // Remove decreate existing elements from the end of the Varray.
 int varray_shrink(Varray *array, size_t decrease);
+
+// Capacity, doubling from the current capacity, that fits at least num_elems elements.
+size_t varray_cap_next(Varray *array, size_t num_elems);
+
+// Reallocate so the capacity is exactly new_cap elements, new elements are zeroed.
+int varray_cap_set(Varray *array, size_t new_cap);
+
+// Address of the inline elements of array, NULL when it has none
+void *varray_inline_elems(Varray *array);
+
+// Move elements to storage for new_cap elements, inline storage is used whenever new_cap is inline_cap
+// Returns the new value of elems, which is NULL on failure unless new_cap is 0
+void *varray_elems_resize(Varray *array, size_t new_cap);
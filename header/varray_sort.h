@@ -0,0 +1,36 @@
+/*
+ * varray_sort.h -- Sort the elements of a Varray by a fixed width key stored inside each element
+ *
+ * Elements are ordered by key_width bytes found key_offset bytes into each element.
+ * Large arrays are sorted using an LSD radix sort, one pass per key byte, using a temporary copy of the elements.
+ * Passes over key bytes that are the same for every element are skipped.
+ * Small arrays are sorted using a branch-free sorting network over extracted keys.
+ * Sorting is stable, elements with equal keys keep their relative order.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <varray.h>
+
+#include <stddef.h>
+
+// How the bytes of a key are compared
+// UNSIGNED keys are unsigned integers of 1 to 8 bytes stored in native byte order
+// SIGNED keys are two's complement integers of 1 to 8 bytes stored in native byte order
+// BYTES keys of any width are compared like memcmp
+enum varray_sort_key {
+    VARRAY_SORT_KEY_UNSIGNED,
+    VARRAY_SORT_KEY_SIGNED,
+    VARRAY_SORT_KEY_BYTES
+};
+
+/*
+ * Sort array in ascending order of the key_width byte key at key_offset in each element
+ * Temporary memory comes from the allocator of array.
+ * Returns 0 on success.
+ */
+int varray_sort(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind);
@@ -0,0 +1,42 @@
+/*
+ * varray_sort_priv.h -- Sort the elements of a Varray by a fixed width key stored inside each element
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <varray.h>
+#include <varray_sort.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Arrays with at most this many elements are sorted using a sorting network, must be a power of two
+#define VARRAY_SORT_NETWORK_MAX (32)
+
+// Number of values a single key byte can take
+#define VARRAY_SORT_RADIX (256)
+
+// Sort using one counting sort pass for every key byte, starting from the least significant
+int varray_sort_radix(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind);
+
+// Sort at most VARRAY_SORT_NETWORK_MAX elements with keys of at most 8 bytes using a sorting network
+void varray_sort_network(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind);
+
+// Sort at most VARRAY_SORT_NETWORK_MAX elements with keys of any width using insertion sort
+void varray_sort_insertion(Varray *array, size_t key_offset, size_t key_width);
+
+// Offset of the digit'th least significant byte of a key from the start of the key
+size_t varray_sort_digit_offset(size_t key_width, enum varray_sort_key kind, size_t digit);
+
+// Key at key_offset in elem as an unsigned integer that orders the same way as the key
+uint64_t varray_sort_key_load(void *elem, size_t key_offset, size_t key_width, enum varray_sort_key kind);
+
+// Copy an element, faster than memcpy for common element sizes
+void varray_sort_copy(void *dest, void *src, size_t elem_size);
+
+// Exchange two elements
+void varray_sort_swap(void *a, void *b, size_t elem_size);
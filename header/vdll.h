@@ -1,6 +1,16 @@
 /*
  * vdll.h -- Doubly linked list for an arbitrary type
  *
+ * VDLL_KIND_NODE lists allocate one node per element.
+ * VDLL_KIND_UNROLLED lists pack many elements into each node of about VDLL_UNROLLED_NODE_BYTES bytes.
+ * Walking to a position then touches one node per node's worth of elements instead of one node per element.
+ * Inserting into or deleting from an unrolled list moves the other elements of the affected nodes.
+ *
+ * Lists created without an allocator draw their nodes from a Vpool owned by the list.
+ * vdll_index_enable adds a skip list over the nodes so that reaching a position far from the last one used
+ * takes a logarithmic number of steps instead of walking every node in between.
+ * The index costs one entry for about every fourth node and some work on every insert and delete.
+ *
  * DERT - Miscellaneous Data Structures Library
  * https://github.com/moretiles/dert
  * Project licensed under Apache-2.0 license
@@ -8,8 +18,21 @@
 
 #pragma once
 
+#include <vallocator.h>
+
 #include <stddef.h>
 
+typedef enum vdll_kind {
+    // Every element has its own node
+    VDLL_KIND_NODE,
+
+    // Nodes hold as many elements as fit in VDLL_UNROLLED_NODE_BYTES bytes, and at least 2
+    VDLL_KIND_UNROLLED
+} Vdll_kind;
+
+// Target size of a node of a VDLL_KIND_UNROLLED list, a multiple of the cache line size
+#define VDLL_UNROLLED_NODE_BYTES (256)
+
 /*
  * User defined functions for allocating and deallocating individual elements
  */
@@ -20,12 +43,27 @@ typedef struct vdll_functions {
 
 typedef struct vdll {
     // Ptr to node at current position.
+    // Only used when VDLL_KIND_NODE.
 	struct vdll_node *ptr;
 
+    // Ptr to the node the last access went through.
+    // Only used when VDLL_KIND_UNROLLED.
+	struct vdll_unrolled_node *chunk;
+
+    // First and last nodes.
+    // Only used when VDLL_KIND_UNROLLED.
+	struct vdll_unrolled_node *head;
+	struct vdll_unrolled_node *tail;
+
+    // Number of elements that fit in each node.
+    // Only used when VDLL_KIND_UNROLLED.
+	size_t chunk_cap;
+
     // Size of individual elements.
 	size_t elem_size;
 
     // Current position into linked list.
+    // When VDLL_KIND_UNROLLED this is the position of the first element of chunk.
 	size_t pos;
     
     // Total number of elements stored in linked list.
@@ -33,13 +71,27 @@ typedef struct vdll {
 
     // Functions used for initializing and deinitializing elements.
 	struct vdll_functions *functions;
+
+    // Where nodes come from, NULL means pool.
+	Vallocator *allocator;
+
+    // Nodes come from here when allocator is NULL, created once the first node is needed.
+	struct vpool *pool;
+
+    // Skip list over the nodes, NULL unless vdll_index_enable was called.
+	struct vdll_index *index;
+
+    // How elements are placed in nodes.
+	Vdll_kind kind;
 } Vdll;
 
 // Allocates memory for and initializes a Vdll
-Vdll *vdll_create(size_t elem_size, Vdll_functions *functions);
+// The Vdll itself and its nodes come from allocator
+// Pass NULL to allocate the Vdll with malloc and its nodes from a Vpool owned by the list
+Vdll *vdll_create(size_t elem_size, Vdll_kind kind, Vdll_functions *functions, Vallocator *allocator);
 
-// Initializes a Vdll
-int vdll_init(Vdll *dll, size_t elem_size, Vdll_functions *functions);
+// Initializes a Vdll whose nodes come from allocator, pass NULL to use a Vpool owned by the list
+int vdll_init(Vdll *dll, size_t elem_size, Vdll_kind kind, Vdll_functions *functions, Vallocator *allocator);
 
 // Denitializes a Vdll
 void vdll_deinit(Vdll *dll);
@@ -56,7 +108,8 @@ int vdll_get(Vdll *dll, size_t pos, void *dest);
 /*
  * Get the memory address of the element at pos in dll.
  * Should be used carefully as further delete/shrink operations can destroy associated memory.
- * Thus, storing the pointer returned from this across delete/shrink operations almost always introduces a bug!
+ * When VDLL_KIND_UNROLLED insert/grow operations can also move elements.
+ * Thus, storing the pointer returned from this across such operations almost always introduces a bug!
  */
 void *vdll_get_direct(Vdll *dll, size_t pos);
 
@@ -66,7 +119,7 @@ int vdll_set(Vdll *dll, size_t pos, void *src);
 // Get current number of elements stored in dll.
 size_t vdll_len(Vdll *dll);
 
-// Create num_elems new elements shifting elements at pos to after the new elements.
+// Create num_elems new elements directly after the element at pos, or at the start when dll is empty.
 int vdll_insert(Vdll *dll, size_t pos, size_t num_elems);
 
 // Delete elements from pos to (pos + num_elems - 1) in dll.
@@ -77,3 +130,10 @@ int vdll_grow(Vdll *dll, size_t num_elems);
 
 // Remove the num_elems last elements from dll.
 int vdll_shrink(Vdll *dll, size_t num_elems);
+
+// Start keeping a skip list over the nodes of dll, making access to distant positions logarithmic.
+// Does nothing if dll already has one.
+int vdll_index_enable(Vdll *dll);
+
+// Stop keeping and free the skip list over the nodes of dll.
+void vdll_index_disable(Vdll *dll);
@@ -8,27 +8,85 @@
 
 #pragma once
 
+#include <vallocator.h>
+
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+// Number of nodes the pool of a list created without an allocator starts with
+#define VDLL_POOL_INITIAL_NODES (64)
+
+// Levels of the skip list, each holding about a quarter of the entries of the one below
+#define VDLL_INDEX_MAX_HEIGHT (16)
+
+// Positions within this many nodes of the current one are reached by walking instead of through the index
+#define VDLL_INDEX_WALK_MAX (32)
+
+// Starting state of the generator picking the height of index entries
+#define VDLL_INDEX_SEED (0x9e3779b97f4a7c15ULL)
+
 typedef struct vdll_node {
     void *data;
     struct vdll_node *prev;
     struct vdll_node *next;
 } Vdll_node;
 
+// Node of a VDLL_KIND_UNROLLED list, count elements follow at VDLL_UNROLLED_HEADER_BYTES
+typedef struct vdll_unrolled_node {
+    struct vdll_unrolled_node *prev;
+    struct vdll_unrolled_node *next;
+    size_t count;
+} Vdll_unrolled_node;
+
+// Offset of the elements of a Vdll_unrolled_node
+#define VDLL_UNROLLED_HEADER_BYTES (((sizeof(Vdll_unrolled_node) + 15) / 16) * 16)
+
+struct vdll_index_link {
+    // Next entry on this level, NULL when last
+    struct vdll_index_entry *next;
+
+    // Elements from the first element covered by the owner of this link to the first covered by next,
+    // or to the end of the list when next is NULL
+    size_t width;
+};
+
+// Stands for one node of the list on the lowest height levels of the index
+typedef struct vdll_index_entry {
+    // Vdll_node or Vdll_unrolled_node, which must hold at least one element
+    void *node;
+
+    size_t height;
+    struct vdll_index_link links[];
+} Vdll_index_entry;
+
+typedef struct vdll_index {
+    // State of the xorshift generator picking the height of entries
+    uint64_t random;
+
+    // Links of a sentinel placed at position 0 before every entry
+    struct vdll_index_link head[VDLL_INDEX_MAX_HEIGHT];
+} Vdll_index;
+
+// Allocate num_bytes for a node of dll from its allocator, or from its pool when it has none
+// Every node of a list must be the same size
+void *vdll_node_alloc(Vdll *dll, size_t num_bytes);
+
+// Return a node obtained from vdll_node_alloc
+void vdll_node_free(Vdll *dll, void *node, size_t num_bytes);
+
 /*
  * Allocates memory for and initializes a Vdll_node.
  * Memory for node is zeroed out and then initialized.
  * If init is NULL then no initialization performed after zeroing out.
  */
-Vdll_node *vdll_node_create(size_t elem_size, int (*init)(void *arg));
+Vdll_node *vdll_node_create(Vdll *dll, int (*init)(void *arg));
 
 /*
  * Destroys a Vdll_node that was allocated by vdll_node_create.
  * Please, only use with memory allocated by vdll_node_create!
  */
-int vdll_node_destroy(Vdll_node *node, size_t elem_size, int (*deinit)(void *arg));
+int vdll_node_destroy(Vdll *dll, Vdll_node *node, int (*deinit)(void *arg));
 
 /*
  * Seek to specific positon in linked list.
@@ -48,3 +106,64 @@ int vdll_rewind(Vdll *dll, size_t increment);
 
 // Control whether to insert before or after
 int _vdll_insert(Vdll *dll, size_t pos, size_t num_elems, bool after);
+
+// Number of elements each node of an unrolled list with elements of elem_size bytes holds
+size_t vdll_unrolled_node_cap(size_t elem_size);
+
+// Allocate an empty unrolled node, elements are neither zeroed nor initialized
+Vdll_unrolled_node *vdll_unrolled_node_create(Vdll *dll);
+
+// Free an unrolled node without deinitializing its elements
+void vdll_unrolled_node_destroy(Vdll *dll, Vdll_unrolled_node *node);
+
+// Address of the element at index within node
+void *vdll_unrolled_elem(Vdll *dll, Vdll_unrolled_node *node, size_t index);
+
+// Zero and initialize num_elems elements starting at first
+void vdll_unrolled_elems_init(Vdll *dll, void *first, size_t num_elems);
+
+// Deinitialize num_elems elements starting at first
+void vdll_unrolled_elems_deinit(Vdll *dll, void *first, size_t num_elems);
+
+// Link node directly after prev, or at the start when prev is NULL
+void vdll_unrolled_link(Vdll *dll, Vdll_unrolled_node *prev, Vdll_unrolled_node *node);
+
+// Remove node from the list without freeing it
+void vdll_unrolled_unlink(Vdll *dll, Vdll_unrolled_node *node);
+
+// Make dll->chunk the node holding the element at pos, starting from whichever of head, tail, or chunk is closest
+int vdll_unrolled_seek(Vdll *dll, size_t pos);
+
+// Create num_elems new elements so that the first of them is at index, 0 <= index <= length
+int vdll_unrolled_insert(Vdll *dll, size_t index, size_t num_elems);
+
+// Delete the elements from index to (index + num_elems - 1)
+int vdll_unrolled_delete(Vdll *dll, size_t index, size_t num_elems);
+
+// Deinitialize every element and free every node
+void vdll_unrolled_clear(Vdll *dll);
+
+// Pick the number of levels a new index entry is part of, 0 meaning it gets no entry
+size_t vdll_index_height(Vdll_index *index);
+
+// For every level, the link of the last entry before pos and that entry's position
+void vdll_index_path(Vdll_index *index, size_t pos, struct vdll_index_link **path, size_t *path_pos);
+
+// Last entry at or before pos, NULL when there is none
+Vdll_index_entry *vdll_index_find(Vdll_index *index, size_t pos, size_t *entry_pos);
+
+/*
+ * Record that node, whose elements are not yet accounted for, now starts at pos and holds count elements.
+ * The nodes at and after pos are treated as coming after node.
+ * Running out of memory only leaves node without an entry.
+ */
+void vdll_index_add(Vdll *dll, void *node, size_t pos, size_t count);
+
+// Record that node, which starts at pos and held count elements, left the list
+void vdll_index_remove(Vdll *dll, void *node, size_t pos, size_t count);
+
+// Record that the node starting at pos went from holding old_count to new_count elements
+void vdll_index_adjust(Vdll *dll, size_t pos, size_t old_count, size_t new_count);
+
+// Free every entry, leaving an index over an empty list
+void vdll_index_clear(Vdll *dll);
@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <vallocator.h>
+#include <vstats.h>
+
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -36,7 +39,12 @@ typedef struct vht {
      */
     size_t cap;
 
-    //also need functions
+    // where keys and vals come from, NULL means malloc.
+    Vallocator *allocator;
+
+#ifdef DERT_STATS
+    Vstats stats;
+#endif
 } Vht;
 
 typedef struct vht_iterator {
@@ -44,10 +52,11 @@ typedef struct vht_iterator {
 } Vht_iterator;
 
 // Allocates memory for and initializes a Vht.
-Vht *vht_create(size_t key_size, size_t val_size);
+// The Vht itself, keys, and vals come from allocator, pass NULL to use malloc.
+Vht *vht_create(size_t key_size, size_t val_size, Vallocator *allocator);
 
 // Initializes a Vht.
-int vht_init(Vht *table, size_t key_size, size_t val_size);
+int vht_init(Vht *table, size_t key_size, size_t val_size, Vallocator *allocator);
 
 // Deinitializes a Vht.
 void vht_deinit(Vht *table);
@@ -83,6 +92,10 @@ int vht_iterate_next(Vht *table, Vht_iterator *iterator, void *dest_key, void *d
 // Get number of keys that have associated values in table
 size_t vht_len(Vht *table);
 
+// Copy the memory stats of table to dest.
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS.
+int vht_stats(Vht *table, Vstats *dest);
+
 #ifdef __cplusplus
 }
 #endif
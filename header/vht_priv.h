@@ -66,10 +66,10 @@ void *vht_hash_val(Vht *table, uint32_t offset);
 int vht_double(Vht *table_ptr);
 
 // Vht_create with parameterized starting number of elements.
-Vht *_vht_create(size_t key_size, size_t val_size, size_t num_elems);
+Vht *_vht_create(size_t key_size, size_t val_size, size_t num_elems, Vallocator *allocator);
 
 // Vht_init with parameterized starting number of elements.
-int _vht_init(Vht *table, size_t key_size, size_t val_size, size_t num_elems);
+int _vht_init(Vht *table, size_t key_size, size_t val_size, size_t num_elems, Vallocator *allocator);
 
 // Current cap of table
 size_t vht_cap(Vht *table);
@@ -0,0 +1,101 @@
+/*
+ * vilist.h -- Intrusive doubly linked list
+ *
+ * Elements embed a Vilist_link and are linked in place, nothing is copied or allocated by the list.
+ * The same element can be on several lists at once by embedding one link per list.
+ * A list is a circular chain through a sentinel link, so moving any run of elements between lists,
+ * or within one list, only rewrites the links at its ends.
+ * The list does not keep a count because that would make splicing a run proportional to its length.
+ *
+ * Links must be zeroed or passed to vilist_link_init before they are first linked.
+ * Linking an element that is already on a list fails rather than corrupting either list.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct vilist_link {
+    // NULL when not on a list, otherwise neighbours, which are the sentinel at either end
+    struct vilist_link *prev;
+    struct vilist_link *next;
+} Vilist_link;
+
+typedef struct vilist {
+    // Sentinel, head.next is the first element and head.prev the last
+    Vilist_link head;
+} Vilist;
+
+// Address of the element of type type whose field member is the link at link_ptr
+#define VILIST_ENTRY(link_ptr, type, member) ((type *) (((char *) (link_ptr)) - offsetof(type, member)))
+
+// Allocates memory for and initializes a Vilist
+Vilist *vilist_create(void);
+
+// Initializes an empty Vilist
+int vilist_init(Vilist *list);
+
+// Unlinks every element and deinitializes a Vilist, the elements themselves are untouched
+void vilist_deinit(Vilist *list);
+
+/*
+ * Destroys a Vilist that was allocated by vilist_create.
+ * Please, only use with memory allocated by vilist_create!
+ */
+void vilist_destroy(Vilist *list);
+
+// Mark link as not being on any list
+void vilist_link_init(Vilist_link *link);
+
+// Whether link is currently on a list
+bool vilist_linked(Vilist_link *link);
+
+// Whether list holds no elements
+bool vilist_empty(Vilist *list);
+
+// Number of elements in list, walks every element
+size_t vilist_len(Vilist *list);
+
+// First or last element of list, NULL when empty
+Vilist_link *vilist_first(Vilist *list);
+Vilist_link *vilist_last(Vilist *list);
+
+// Element after or before link in list, NULL at either end
+Vilist_link *vilist_next(Vilist *list, Vilist_link *link);
+Vilist_link *vilist_prev(Vilist *list, Vilist_link *link);
+
+// Link an element that is on no list at the start or end of list
+int vilist_push_front(Vilist *list, Vilist_link *link);
+int vilist_push_back(Vilist *list, Vilist_link *link);
+
+// Unlink and return the first or last element of list, NULL when empty
+Vilist_link *vilist_pop_front(Vilist *list);
+Vilist_link *vilist_pop_back(Vilist *list);
+
+// Link an element that is on no list directly before or after pos, which must be on a list
+int vilist_insert_before(Vilist_link *pos, Vilist_link *link);
+int vilist_insert_after(Vilist_link *pos, Vilist_link *link);
+
+// Unlink link from whatever list it is on
+int vilist_remove(Vilist_link *link);
+
+/*
+ * Move the run of elements from first to last, inclusive, so that it sits directly after pos.
+ * first and last must be on the same list with last at or after first.
+ * pos may be on any list, including the one being taken from, as long as it is not inside the run.
+ * Pass &(list->head) as pos to move the run to the start of list.
+ * Takes constant time no matter how long the run is.
+ */
+int vilist_splice(Vilist_link *pos, Vilist_link *first, Vilist_link *last);
+
+// Move every element of src to the start or end of dest, leaving src empty
+int vilist_splice_front(Vilist *dest, Vilist *src);
+int vilist_splice_back(Vilist *dest, Vilist *src);
+
+// Move link and every element after it in src to the end of dest
+int vilist_split(Vilist *dest, Vilist *src, Vilist_link *link);
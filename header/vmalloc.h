@@ -0,0 +1,45 @@
+/*
+ * vmalloc.h -- General purpose allocator built out of size class Vpools with per-thread caches
+ * Relies on Linux system calls.
+ *
+ * Small allocations are served from one VPOOL_KIND_GUIDED pool per size class that is extended using mmap.
+ * Each thread keeps a short stack of free blocks for every size class so most calls never touch a lock.
+ * Allocations larger than the largest size class are given their own mapping and grow using mremap.
+ * Memory obtained for size classes is reused but never returned to the operating system.
+ *
+ * Building with VMALLOC_SHIM defined (make libdert_malloc.so) additionally exports malloc, free, calloc,
+ * realloc, posix_memalign, aligned_alloc, memalign, valloc, pvalloc, and malloc_usable_size.
+ * The resulting shared object can then be loaded into an existing program using LD_PRELOAD.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Allocate num_bytes bytes aligned to at least 16 bytes
+// Non-null pointer returned on success.
+void *vmalloc_alloc(size_t num_bytes);
+
+// Allocate num_items * elem_size zeroed bytes
+// Non-null pointer returned on success.
+void *vmalloc_calloc(size_t num_items, size_t elem_size);
+
+// Resize an allocation, moving it if needed
+// Non-null pointer returned on success, ptr is left untouched on failure.
+void *vmalloc_realloc(void *ptr, size_t num_bytes);
+
+// Allocate num_bytes bytes aligned to alignment and place the result in *dest
+// alignment must be a power of two and a multiple of sizeof(void*)
+// Returns 0 on success.
+int vmalloc_aligned(void **dest, size_t alignment, size_t num_bytes);
+
+// Free memory obtained from any vmalloc function
+// Passing NULL causes nothing to happen
+void vmalloc_free(void *ptr);
+
+// Number of bytes that can actually be used at ptr
+size_t vmalloc_usable(void *ptr);
@@ -0,0 +1,115 @@
+/*
+ * vmalloc_priv.h -- General purpose allocator built out of size class Vpools with per-thread caches
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <vpool.h>
+#include <fmutex.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Every pointer handed out is aligned to this many bytes
+#define VMALLOC_ALIGNMENT (16)
+
+// Largest block (header included) served from a size class
+#define VMALLOC_CLASS_MAX_BYTES (32768)
+
+// Blocks up to this many bytes (header included) find their size class with a table lookup
+#define VMALLOC_SMALL_BYTES (1024)
+
+// 16 byte steps up to 128 bytes then four classes for every power of two up to VMALLOC_CLASS_MAX_BYTES
+#define VMALLOC_NUM_CLASSES (39)
+
+// Number of free blocks each thread may hold on to for each size class
+#define VMALLOC_CACHE_DEPTH (32)
+
+// Size of the mapping used whenever a size class runs out of blocks
+#define VMALLOC_CHUNK_BYTES (1 << 20)
+
+// Vpool places items directly after itself so the pool is shifted to keep items aligned
+#define VMALLOC_POOL_PADDING ((VMALLOC_ALIGNMENT - (sizeof(Vpool) % VMALLOC_ALIGNMENT)) % VMALLOC_ALIGNMENT)
+
+// Markers stored in vmalloc_header.class_index for blocks not owned by a size class
+#define VMALLOC_CLASS_LARGE (UINT32_MAX)
+#define VMALLOC_CLASS_ALIGNED (UINT32_MAX - 1)
+
+// Placed directly before every pointer returned to the user
+struct vmalloc_header {
+    // Size class the block came from or one of VMALLOC_CLASS_LARGE/VMALLOC_CLASS_ALIGNED
+    uint32_t class_index;
+
+    // Keeps bytes 8 byte aligned on every platform
+    uint32_t unused;
+
+    // VMALLOC_CLASS_LARGE: length of the mapping
+    // VMALLOC_CLASS_ALIGNED: distance back to the pointer that was actually allocated
+    // Otherwise: number of bytes requested
+    size_t bytes;
+};
+
+// Shared by all threads, only accessed while mutex is locked
+struct vmalloc_class {
+    Fmutex mutex;
+    Vpool *pool;
+};
+
+// Blocks a single thread can allocate from and free to without locking
+struct vmalloc_cache {
+    uint32_t count;
+    void *blocks[VMALLOC_CACHE_DEPTH];
+};
+
+// Smallest size class that can hold block_bytes bytes
+uint32_t vmalloc_class_index(size_t block_bytes);
+
+// Number of bytes in each block of a size class
+size_t vmalloc_class_size(uint32_t index);
+
+// Get a block from the calling thread's cache, refilling it if empty
+void *vmalloc_class_alloc(uint32_t index);
+
+// Return a block to the calling thread's cache, flushing it if full
+void vmalloc_class_free(uint32_t index, void *block);
+
+// Move up to VMALLOC_CACHE_DEPTH / 2 blocks from a size class to cache
+int vmalloc_class_refill(uint32_t index, struct vmalloc_cache *cache);
+
+// Move blocks from cache back to a size class until only keep remain
+void vmalloc_class_flush(uint32_t index, struct vmalloc_cache *cache, uint32_t keep);
+
+// Map another chunk for a size class
+// Caller must hold the size class mutex
+int vmalloc_class_extend(struct vmalloc_class *class, uint32_t index);
+
+// Allocate a block that is too large for any size class using its own mapping
+void *vmalloc_large_alloc(size_t num_bytes);
+
+// Resize a block that is too large for any size class
+void *vmalloc_large_realloc(struct vmalloc_header *header, size_t num_bytes);
+
+// Header placed before ptr
+struct vmalloc_header *vmalloc_header_of(void *ptr);
+
+// Create the key used to run vmalloc_thread_exit and install the fork handlers
+void vmalloc_thread_key_create(void);
+
+// Make sure the calling thread's caches are flushed when it exits
+void vmalloc_thread_register(void);
+
+// Called by pthreads when a thread that allocated exits
+void vmalloc_thread_exit(void *arg);
+
+// Lock every size class so fork cannot copy one mid update
+void vmalloc_fork_prepare(void);
+
+// Unlock every size class in the parent after fork
+void vmalloc_fork_parent(void);
+
+// Reset every size class mutex in the child after fork
+void vmalloc_fork_child(void);
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <vstats.h>
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -50,6 +52,11 @@ typedef struct vpool {
 
     // Only not NULL when VPOOL_KIND_DYNAMIC
     struct vpool *prev;
+
+#ifdef DERT_STATS
+    // Covers every chunk of the pool, only meaningful in the newest header
+    Vstats stats;
+#endif
 } Vpool;
 
 // Create new pool with num_items each of size elem_size
@@ -89,3 +96,7 @@ bool vpool_full(Vpool *pool);
 // Allows you to extend a Vpool of kind VPOOL_KIND_GUIDED when at capacity (vpool_full returns true)
 // Memory is not kept track of and freed later when added using this method
 int vpool_guided_extend(Vpool *pool, void *memory, size_t memory_size);
+
+// Copy the memory stats of pool to dest.
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS.
+int vpool_stats(Vpool *pool, Vstats *dest);
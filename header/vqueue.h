@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <vallocator.h>
+
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -29,10 +31,14 @@ typedef struct vqueue {
 
     // total number of elements this queue can store, if empty
     size_t cap;
+
+    // where the memory passed to vqueue_init came from when created by vqueue_create, NULL means malloc
+    Vallocator *allocator;
 } Vqueue;
 
 // Allocates memory for and initializes a Vqueue.
-Vqueue *vqueue_create(size_t elem_size, size_t num_elems);
+// Memory comes from allocator, pass NULL to use malloc
+Vqueue *vqueue_create(size_t elem_size, size_t num_elems, Vallocator *allocator);
 
 // Advise how much memory is needed for one vqueue with num_elems elements each of elem_size bytes
 size_t vqueue_advise(size_t elem_size, size_t num_elems);
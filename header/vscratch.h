@@ -0,0 +1,45 @@
+/*
+ * vscratch.h -- Per-thread scratch arenas for temporary buffers
+ *
+ * Every thread lazily gets its own VARENA_KIND_CHAINED arena that is destroyed when the thread exits.
+ * VSCRATCH_SCOPE claims a frame that is disclaimed automatically once the enclosing scope is left.
+ * Memory allocated inside a scope must not be used after the scope ends or by another thread.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <varena.h>
+
+#include <stddef.h>
+
+// Size of the first block of each thread's scratch arena
+#define VSCRATCH_INITIAL_BYTES (64 * 1024)
+
+// Declare name as the calling thread's scratch arena with a new frame of num_bytes bytes
+// The frame is disclaimed when name goes out of scope
+// name is NULL when the frame could not be claimed, in which case varena_alloc(&name, ...) returns NULL
+#define VSCRATCH_SCOPE(name, num_bytes) \
+Varena *name __attribute__((__cleanup__(vscratch_end))) = vscratch_begin(num_bytes)
+
+/*
+ * Get the calling thread's scratch arena, creating it on first use
+ * Non-null pointer returned on success.
+ */
+Varena *vscratch_arena(void);
+
+/*
+ * Claim a frame of num_bytes bytes on the calling thread's scratch arena
+ * Frames must be ended in the reverse order they were begun.
+ * Non-null pointer returned on success.
+ */
+Varena *vscratch_begin(size_t num_bytes);
+
+/*
+ * Disclaim the frame begun by vscratch_begin
+ * Passing a pointer to NULL causes nothing to happen
+ */
+void vscratch_end(Varena **arena_ptr);
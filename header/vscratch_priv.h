@@ -0,0 +1,15 @@
+/*
+ * vscratch_priv.h -- Per-thread scratch arenas for temporary buffers
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+// Create the key used to run vscratch_thread_exit
+void vscratch_thread_key_create(void);
+
+// Called by pthreads when a thread that used its scratch arena exits
+void vscratch_thread_exit(void *arg);
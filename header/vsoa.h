@@ -0,0 +1,115 @@
+/*
+ * vsoa.h -- Variable length struct-of-arrays, one contiguous column per field
+ *
+ * Where a Varray stores whole records next to each other, a Vsoa stores each field of every record in its own column.
+ * All columns share one length and capacity and are grown together.
+ * Loops that only touch a few fields then only read the columns they need.
+ * Each column is a plain array so loops over vsoa_column pointers can be auto-vectorized.
+ *
+ * You are given the option of allowing this library to allocate a Vsoa for you using vsoa_create.
+ * Or, you can call vsoa_advise to get the memory total needed, allocate it, and call vsoa_init with that memory.
+ * Because of these memory conventions vsoa_destroy should only be used with memory allocated by vsoa_create.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <vallocator.h>
+#include <vstats.h>
+
+#include <stddef.h>
+
+typedef struct vsoa {
+    // one array per column, each holding cap elements
+    void **columns;
+
+    // size of the elements of each column
+    size_t *column_sizes;
+
+    // number of columns, fixed when created/initialized
+    size_t num_columns;
+
+    // number of rows the Vsoa currently holds
+    size_t stored;
+
+    // number of rows every column can (currently) hold
+    size_t cap;
+
+    // where columns come from, NULL means malloc
+    Vallocator *allocator;
+
+#ifdef DERT_STATS
+    Vstats stats;
+#endif
+} Vsoa;
+
+// Typed pointer to the first element of a column, valid until the Vsoa next grows or shrinks
+#define VSOA_COLUMN(soa, column, type) ((type *) vsoa_column((soa), (column)))
+
+// Advise how much memory a Vsoa with num_columns columns needs, not counting the columns themselves
+size_t vsoa_advise(size_t num_columns);
+
+// Allocates memory for and initializes an empty Vsoa with num_columns columns of column_sizes[i] byte elements
+// The Vsoa itself and its columns come from allocator, pass NULL to use malloc
+Vsoa *vsoa_create(size_t num_columns, size_t column_sizes[], Vallocator *allocator);
+
+// Uses memory of at least vsoa_advise(num_columns) bytes to initialize an empty Vsoa, placed in *dest
+int vsoa_init(Vsoa **dest, void *memory, size_t num_columns, size_t column_sizes[], Vallocator *allocator);
+
+// Deinitializes a Vsoa
+void vsoa_deinit(Vsoa *soa);
+
+/*
+ * Destroys a Vsoa that was allocated by vsoa_create.
+ * Please, only use with memory allocated by vsoa_create!
+ */
+void vsoa_destroy(Vsoa *soa);
+
+// Pointer to the first element of column, NULL if there is no such column or no rows have been reserved
+void *vsoa_column(Vsoa *soa, size_t column);
+
+// Pointer to the element of column at row
+void *vsoa_get_direct(Vsoa *soa, size_t row, size_t column);
+
+// Copy the element of column at row to dest
+int vsoa_get(Vsoa *soa, size_t row, size_t column, void *dest);
+
+// Copy src to the element of column at row
+int vsoa_set(Vsoa *soa, size_t row, size_t column, void *src);
+
+// Copy every element of row to dest[column], columns for which dest[column] is NULL are skipped
+int vsoa_row_get(Vsoa *soa, size_t row, void *dest[]);
+
+// Copy src[column] to every element of row, columns for which src[column] is NULL are left untouched
+int vsoa_row_set(Vsoa *soa, size_t row, void *src[]);
+
+// Add a row after the last row, columns for which src[column] is NULL are zeroed, amortized O(1)
+int vsoa_push(Vsoa *soa, void *src[]);
+
+// Copy the last row to dest, unless dest is NULL, and remove it
+int vsoa_pop(Vsoa *soa, void *dest[]);
+
+// Change the number of rows, new rows are zeroed and capacity grows geometrically when new_size does not fit
+int vsoa_resize(Vsoa *soa, size_t new_size);
+
+// Make sure at least num_rows rows fit without reallocating, does not change the length
+int vsoa_reserve(Vsoa *soa, size_t num_rows);
+
+// Reallocate every column so the capacity is exactly the current length
+int vsoa_shrink_to_fit(Vsoa *soa);
+
+// Number of rows
+size_t vsoa_len(Vsoa *soa);
+
+// Number of rows that can be stored without reallocating
+size_t vsoa_cap(Vsoa *soa);
+
+// Number of columns
+size_t vsoa_num_columns(Vsoa *soa);
+
+// Copy the memory stats of soa to dest.
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS.
+int vsoa_stats(Vsoa *soa, Vstats *dest);
@@ -0,0 +1,26 @@
+/*
+ * vsoa_priv.h -- Variable length struct-of-arrays, one contiguous column per field
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <vsoa.h>
+
+#include <stddef.h>
+
+// Smallest capacity allocated once rows are added
+#define VSOA_MIN_CAP (8)
+
+// Sum of the sizes of the elements of every column
+size_t vsoa_row_size(Vsoa *soa);
+
+// Capacity, doubling from the current capacity, that fits at least num_rows rows
+size_t vsoa_cap_next(Vsoa *soa, size_t num_rows);
+
+// Reallocate every column so the capacity is exactly new_cap rows, new rows are zeroed
+// On failure every column keeps its previous capacity
+int vsoa_cap_set(Vsoa *soa, size_t new_cap);
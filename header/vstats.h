@@ -0,0 +1,78 @@
+/*
+ * vstats.h -- Opt-in memory accounting for containers
+ *
+ * Build everything with DERT_STATS defined to enable.
+ * Otherwise the VSTATS_* macros expand to nothing and containers carry no extra fields.
+ * Every container with stats also adds to one set of global stats that may be read from any thread.
+ * Stats for a single container are only updated by operations on that container and are not thread safe.
+ *
+ * DERT - Miscellaneous Data Structures Library
+ * https://github.com/moretiles/dert
+ * Project licensed under Apache-2.0 license
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct vstats {
+    // Bytes currently obtained to hold elements and bookkeeping
+    size_t reserved;
+    size_t reserved_peak;
+
+    // Bytes currently holding elements
+    size_t live;
+    size_t live_peak;
+
+    // Number of times memory was obtained and released
+    size_t allocs;
+    size_t frees;
+
+    // Number of growth operations and nanoseconds spent in them
+    size_t grows;
+    uint64_t grow_ns;
+} Vstats;
+
+#ifdef DERT_STATS
+// Record that reserved memory went from old_bytes to new_bytes
+#define VSTATS_RESERVE(stats, old_bytes, new_bytes) vstats_reserve((stats), (old_bytes), (new_bytes))
+
+// Record that live memory went from old_bytes to new_bytes
+#define VSTATS_LIVE(stats, old_bytes, new_bytes) vstats_live((stats), (old_bytes), (new_bytes))
+
+// Start timing a growth operation, name is declared as a local variable
+#define VSTATS_GROW_START(name) const uint64_t name = vstats_now()
+
+// Finish timing a growth operation started with VSTATS_GROW_START
+#define VSTATS_GROW_END(stats, name) vstats_grow((stats), (name))
+#else
+#define VSTATS_RESERVE(stats, old_bytes, new_bytes) do {} while(0)
+#define VSTATS_LIVE(stats, old_bytes, new_bytes) do {} while(0)
+#define VSTATS_GROW_START(name) do {} while(0)
+#define VSTATS_GROW_END(stats, name) do {} while(0)
+#endif
+
+// Nanoseconds from a monotonic clock
+uint64_t vstats_now(void);
+
+// Update stats, and the global stats, for memory reserved going from old_bytes to new_bytes
+void vstats_reserve(Vstats *stats, size_t old_bytes, size_t new_bytes);
+
+// Update stats, and the global stats, for memory in use going from old_bytes to new_bytes
+void vstats_live(Vstats *stats, size_t old_bytes, size_t new_bytes);
+
+// Update stats, and the global stats, for a growth operation that started at start_ns
+void vstats_grow(Vstats *stats, uint64_t start_ns);
+
+// Add everything counted in src to dest, used when a container's bookkeeping is replaced
+void vstats_merge(Vstats *dest, Vstats *src);
+
+/*
+ * Copy the global stats to dest
+ * Returns 0 on success, ENOTSUP when not built with DERT_STATS.
+ */
+int vstats_global(Vstats *dest);
+
+// Set the global counts and times to 0, peaks restart from the current values
+void vstats_global_reset(void);
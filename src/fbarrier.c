@@ -0,0 +1,151 @@
+#define _DEFAULT_SOURCE (1)
+
+#include <fbarrier.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+
+Fbarrier *fbarrier_create(uint32_t count) {
+    void *memory;
+    Fbarrier *barrier;
+
+    if(count == 0) {
+        return NULL;
+    }
+
+    memory = malloc(fbarrier_advise(count));
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    if(fbarrier_init(&barrier, memory, count) != 0) {
+        free(memory);
+        memory = NULL;
+        return NULL;
+    }
+
+    return barrier;
+}
+
+size_t fbarrier_advise(uint32_t count) {
+    // eliminate unused warnings
+    (void)(count);
+
+    return 1 * sizeof(Fbarrier);
+}
+
+size_t fbarrier_advisev(size_t num_barriers, uint32_t count) {
+    // eliminate unused warnings
+    (void)(count);
+
+    return num_barriers * (1 * sizeof(Fbarrier));
+}
+
+int fbarrier_init(Fbarrier **dest, void *memory, uint32_t count) {
+    Fbarrier *barrier;
+    if(dest == NULL || memory == NULL || count == 0) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fbarrier_advise(count)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    barrier = *dest;
+    barrier->count = count;
+    atomic_store_explicit(&(barrier->generation), 0, memory_order_relaxed);
+    atomic_store_explicit(&(barrier->arrived), 0, memory_order_release);
+
+    return 0;
+}
+
+int fbarrier_initv(size_t num_barriers, Fbarrier *dest[], void *memory, uint32_t count) {
+    Fbarrier *barriers;
+    if(num_barriers == 0 || dest == NULL || memory == NULL || count == 0) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fbarrier_advisev(num_barriers, count)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    barriers = *dest;
+    for(size_t i = 0; i < num_barriers; i++) {
+        barriers[i].count = count;
+        atomic_store_explicit(&(barriers[i].generation), 0, memory_order_relaxed);
+        atomic_store_explicit(&(barriers[i].arrived), 0, memory_order_release);
+    }
+
+    return 0;
+}
+
+void fbarrier_deinit(Fbarrier *barrier) {
+    if(barrier == NULL) {
+        return;
+    }
+
+    // nothing should be waiting on barrier when this is set
+    atomic_store_explicit(&(barrier->arrived), 0, memory_order_release);
+
+    return;
+}
+
+void fbarrier_destroy(Fbarrier *barrier) {
+    if(barrier == NULL) {
+        return;
+    }
+
+    fbarrier_deinit(barrier);
+    free(barrier);
+
+    return;
+}
+
+int fbarrier_wait(Fbarrier *barrier) {
+    long res;
+    uint32_t generation;
+
+    if(barrier == NULL) {
+        return EINVAL;
+    }
+
+    // read before arriving, the last thread to arrive changes it only after everyone has
+    generation = atomic_load_explicit(&(barrier->generation), memory_order_acquire);
+    if(atomic_fetch_add_explicit(&(barrier->arrived), 1, memory_order_acq_rel) + 1 == barrier->count) {
+        // threads leaving can only arrive for the next round after seeing the new generation
+        atomic_store_explicit(&(barrier->arrived), 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&(barrier->generation), 1, memory_order_release);
+
+        errno = 0;
+        res = syscall(SYS_futex, &(barrier->generation), FUTEX_WAKE_PRIVATE, INT_MAX);
+        if(res < 0) {
+            printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+            return errno;
+        }
+        return FBARRIER_SERIAL_THREAD;
+    }
+
+    while(atomic_load_explicit(&(barrier->generation), memory_order_acquire) == generation) {
+        // want to perform FUTEX_WAIT_PRIVATE syscall
+        // Returns 0 after being woken, or fails with EAGAIN if the round already completed
+        // EINTR only means a signal arrived, in every case check again
+        errno = 0;
+        res = syscall(SYS_futex, &(barrier->generation), FUTEX_WAIT_PRIVATE, generation, NULL);
+        if(res != 0 && errno != EAGAIN && errno != EINTR) {
+            printf("error with FUTEX_WAIT in %s = %d\n", __func__, errno);
+            return errno;
+        }
+        errno = 0;
+    }
+
+    return 0;
+}
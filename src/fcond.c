@@ -0,0 +1,200 @@
+#define _DEFAULT_SOURCE (1)
+
+#include <fcond.h>
+#include <fmutex.h>
+#include <fmutex_priv.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+
+Fcond *fcond_create(void) {
+    void *memory;
+    Fcond *cond;
+
+    memory = malloc(fcond_advise());
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    if(fcond_init(&cond, memory) != 0) {
+        free(memory);
+        memory = NULL;
+        return NULL;
+    }
+
+    return cond;
+}
+
+size_t fcond_advise(void) {
+    return 1 * sizeof(Fcond);
+}
+
+size_t fcond_advisev(size_t num_conds) {
+    return num_conds * (1 * sizeof(Fcond));
+}
+
+int fcond_init(Fcond **dest, void *memory) {
+    Fcond *cond;
+    if(dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fcond_advise()) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    cond = *dest;
+    atomic_store_explicit(&(cond->mutex), NULL, memory_order_relaxed);
+    atomic_store_explicit(&(cond->waiters), 0, memory_order_relaxed);
+    atomic_store_explicit(&(cond->seq), 0, memory_order_release);
+
+    return 0;
+}
+
+int fcond_initv(size_t num_conds, Fcond *dest[], void *memory) {
+    Fcond *conds;
+    if(num_conds == 0 || dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fcond_advisev(num_conds)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    conds = *dest;
+    for(size_t i = 0; i < num_conds; i++) {
+        atomic_store_explicit(&(conds[i].mutex), NULL, memory_order_relaxed);
+        atomic_store_explicit(&(conds[i].waiters), 0, memory_order_relaxed);
+        atomic_store_explicit(&(conds[i].seq), 0, memory_order_release);
+    }
+
+    return 0;
+}
+
+void fcond_deinit(Fcond *cond) {
+    if(cond == NULL) {
+        return;
+    }
+
+    atomic_store_explicit(&(cond->mutex), NULL, memory_order_relaxed);
+    atomic_store_explicit(&(cond->seq), 0, memory_order_release);
+
+    return;
+}
+
+void fcond_destroy(Fcond *cond) {
+    if(cond == NULL) {
+        return;
+    }
+
+    fcond_deinit(cond);
+    free(cond);
+
+    return;
+}
+
+int fcond_wait(Fcond *cond, Fmutex *mutex) {
+    long res;
+    uint32_t seq;
+
+    if(cond == NULL || mutex == NULL) {
+        return EINVAL;
+    }
+
+    // read while still holding mutex, so any signal sent after the caller checked its condition changes seq
+    seq = atomic_load_explicit(&(cond->seq), memory_order_acquire);
+    atomic_store_explicit(&(cond->mutex), mutex, memory_order_relaxed);
+    atomic_fetch_add_explicit(&(cond->waiters), 1, memory_order_seq_cst);
+
+    res = fmutex_unlock(mutex);
+    if(res != 0) {
+        atomic_fetch_sub_explicit(&(cond->waiters), 1, memory_order_seq_cst);
+        return res;
+    }
+
+    // want to perform FUTEX_WAIT_PRIVATE syscall
+    // Returns 0 after being woken, including after being moved onto mutex by broadcast and woken from there
+    // Fails with EAGAIN if signalled before sleeping, and with EINTR if a signal arrived, both count as wake ups
+    errno = 0;
+    res = syscall(SYS_futex, &(cond->seq), FUTEX_WAIT_PRIVATE, seq, NULL);
+    if(res != 0 && errno != EAGAIN && errno != EINTR) {
+        res = errno;
+        printf("error with FUTEX_WAIT in %s = %ld\n", __func__, res);
+        atomic_fetch_sub_explicit(&(cond->waiters), 1, memory_order_seq_cst);
+        fmutex_lock(mutex);
+        return res;
+    }
+    errno = 0;
+    atomic_fetch_sub_explicit(&(cond->waiters), 1, memory_order_seq_cst);
+
+    // other waiters may have been moved onto mutex and only an unlock of a contended mutex wakes them
+    return fmutex_lock_contended(mutex);
+}
+
+int fcond_signal(Fcond *cond) {
+    long res;
+
+    if(cond == NULL) {
+        return EINVAL;
+    }
+
+    if(atomic_load_explicit(&(cond->waiters), memory_order_seq_cst) == 0) {
+        return 0;
+    }
+
+    atomic_fetch_add_explicit(&(cond->seq), 1, memory_order_seq_cst);
+    errno = 0;
+    res = syscall(SYS_futex, &(cond->seq), FUTEX_WAKE_PRIVATE, 1);
+    if(res < 0) {
+        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+        return errno;
+    }
+
+    return 0;
+}
+
+int fcond_broadcast(Fcond *cond) {
+    long res;
+    uint32_t seq;
+    Fmutex *mutex;
+
+    if(cond == NULL) {
+        return EINVAL;
+    }
+
+    if(atomic_load_explicit(&(cond->waiters), memory_order_seq_cst) == 0) {
+        return 0;
+    }
+
+    seq = atomic_fetch_add_explicit(&(cond->seq), 1, memory_order_seq_cst) + 1;
+    mutex = atomic_load_explicit(&(cond->mutex), memory_order_relaxed);
+    while(true) {
+        errno = 0;
+        if(mutex == NULL) {
+            res = syscall(SYS_futex, &(cond->seq), FUTEX_WAKE_PRIVATE, INT_MAX);
+        } else {
+            // wake one waiter and move the rest to sleep on mutex
+            // the woken waiter leaves mutex marked contended so its unlock wakes the next
+            res = syscall(SYS_futex, &(cond->seq), FUTEX_CMP_REQUEUE_PRIVATE, 1, (void *) (uintptr_t) INT_MAX, &(mutex->locked), seq);
+        }
+        if(res >= 0) {
+            return 0;
+        }
+        if(errno != EAGAIN) {
+            printf("error with FUTEX_CMP_REQUEUE in %s = %d\n", __func__, errno);
+            return errno;
+        }
+
+        // seq was changed by another signal or broadcast before the kernel looked at it
+        seq = atomic_load_explicit(&(cond->seq), memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,193 @@
+#define _DEFAULT_SOURCE (1)
+
+#include <fevent.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+
+Fevent *fevent_create(Fevent_kind kind, bool set) {
+    void *memory;
+    Fevent *event;
+
+    memory = malloc(fevent_advise(kind, set));
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    if(fevent_init(&event, memory, kind, set) != 0) {
+        free(memory);
+        memory = NULL;
+        return NULL;
+    }
+
+    return event;
+}
+
+size_t fevent_advise(Fevent_kind kind, bool set) {
+    // eliminate unused warnings
+    (void)(kind);
+    (void)(set);
+
+    return 1 * sizeof(Fevent);
+}
+
+size_t fevent_advisev(size_t num_events, Fevent_kind kind, bool set) {
+    // eliminate unused warnings
+    (void)(kind);
+    (void)(set);
+
+    return num_events * (1 * sizeof(Fevent));
+}
+
+int fevent_init(Fevent **dest, void *memory, Fevent_kind kind, bool set) {
+    Fevent *event;
+    if(dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+    if(kind != FEVENT_KIND_AUTO_RESET && kind != FEVENT_KIND_MANUAL_RESET) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fevent_advise(kind, set)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    event = *dest;
+    event->kind = kind;
+    atomic_store_explicit(&(event->waiters), 0, memory_order_relaxed);
+    atomic_store_explicit(&(event->set), set, memory_order_release);
+
+    return 0;
+}
+
+int fevent_initv(size_t num_events, Fevent *dest[], void *memory, Fevent_kind kind, bool set) {
+    Fevent *events;
+    if(num_events == 0 || dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+    if(kind != FEVENT_KIND_AUTO_RESET && kind != FEVENT_KIND_MANUAL_RESET) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fevent_advisev(num_events, kind, set)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    events = *dest;
+    for(size_t i = 0; i < num_events; i++) {
+        events[i].kind = kind;
+        atomic_store_explicit(&(events[i].waiters), 0, memory_order_relaxed);
+        atomic_store_explicit(&(events[i].set), set, memory_order_release);
+    }
+
+    return 0;
+}
+
+void fevent_deinit(Fevent *event) {
+    if(event == NULL) {
+        return;
+    }
+
+    // nothing should be dependent on event->set when this is set
+    atomic_store_explicit(&(event->set), false, memory_order_release);
+
+    return;
+}
+
+void fevent_destroy(Fevent *event) {
+    if(event == NULL) {
+        return;
+    }
+
+    fevent_deinit(event);
+    free(event);
+
+    return;
+}
+
+int fevent_wait(Fevent *event) {
+    long res;
+    uint32_t set;
+
+    if(event == NULL) {
+        return EINVAL;
+    }
+
+    while(true) {
+        if(event->kind == FEVENT_KIND_AUTO_RESET) {
+            // only one waiter gets to turn set back off
+            set = true;
+            if(atomic_compare_exchange_strong_explicit(&(event->set), &set, false, memory_order_acquire, memory_order_relaxed)) {
+                return 0;
+            }
+        } else if(atomic_load_explicit(&(event->set), memory_order_acquire)) {
+            return 0;
+        }
+
+        // setters only wake when they see a waiter counted here
+        atomic_fetch_add_explicit(&(event->waiters), 1, memory_order_seq_cst);
+        if(!atomic_load_explicit(&(event->set), memory_order_seq_cst)) {
+            // want to perform FUTEX_WAIT_PRIVATE syscall
+            // Returns 0 after being woken, or fails with EAGAIN if event->set was no longer false
+            // EINTR only means a signal arrived, in every case check again
+            errno = 0;
+            res = syscall(SYS_futex, &(event->set), FUTEX_WAIT_PRIVATE, false, NULL);
+            if(res != 0 && errno != EAGAIN && errno != EINTR) {
+                res = errno;
+                atomic_fetch_sub_explicit(&(event->waiters), 1, memory_order_seq_cst);
+                printf("error with FUTEX_WAIT in %s = %ld\n", __func__, res);
+                return res;
+            }
+            errno = 0;
+        }
+        atomic_fetch_sub_explicit(&(event->waiters), 1, memory_order_seq_cst);
+    }
+}
+
+int fevent_set(Fevent *event) {
+    long res;
+
+    if(event == NULL) {
+        return EINVAL;
+    }
+
+    atomic_store_explicit(&(event->set), true, memory_order_seq_cst);
+    if(atomic_load_explicit(&(event->waiters), memory_order_seq_cst) == 0) {
+        return 0;
+    }
+
+    errno = 0;
+    res = syscall(SYS_futex, &(event->set), FUTEX_WAKE_PRIVATE, event->kind == FEVENT_KIND_AUTO_RESET ? 1 : INT_MAX);
+    if(res < 0) {
+        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+        return errno;
+    }
+
+    return 0;
+}
+
+int fevent_reset(Fevent *event) {
+    if(event == NULL) {
+        return EINVAL;
+    }
+
+    atomic_store_explicit(&(event->set), false, memory_order_release);
+    return 0;
+}
+
+bool fevent_is_set(Fevent *event) {
+    if(event == NULL) {
+        return false;
+    }
+
+    return atomic_load_explicit(&(event->set), memory_order_acquire);
+}
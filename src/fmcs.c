@@ -0,0 +1,213 @@
+#define _DEFAULT_SOURCE (1)
+
+#include <fmcs.h>
+#include <fmutex_priv.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+
+Fmcs *fmcs_create(void) {
+    void *memory;
+    Fmcs *lock;
+
+    memory = malloc(fmcs_advise());
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    if(fmcs_init(&lock, memory) != 0) {
+        free(memory);
+        memory = NULL;
+        return NULL;
+    }
+
+    return lock;
+}
+
+size_t fmcs_advise(void) {
+    return 1 * sizeof(Fmcs);
+}
+
+size_t fmcs_advisev(size_t num_locks) {
+    return num_locks * (1 * sizeof(Fmcs));
+}
+
+int fmcs_init(Fmcs **dest, void *memory) {
+    Fmcs *lock;
+    if(dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fmcs_advise()) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    lock = *dest;
+    atomic_store_explicit(&(lock->tail), NULL, memory_order_release);
+
+    return 0;
+}
+
+int fmcs_initv(size_t num_locks, Fmcs *dest[], void *memory) {
+    Fmcs *locks;
+    if(num_locks == 0 || dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fmcs_advisev(num_locks)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    locks = *dest;
+    for(size_t i = 0; i < num_locks; i++) {
+        atomic_store_explicit(&(locks[i].tail), NULL, memory_order_release);
+    }
+
+    return 0;
+}
+
+void fmcs_deinit(Fmcs *lock) {
+    if(lock == NULL) {
+        return;
+    }
+
+    // nothing should be dependent on lock->tail when this is set
+    atomic_store_explicit(&(lock->tail), NULL, memory_order_release);
+
+    return;
+}
+
+void fmcs_destroy(Fmcs *lock) {
+    if(lock == NULL) {
+        return;
+    }
+
+    fmcs_deinit(lock);
+    free(lock);
+
+    return;
+}
+
+int fmcs_lock(Fmcs *lock, Fmcs_node *node) {
+    long res;
+    Fmcs_node *prev;
+    uint32_t state;
+
+    if(lock == NULL || node == NULL) {
+        return EINVAL;
+    }
+
+    atomic_store_explicit(&(node->next), NULL, memory_order_relaxed);
+    atomic_store_explicit(&(node->state), FMCS_WAITING, memory_order_relaxed);
+
+    prev = atomic_exchange_explicit(&(lock->tail), node, memory_order_acq_rel);
+    if(prev == NULL) {
+        return 0;
+    }
+
+    // from here on only the thread ahead of us writes to node
+    atomic_store_explicit(&(prev->next), node, memory_order_release);
+
+    for(size_t i = 0; i < FMUTEX_SPIN; i++) {
+        if(atomic_load_explicit(&(node->state), memory_order_acquire) == FMCS_GRANTED) {
+            return 0;
+        }
+        FMUTEX_PAUSE();
+    }
+
+    // tell the thread ahead that it has to wake us
+    state = FMCS_WAITING;
+    if(!atomic_compare_exchange_strong_explicit(&(node->state), &state, FMCS_PARKED, memory_order_acq_rel, memory_order_acquire)) {
+        // was granted in the meantime
+        return 0;
+    }
+
+    while(atomic_load_explicit(&(node->state), memory_order_acquire) != FMCS_GRANTED) {
+        // want to perform FUTEX_WAIT_PRIVATE syscall
+        // Returns 0 after being woken, or fails with EAGAIN if the lock was already handed over
+        // EINTR only means a signal arrived, in every case check again
+        errno = 0;
+        res = syscall(SYS_futex, &(node->state), FUTEX_WAIT_PRIVATE, FMCS_PARKED, NULL);
+        if(res != 0 && errno != EAGAIN && errno != EINTR) {
+            // cannot leave the queue, the thread ahead would hand the lock to a node that no longer exists
+            printf("error with FUTEX_WAIT in %s = %d\n", __func__, errno);
+        }
+        errno = 0;
+    }
+
+    return 0;
+}
+
+int fmcs_trylock(Fmcs *lock, Fmcs_node *node) {
+    Fmcs_node *expected = NULL;
+
+    if(lock == NULL || node == NULL) {
+        return EINVAL;
+    }
+
+    atomic_store_explicit(&(node->next), NULL, memory_order_relaxed);
+    atomic_store_explicit(&(node->state), FMCS_WAITING, memory_order_relaxed);
+    if(!atomic_compare_exchange_strong_explicit(&(lock->tail), &expected, node, memory_order_acq_rel, memory_order_relaxed)) {
+        return EBUSY;
+    }
+
+    return 0;
+}
+
+int fmcs_unlock(Fmcs *lock, Fmcs_node *node) {
+    long res;
+    Fmcs_node *next, *expected;
+
+    if(lock == NULL || node == NULL) {
+        return EINVAL;
+    }
+    // node is only meaningful while the lock is held, so check that before reading it
+    if(atomic_load_explicit(&(lock->tail), memory_order_relaxed) == NULL) {
+        return EPERM;
+    }
+
+    next = atomic_load_explicit(&(node->next), memory_order_acquire);
+    if(next == NULL) {
+        // nobody queued, unlock unless someone is in the middle of queueing
+        expected = node;
+        if(atomic_compare_exchange_strong_explicit(&(lock->tail), &expected, NULL, memory_order_acq_rel, memory_order_relaxed)) {
+            return 0;
+        }
+        if(expected == NULL) {
+            // was not locked
+            return EPERM;
+        }
+
+        // the next waiter swapped itself in as tail and is about to link itself to node
+        // it may have been preempted in between, so stop burning its time slice after a while
+        for(size_t i = 0; (next = atomic_load_explicit(&(node->next), memory_order_acquire)) == NULL; i++) {
+            if(i < FMUTEX_SPIN) {
+                FMUTEX_PAUSE();
+            } else {
+                sched_yield();
+            }
+        }
+    }
+
+    // next may return and reuse its node as soon as it sees FMCS_GRANTED
+    // it only sleeps, needing a wake up, after marking itself FMCS_PARKED
+    if(atomic_exchange_explicit(&(next->state), FMCS_GRANTED, memory_order_acq_rel) == FMCS_PARKED) {
+        errno = 0;
+        res = syscall(SYS_futex, &(next->state), FUTEX_WAKE_PRIVATE, 1);
+        if(res < 0) {
+            printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+            return errno;
+        }
+    }
+
+    return 0;
+}
@@ -1,8 +1,8 @@
 #define _DEFAULT_SOURCE (1)
 
 #include <fmutex.h>
+#include <fmutex_priv.h>
 
-#include <assert.h>
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -13,6 +13,7 @@
 #include <sys/syscall.h>
 #include <linux/futex.h>
 #include <stdatomic.h>
+#include <time.h>
 
 // Allocates memory for and create
 // Default state is unlocked
@@ -20,7 +21,8 @@ Fmutex *fmutex_create(void) {
     void *memory;
     Fmutex *mutex;
 
-    memory = malloc(fmutex_advise());
+    // stats make Fmutex cache line aligned, which malloc does not guarantee
+    memory = aligned_alloc(_Alignof(Fmutex), fmutex_advise());
     if (memory == NULL) {
         return NULL;
     }
@@ -58,7 +60,7 @@ int fmutex_init(Fmutex **dest, void *memory) {
     *dest = memory;
     mutex = *dest;
     // nothing should be dependent on mutex->locked at this point
-    atomic_store_explicit(&(mutex->locked), false, memory_order_release);
+    atomic_store_explicit(&(mutex->locked), FMUTEX_UNLOCKED, memory_order_release);
 
     return 0;
 }
@@ -76,7 +78,7 @@ int fmutex_initv(size_t num_mutexes, Fmutex *dest[], void *memory) {
     *dest = memory;
     mutexes = *dest;
     for(size_t i = 0; i < num_mutexes; i++) {
-        atomic_store_explicit(&(mutexes[i].locked), false, memory_order_release);
+        atomic_store_explicit(&(mutexes[i].locked), FMUTEX_UNLOCKED, memory_order_release);
     }
 
     return 0;
@@ -89,7 +91,7 @@ void fmutex_deinit(Fmutex *mutex) {
     }
 
     // nothing should be dependent on mutex->locked when this is set
-    atomic_store_explicit(&(mutex->locked), false, memory_order_release);
+    atomic_store_explicit(&(mutex->locked), FMUTEX_UNLOCKED, memory_order_release);
 
     return;
 }
@@ -109,59 +111,158 @@ void fmutex_destroy(Fmutex *mutex) {
     return;
 }
 
+// shared by fmutex_lock and fmutex_timedlock, NULL abstime means wait forever
+static int fmutex_lock_until(Fmutex *mutex, const struct timespec *abstime) {
+    uint32_t state = FMUTEX_UNLOCKED;
+
+    if(atomic_compare_exchange_strong_explicit(&(mutex->locked), &state, FMUTEX_LOCKED, memory_order_acquire, memory_order_relaxed)) {
+        FMUTEX_STATS_ACQUIRE(mutex);
+        return 0;
+    }
+
+    FSTATS_WAIT_START(wait_start);
+    // the holder is likely to be done soon, so wait for it without a syscall
+    // give up early once other threads are asleep rather than cutting in front of them
+    for(size_t i = 0; i < FMUTEX_SPIN && state != FMUTEX_CONTENDED; i++) {
+        FMUTEX_PAUSE();
+        state = atomic_load_explicit(&(mutex->locked), memory_order_relaxed);
+        if(state == FMUTEX_UNLOCKED &&
+                atomic_compare_exchange_strong_explicit(&(mutex->locked), &state, FMUTEX_LOCKED, memory_order_acquire, memory_order_relaxed)) {
+            FMUTEX_STATS_ACQUIRE_CONTENDED(mutex, wait_start);
+            return 0;
+        }
+    }
+
+    return fmutex_lock_contended_until(mutex, abstime);
+}
+
 // lock mutex
-// forces calling thread to wait if currently locked
+// forces calling thread to wait if currently locked, spinning briefly before sleeping
 // can lead to deadlock
 int fmutex_lock(Fmutex *mutex) {
-    long res;
-    uint32_t expected = false;
+    if(mutex == NULL) {
+        return EINVAL;
+    }
+
+    return fmutex_lock_until(mutex, NULL);
+}
+
+// lock mutex only if that can be done without waiting
+// fails with EBUSY if currently locked
+int fmutex_trylock(Fmutex *mutex) {
+    uint32_t state = FMUTEX_UNLOCKED;
 
     if(mutex == NULL) {
         return EINVAL;
     }
 
-    while(!(atomic_compare_exchange_strong_explicit(&(mutex->locked), &expected, true, memory_order_acq_rel, memory_order_acquire))) {
-        // want to perform FUTEX_WAIT_PRIVATE syscall
-        // Successful result i.e. result in which sem->counter != 0 can be signaled in two ways
-        // First, syscall itself returns 0 if waited then awaken
-        // Two, syscall failed with -1 as sem->counter was not 0, errno is EAGAIN
+    if(atomic_compare_exchange_strong_explicit(&(mutex->locked), &state, FMUTEX_LOCKED, memory_order_acquire, memory_order_relaxed)) {
+        FMUTEX_STATS_ACQUIRE(mutex);
+        return 0;
+    }
+
+    return EBUSY;
+}
+
+// lock mutex, waiting no later than abstime, an absolute time on CLOCK_MONOTONIC
+// fails with ETIMEDOUT if mutex was still locked at abstime, and EINVAL if abstime is malformed
+// succeeds without waiting if mutex is unlocked, even when abstime has passed
+int fmutex_timedlock(Fmutex *mutex, const struct timespec *abstime) {
+    if(mutex == NULL || abstime == NULL || !FMUTEX_TIMESPEC_VALID(abstime)) {
+        return EINVAL;
+    }
+
+    return fmutex_lock_until(mutex, abstime);
+}
+
+int fmutex_lock_contended(Fmutex *mutex) {
+    return fmutex_lock_contended_until(mutex, NULL);
+}
 
+int fmutex_lock_contended_until(Fmutex *mutex, const struct timespec *abstime) {
+    long res;
+    uint32_t state;
+    FSTATS_WAIT_START(wait_start);
+
+    // mark the mutex as having sleepers so that unlock wakes one
+    // whoever takes it this way keeps that mark, as other threads may still be asleep
+    // a thread that times out leaves the mark behind, costing at most one unneeded wake
+    state = atomic_exchange_explicit(&(mutex->locked), FMUTEX_CONTENDED, memory_order_acquire);
+    while(state != FMUTEX_UNLOCKED) {
+        // want to perform FUTEX_WAIT_BITSET_PRIVATE syscall, which unlike FUTEX_WAIT takes an absolute CLOCK_MONOTONIC timeout
+        // Returns 0 after being woken, or fails with EAGAIN if mutex->locked was no longer FMUTEX_CONTENDED
+        // EINTR only means a signal arrived, in every case try again
+        // ETIMEDOUT means abstime passed while mutex->locked was still FMUTEX_CONTENDED
+        FSTATS_FUTEX_WAIT(&(mutex->stats));
         errno = 0;
-        res = syscall(SYS_futex, &(mutex->locked), FUTEX_WAIT_PRIVATE, true, NULL);
-        if(res == 0 || errno == EAGAIN) {
-            // proceed
-        } else {
-            printf("error with FUTEX_WAIT in %s = %d\n", __func__, errno);
+        res = syscall(SYS_futex, &(mutex->locked), FUTEX_WAIT_BITSET_PRIVATE, FMUTEX_CONTENDED, abstime, NULL, FUTEX_BITSET_MATCH_ANY);
+        if(res != 0 && errno == ETIMEDOUT) {
+            return ETIMEDOUT;
+        }
+        if(res != 0 && errno != EAGAIN && errno != EINTR) {
+            printf("error with FUTEX_WAIT_BITSET in %s = %d\n", __func__, errno);
             return errno;
         }
         errno = 0;
+
+        state = atomic_exchange_explicit(&(mutex->locked), FMUTEX_CONTENDED, memory_order_acquire);
     }
 
+    FMUTEX_STATS_ACQUIRE_CONTENDED(mutex, wait_start);
     return 0;
 }
 
 // unlock mutex
-// fails if mutex is already unlocked
+// fails with EPERM if mutex is already unlocked
 int fmutex_unlock(Fmutex *mutex) {
     long res;
-    uint32_t expected = true;
-    bool success;
+    uint32_t state;
     if(mutex == NULL) {
         return EINVAL;
     }
 
-    success = atomic_compare_exchange_strong_explicit(&(mutex->locked), &expected, false, memory_order_acq_rel, memory_order_acquire);
-    if(success) {
+    FMUTEX_STATS_RELEASE(mutex);
+    state = atomic_exchange_explicit(&(mutex->locked), FMUTEX_UNLOCKED, memory_order_release);
+    if(state == FMUTEX_UNLOCKED) {
+        return EPERM;
+    }
+
+    // nobody can be asleep unless the mutex was marked
+    if(state == FMUTEX_CONTENDED) {
         errno = 0;
         res = syscall(SYS_futex, &(mutex->locked), FUTEX_WAKE_PRIVATE, 1);
         if(res < 0) {
             printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
-            return res;
+            return errno;
         }
-    } else {
-        // expected is update with the current value on failure
-        assert(expected == false);
     }
 
     return 0;
 }
+
+// Add up the contention stats of mutex into dest
+// Returns 0 on success, ENOTSUP when not built with DERT_STATS
+int fmutex_stats(Fmutex *mutex, Fstats *dest) {
+    if(mutex == NULL || dest == NULL) {
+        return EINVAL;
+    }
+
+#ifdef DERT_STATS
+    fstats_sum(&(mutex->stats), dest);
+    return 0;
+#else
+    memset(dest, 0, sizeof(Fstats));
+    return ENOTSUP;
+#endif
+}
+
+// Set the contention stats of mutex to 0
+void fmutex_stats_reset(Fmutex *mutex) {
+    if(mutex == NULL) {
+        return;
+    }
+
+#ifdef DERT_STATS
+    fstats_clear(&(mutex->stats));
+#endif
+}
@@ -0,0 +1,298 @@
+#define _DEFAULT_SOURCE (1)
+
+#include <frwlock.h>
+#include <frwlock_priv.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+
+Frwlock *frwlock_create(Frwlock_kind kind) {
+    void *memory;
+    Frwlock *lock;
+
+    memory = malloc(frwlock_advise(kind));
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    if(frwlock_init(&lock, memory, kind) != 0) {
+        free(memory);
+        memory = NULL;
+        return NULL;
+    }
+
+    return lock;
+}
+
+size_t frwlock_advise(Frwlock_kind kind) {
+    // eliminate unused warnings
+    (void)(kind);
+
+    return 1 * sizeof(Frwlock);
+}
+
+size_t frwlock_advisev(size_t num_locks, Frwlock_kind kind) {
+    // eliminate unused warnings
+    (void)(kind);
+
+    return num_locks * (1 * sizeof(Frwlock));
+}
+
+int frwlock_init(Frwlock **dest, void *memory, Frwlock_kind kind) {
+    Frwlock *lock;
+    if(dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+    if(kind != FRWLOCK_KIND_PREFER_READER && kind != FRWLOCK_KIND_PREFER_WRITER) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, frwlock_advise(kind)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    lock = *dest;
+    lock->kind = kind;
+    atomic_store_explicit(&(lock->waiting_readers), 0, memory_order_relaxed);
+    atomic_store_explicit(&(lock->writer_seq), 0, memory_order_relaxed);
+    atomic_store_explicit(&(lock->state), 0, memory_order_release);
+
+    return 0;
+}
+
+int frwlock_initv(size_t num_locks, Frwlock *dest[], void *memory, Frwlock_kind kind) {
+    Frwlock *locks;
+    if(num_locks == 0 || dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+    if(kind != FRWLOCK_KIND_PREFER_READER && kind != FRWLOCK_KIND_PREFER_WRITER) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, frwlock_advisev(num_locks, kind)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    locks = *dest;
+    for(size_t i = 0; i < num_locks; i++) {
+        locks[i].kind = kind;
+        atomic_store_explicit(&(locks[i].waiting_readers), 0, memory_order_relaxed);
+        atomic_store_explicit(&(locks[i].writer_seq), 0, memory_order_relaxed);
+        atomic_store_explicit(&(locks[i].state), 0, memory_order_release);
+    }
+
+    return 0;
+}
+
+void frwlock_deinit(Frwlock *lock) {
+    if(lock == NULL) {
+        return;
+    }
+
+    // nothing should be dependent on lock->state when this is set
+    atomic_store_explicit(&(lock->state), 0, memory_order_release);
+
+    return;
+}
+
+void frwlock_destroy(Frwlock *lock) {
+    if(lock == NULL) {
+        return;
+    }
+
+    frwlock_deinit(lock);
+    free(lock);
+
+    return;
+}
+
+int frwlock_read_lock(Frwlock *lock) {
+    long res;
+    uint32_t state;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    state = atomic_fetch_add_explicit(&(lock->state), FRWLOCK_READER, memory_order_acquire);
+    if(!frwlock_read_blocked(lock, state) && (state & FRWLOCK_READERS_MASK) < FRWLOCK_READERS_MAX) {
+        return 0;
+    }
+
+    // back out the same way a reader leaves, so a writer waiting for readers to drain is still woken
+    res = frwlock_read_unlock(lock);
+    if(res != 0) {
+        return res;
+    }
+
+    state = atomic_load_explicit(&(lock->state), memory_order_relaxed);
+    while(true) {
+        if((state & FRWLOCK_READERS_MASK) >= FRWLOCK_READERS_MAX) {
+            return EAGAIN;
+        }
+
+        if(!frwlock_read_blocked(lock, state)) {
+            if(atomic_compare_exchange_weak_explicit(&(lock->state), &state, state + FRWLOCK_READER, memory_order_acquire, memory_order_relaxed)) {
+                return 0;
+            }
+            continue;
+        }
+
+        // writers only wake readers when they see one counted here
+        atomic_fetch_add_explicit(&(lock->waiting_readers), 1, memory_order_seq_cst);
+        state = atomic_load_explicit(&(lock->state), memory_order_seq_cst);
+        if(frwlock_read_blocked(lock, state)) {
+            // want to perform FUTEX_WAIT_PRIVATE syscall
+            // Returns 0 after being woken, or fails with EAGAIN if lock->state changed in the meantime
+            // EINTR only means a signal arrived, in every case check again
+            errno = 0;
+            res = syscall(SYS_futex, &(lock->state), FUTEX_WAIT_PRIVATE, state, NULL);
+            if(res != 0 && errno != EAGAIN && errno != EINTR) {
+                res = errno;
+                atomic_fetch_sub_explicit(&(lock->waiting_readers), 1, memory_order_seq_cst);
+                printf("error with FUTEX_WAIT in %s = %ld\n", __func__, res);
+                return res;
+            }
+            errno = 0;
+        }
+        atomic_fetch_sub_explicit(&(lock->waiting_readers), 1, memory_order_seq_cst);
+        state = atomic_load_explicit(&(lock->state), memory_order_relaxed);
+    }
+}
+
+int frwlock_read_unlock(Frwlock *lock) {
+    uint32_t state;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    if((atomic_load_explicit(&(lock->state), memory_order_relaxed) & FRWLOCK_READERS_MASK) == 0) {
+        return EPERM;
+    }
+
+    state = atomic_fetch_sub_explicit(&(lock->state), FRWLOCK_READER, memory_order_release);
+
+    // the last reader out lets a waiting writer in
+    if((state & FRWLOCK_READERS_MASK) == 1 && (state & FRWLOCK_WAITING_WRITERS_MASK) != 0 && (state & FRWLOCK_WRITER) == 0) {
+        return frwlock_wake_writer(lock);
+    }
+
+    return 0;
+}
+
+int frwlock_write_lock(Frwlock *lock) {
+    long res;
+    uint32_t state = 0, seq;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    if(atomic_compare_exchange_strong_explicit(&(lock->state), &state, FRWLOCK_WRITER, memory_order_acquire, memory_order_relaxed)) {
+        return 0;
+    }
+
+    // counting ourselves as waiting makes the last reader out wake a writer, and holds back new readers
+    // when FRWLOCK_KIND_PREFER_WRITER
+    state = atomic_fetch_add_explicit(&(lock->state), FRWLOCK_WAITING_WRITER, memory_order_seq_cst) + FRWLOCK_WAITING_WRITER;
+    while(true) {
+        if((state & (FRWLOCK_WRITER | FRWLOCK_READERS_MASK)) == 0) {
+            if(atomic_compare_exchange_weak_explicit(&(lock->state), &state, (state - FRWLOCK_WAITING_WRITER) | FRWLOCK_WRITER,
+                    memory_order_acquire, memory_order_relaxed)) {
+                return 0;
+            }
+            continue;
+        }
+
+        // anyone freeing the lock after this changes writer_seq before waking
+        seq = atomic_load_explicit(&(lock->writer_seq), memory_order_seq_cst);
+        state = atomic_load_explicit(&(lock->state), memory_order_seq_cst);
+        if((state & (FRWLOCK_WRITER | FRWLOCK_READERS_MASK)) != 0) {
+            errno = 0;
+            res = syscall(SYS_futex, &(lock->writer_seq), FUTEX_WAIT_PRIVATE, seq, NULL);
+            if(res != 0 && errno != EAGAIN && errno != EINTR) {
+                res = errno;
+                printf("error with FUTEX_WAIT in %s = %ld\n", __func__, res);
+
+                // readers held back by this writer may be asleep
+                atomic_fetch_sub_explicit(&(lock->state), FRWLOCK_WAITING_WRITER, memory_order_seq_cst);
+                frwlock_wake_readers(lock);
+                return res;
+            }
+            errno = 0;
+            state = atomic_load_explicit(&(lock->state), memory_order_relaxed);
+        }
+    }
+}
+
+int frwlock_write_unlock(Frwlock *lock) {
+    uint32_t state;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    if((atomic_load_explicit(&(lock->state), memory_order_relaxed) & FRWLOCK_WRITER) == 0) {
+        return EPERM;
+    }
+
+    state = atomic_fetch_and_explicit(&(lock->state), ~FRWLOCK_WRITER, memory_order_seq_cst);
+    if((state & FRWLOCK_WAITING_WRITERS_MASK) != 0) {
+        int res = frwlock_wake_writer(lock);
+        if(res != 0 || lock->kind == FRWLOCK_KIND_PREFER_WRITER) {
+            // readers keep waiting until no writer is left
+            return res;
+        }
+    }
+
+    return frwlock_wake_readers(lock);
+}
+
+bool frwlock_read_blocked(Frwlock *lock, uint32_t state) {
+    if((state & FRWLOCK_WRITER) != 0) {
+        return true;
+    }
+
+    return lock->kind == FRWLOCK_KIND_PREFER_WRITER && (state & FRWLOCK_WAITING_WRITERS_MASK) != 0;
+}
+
+int frwlock_wake_writer(Frwlock *lock) {
+    long res;
+
+    atomic_fetch_add_explicit(&(lock->writer_seq), 1, memory_order_seq_cst);
+    errno = 0;
+    res = syscall(SYS_futex, &(lock->writer_seq), FUTEX_WAKE_PRIVATE, 1);
+    if(res < 0) {
+        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+        return errno;
+    }
+
+    return 0;
+}
+
+int frwlock_wake_readers(Frwlock *lock) {
+    long res;
+
+    if(atomic_load_explicit(&(lock->waiting_readers), memory_order_seq_cst) == 0) {
+        return 0;
+    }
+
+    errno = 0;
+    res = syscall(SYS_futex, &(lock->state), FUTEX_WAKE_PRIVATE, INT_MAX);
+    if(res < 0) {
+        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+        return errno;
+    }
+
+    return 0;
+}
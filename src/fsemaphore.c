@@ -1,8 +1,7 @@
 #define _DEFAULT_SOURCE (1)
 
-#include <fmutex.h>
 #include <fsemaphore.h>
-#include <pointerarith.h>
+#include <fmutex_priv.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,20 +9,23 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <limits.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <linux/futex.h>
 #include <stdatomic.h>
+#include <time.h>
 
 Fsemaphore *fsemaphore_create(uint64_t val, uint64_t max) {
     Fsemaphore *sem;
     void *memory;
-    if(max == 0) {
+    if(max == 0 || max > UINT32_MAX || val > max) {
         return NULL;
     }
 
-    memory = malloc(fsemaphore_advise(val, max));
+    // stats make Fsemaphore cache line aligned, which malloc does not guarantee
+    memory = aligned_alloc(_Alignof(Fsemaphore), fsemaphore_advise(val, max));
     if(memory == NULL) {
         return NULL;
     }
@@ -42,8 +44,7 @@ size_t fsemaphore_advise(uint64_t val, uint64_t max) {
     (void)(val);
     (void)(max);
 
-    return 1 * ((1 * sizeof(Fsemaphore)) +
-                (fmutex_advise()));
+    return 1 * sizeof(Fsemaphore);
 }
 
 size_t fsemaphore_advisev(size_t num_sems, uint64_t val, uint64_t max) {
@@ -51,13 +52,12 @@ size_t fsemaphore_advisev(size_t num_sems, uint64_t val, uint64_t max) {
     (void)(val);
     (void)(max);
 
-    return num_sems * ((1 * sizeof(Fsemaphore)) +
-                       (fmutex_advise()));
+    return num_sems * sizeof(Fsemaphore);
 }
 
 int fsemaphore_init(Fsemaphore **dest, void *memory, uint64_t val, uint64_t max) {
     Fsemaphore *sem;
-    if(dest == NULL || memory == NULL || max == 0) {
+    if(dest == NULL || memory == NULL || max == 0 || max > UINT32_MAX || val > max) {
         return EINVAL;
     }
 
@@ -65,10 +65,6 @@ int fsemaphore_init(Fsemaphore **dest, void *memory, uint64_t val, uint64_t max)
     if(memset(sem, 0, fsemaphore_advise(val, max)) != sem) {
         return ENOTRECOVERABLE;
     }
-    memory = pointer_literal_addition(memory, sizeof(Fsemaphore));
-    if(fmutex_init(&(sem->mutex), memory) != 0) {
-        return EINVAL;
-    }
 
     sem->max = max;
     atomic_store_explicit(&(sem->counter), val, memory_order_release);
@@ -79,7 +75,7 @@ int fsemaphore_init(Fsemaphore **dest, void *memory, uint64_t val, uint64_t max)
 
 int fsemaphore_initv(size_t num_sems, Fsemaphore *dest[], void *memory, uint64_t val, uint64_t max) {
     Fsemaphore *sems;
-    if(dest == NULL || memory == NULL || max == 0) {
+    if(dest == NULL || memory == NULL || max == 0 || max > UINT32_MAX || val > max) {
         return EINVAL;
     }
 
@@ -87,17 +83,9 @@ int fsemaphore_initv(size_t num_sems, Fsemaphore *dest[], void *memory, uint64_t
     if(memset(sems, 0, fsemaphore_advisev(num_sems, val, max)) != sems) {
         return ENOTRECOVERABLE;
     }
-    for(uint64_t i = 0; i < num_sems; i++) {
-        memory = pointer_literal_addition(memory, sizeof(Fsemaphore));
-        if(fmutex_init(&(sems[i].mutex), memory) != 0) {
-            return EINVAL;
-        }
-        memory = pointer_literal_addition(memory, fmutex_advise());
-
+    for(size_t i = 0; i < num_sems; i++) {
         sems[i].max = max;
         atomic_store_explicit(&(sems[i].counter), val, memory_order_release);
-
-        memory = pointer_literal_addition(memory, fsemaphore_advise(val, max));
     }
 
     *dest = sems;
@@ -109,7 +97,6 @@ void fsemaphore_deinit(Fsemaphore *sem) {
         return;
     }
 
-    fmutex_deinit(sem->mutex);
     atomic_store_explicit(&(sem->counter), 0, memory_order_release);
     memset(sem, 0, sizeof(Fsemaphore));
 
@@ -127,149 +114,204 @@ void fsemaphore_destroy(Fsemaphore *sem) {
     return;
 }
 
+// Wake up to num_threads threads sleeping on sem->counter, skipping the syscall when none can be
+static int fsemaphore_wake(Fsemaphore *sem, int num_threads) {
+    long res;
+
+    // seq_cst so this load is ordered after the caller's change to counter,
+    // pairs with the seq_cst increment of waiters in fsemaphore_wait_n
+    if(atomic_load_explicit(&(sem->waiters), memory_order_seq_cst) == 0) {
+        return 0;
+    }
+
+    errno = 0;
+    res = syscall(SYS_futex, &(sem->counter), FUTEX_WAKE_PRIVATE, num_threads);
+    if(res < 0) {
+        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+        return errno;
+    }
+
+    return 0;
+}
+
 int fsemaphore_exhaust(Fsemaphore *sem) {
-    int res;
     if(sem == NULL) {
         return EINVAL;
     }
 
-    res = fmutex_lock(sem->mutex);
-    if(res != 0) {
-        return res;
-    }
     atomic_store_explicit(&(sem->counter), 0, memory_order_release);
-    res = fmutex_unlock(sem->mutex);
-    if(res != 0) {
-        return res;
-    }
 
     return 0;
 }
 
-int fsemaphore_wait(Fsemaphore *sem) {
+// shared by fsemaphore_wait_n and fsemaphore_timedwait_n, NULL abstime means wait forever
+static int fsemaphore_wait_until(Fsemaphore *sem, uint32_t num_permits, const struct timespec *abstime) {
     long res;
-    bool mutex_locked = false;
-    bool decremented = false;
-    if(sem == NULL) {
-        return EINVAL;
+    uint32_t counter;
+
+    // fast path, take the permits with a single compare and swap
+    counter = atomic_load_explicit(&(sem->counter), memory_order_relaxed);
+    while(counter >= num_permits) {
+        if(atomic_compare_exchange_weak_explicit(&(sem->counter), &counter, counter - num_permits,
+                memory_order_acquire, memory_order_relaxed)) {
+            FSTATS_ACQUIRE(&(sem->stats));
+            return 0;
+        }
     }
 
-    while(!decremented) {
-        res = fmutex_lock(sem->mutex);
-        if(res != 0) {
-            goto fsemaphore_wait_error;
+    FSTATS_WAIT_START(wait_start);
+    while(true) {
+        // register before sleeping so that posters know a wake is needed
+        atomic_fetch_add_explicit(&(sem->waiters), 1, memory_order_seq_cst);
+        if(num_permits > 1) {
+            atomic_fetch_add_explicit(&(sem->batch_waiters), 1, memory_order_seq_cst);
         }
-        mutex_locked = true;
-        if(atomic_load_explicit(&(sem->counter), memory_order_acquire) > 0) {
-            atomic_fetch_sub_explicit(&(sem->counter), 1, memory_order_release);
-            decremented = true;
-        } else {
-            res = fmutex_unlock(sem->mutex);
-            if(res != 0) {
-                goto fsemaphore_wait_error;
-            }
-            mutex_locked = false;
-
-            // want to perform FUTEX_WAIT_PRIVATE syscall
-            // Successful result i.e. result in which sem->counter != 0 can be signaled in two ways
-            // First, syscall itself returns 0 if waited then awaken
-            // Two, syscall failed with -1 as sem->counter was not 0, errno is EAGAIN
 
+        // a post may have landed before registering, in which case it skipped the wake
+        res = 0;
+        counter = atomic_load_explicit(&(sem->counter), memory_order_seq_cst);
+        if(counter < num_permits) {
+            // want to perform FUTEX_WAIT_BITSET_PRIVATE syscall, which unlike FUTEX_WAIT takes an absolute CLOCK_MONOTONIC timeout
+            // Returns 0 once woken, fails with EAGAIN if counter already moved on from the value read
+            // ETIMEDOUT means abstime passed while counter was unchanged
+            FSTATS_FUTEX_WAIT(&(sem->stats));
             errno = 0;
-            res = syscall(SYS_futex, &(sem->counter), FUTEX_WAIT_PRIVATE, 0, NULL);
-            if(res == 0 || errno == EAGAIN) {
-                // proceed
-            } else {
+            res = syscall(SYS_futex, &(sem->counter), FUTEX_WAIT_BITSET_PRIVATE, counter, abstime, NULL, FUTEX_BITSET_MATCH_ANY);
+            if(res != 0 && errno != EAGAIN && errno != EINTR) {
                 res = errno;
-                goto fsemaphore_wait_error;
+                if(res != ETIMEDOUT) {
+                    printf("error with FUTEX_WAIT_BITSET in %s = %ld\n", __func__, res);
+                }
+            } else {
+                res = 0;
             }
-            errno = 0;
         }
-    }
 
-fsemaphore_wait_error:
-    if(mutex_locked) {
-        fmutex_unlock(sem->mutex);
-        mutex_locked = false;
+        if(num_permits > 1) {
+            atomic_fetch_sub_explicit(&(sem->batch_waiters), 1, memory_order_relaxed);
+        }
+        atomic_fetch_sub_explicit(&(sem->waiters), 1, memory_order_relaxed);
+        if(res != 0) {
+            return res;
+        }
+
+        counter = atomic_load_explicit(&(sem->counter), memory_order_relaxed);
+        while(counter >= num_permits) {
+            if(atomic_compare_exchange_weak_explicit(&(sem->counter), &counter, counter - num_permits,
+                    memory_order_acquire, memory_order_relaxed)) {
+                FSTATS_ACQUIRE_CONTENDED(&(sem->stats), wait_start);
+                return 0;
+            }
+        }
     }
-    if(res != 0) {
-        printf("error with FUTEX_WAKE in %s = %ld\n", __func__, res);
+}
+
+int fsemaphore_wait(Fsemaphore *sem) {
+    return fsemaphore_wait_n(sem, 1);
+}
+
+int fsemaphore_wait_n(Fsemaphore *sem, uint32_t num_permits) {
+    if(sem == NULL || num_permits == 0 || num_permits > sem->max) {
+        return EINVAL;
     }
-    return res;
+
+    return fsemaphore_wait_until(sem, num_permits, NULL);
 }
 
-int fsemaphore_post(Fsemaphore *sem) {
-    bool mutex_locked = false;
-    long res;
+int fsemaphore_trywait(Fsemaphore *sem) {
+    return fsemaphore_trywait_n(sem, 1);
+}
 
-    res = fmutex_lock(sem->mutex);
-    if(res != 0) {
-        goto fsemaphore_post_error;
+int fsemaphore_trywait_n(Fsemaphore *sem, uint32_t num_permits) {
+    uint32_t counter;
+    if(sem == NULL || num_permits == 0 || num_permits > sem->max) {
+        return EINVAL;
     }
-    mutex_locked = true;
-    if(atomic_load_explicit(&(sem->counter), memory_order_acquire) == sem->max) {
-        res = EDEADLK;
-        goto fsemaphore_post_error;
-    } else {
-        atomic_fetch_add_explicit(&(sem->counter), 1, memory_order_release);
-
-        errno = 0;
-        res = syscall(SYS_futex, &(sem->counter), FUTEX_WAKE_PRIVATE, 1);
-        if(res < 0) {
-            goto fsemaphore_post_error;
-        }
-        res = 0;
 
-        res = fmutex_unlock(sem->mutex);
-        if(res != 0) {
-            goto fsemaphore_post_error;
+    counter = atomic_load_explicit(&(sem->counter), memory_order_relaxed);
+    do {
+        if(counter < num_permits) {
+            return EAGAIN;
         }
-        mutex_locked = false;
+    } while(!atomic_compare_exchange_weak_explicit(&(sem->counter), &counter, counter - num_permits,
+                memory_order_acquire, memory_order_relaxed));
+
+    FSTATS_ACQUIRE(&(sem->stats));
+    return 0;
+}
+
+int fsemaphore_timedwait(Fsemaphore *sem, const struct timespec *abstime) {
+    return fsemaphore_timedwait_n(sem, 1, abstime);
+}
+
+int fsemaphore_timedwait_n(Fsemaphore *sem, uint32_t num_permits, const struct timespec *abstime) {
+    if(sem == NULL || num_permits == 0 || num_permits > sem->max) {
+        return EINVAL;
+    }
+    // the kernel would reject these too, but only once it got as far as sleeping
+    if(abstime == NULL || !FMUTEX_TIMESPEC_VALID(abstime)) {
+        return EINVAL;
     }
 
-fsemaphore_post_error:
-    if(mutex_locked) {
-        fmutex_unlock(sem->mutex);
-        mutex_locked = false;
+    return fsemaphore_wait_until(sem, num_permits, abstime);
+}
+
+int fsemaphore_post(Fsemaphore *sem) {
+    return fsemaphore_post_n(sem, 1);
+}
+
+int fsemaphore_post_n(Fsemaphore *sem, uint32_t num_permits) {
+    uint32_t counter;
+    if(sem == NULL || num_permits == 0) {
+        return EINVAL;
     }
-    if(res != 0) {
-        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+
+    counter = atomic_load_explicit(&(sem->counter), memory_order_relaxed);
+    do {
+        if(num_permits > sem->max - counter) {
+            return EDEADLK;
+        }
+    } while(!atomic_compare_exchange_weak_explicit(&(sem->counter), &counter, counter + num_permits,
+                memory_order_seq_cst, memory_order_relaxed));
+
+    // a waiter after several permits may need these on top of ones already posted,
+    // and only it can tell, so wake everyone when there is one
+    if(atomic_load_explicit(&(sem->batch_waiters), memory_order_seq_cst) > 0) {
+        return fsemaphore_wake(sem, INT_MAX);
     }
-    return 0;
+    return fsemaphore_wake(sem, num_permits > INT_MAX ? INT_MAX : (int) num_permits);
 }
 
 int fsemaphore_reset(Fsemaphore *sem) {
-    long res;
-    bool mutex_locked = false;
     if(sem == NULL) {
         return EINVAL;
     }
 
-    res = fmutex_lock(sem->mutex);
-    if(res != 0) {
-        goto fsemaphore_reset_error;
-    }
-    mutex_locked = true;
-    atomic_store_explicit(&(sem->counter), sem->max, memory_order_release);
-    errno = 0;
-    res = syscall(SYS_futex, &(sem->counter), FUTEX_WAKE_PRIVATE, sem->max);
-    if(res < 0) {
-        goto fsemaphore_reset_error;
-    }
-    res = 0;
-    res = fmutex_unlock(sem->mutex);
-    if(res != 0) {
-        return res;
-    }
-    mutex_locked = false;
+    atomic_store_explicit(&(sem->counter), sem->max, memory_order_seq_cst);
 
-fsemaphore_reset_error:
-    if(mutex_locked) {
-        fmutex_unlock(sem->mutex);
-        mutex_locked = false;
+    return fsemaphore_wake(sem, INT_MAX);
+}
+
+int fsemaphore_stats(Fsemaphore *sem, Fstats *dest) {
+    if(sem == NULL || dest == NULL) {
+        return EINVAL;
     }
-    if(res != 0) {
-        printf("error with FUTEX_WAKE in %s = %d\n", __func__, errno);
+
+#ifdef DERT_STATS
+    fstats_sum(&(sem->stats), dest);
+    return 0;
+#else
+    memset(dest, 0, sizeof(Fstats));
+    return ENOTSUP;
+#endif
+}
+
+void fsemaphore_stats_reset(Fsemaphore *sem) {
+    if(sem == NULL) {
+        return;
     }
-    return res;
+
+#ifdef DERT_STATS
+    fstats_clear(&(sem->stats));
+#endif
 }
@@ -0,0 +1,248 @@
+#define _DEFAULT_SOURCE (1)
+
+#include <fseqlock.h>
+#include <fmutex.h>
+#include <fmutex_priv.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+Fseqlock *fseqlock_create(void) {
+    void *memory;
+    Fseqlock *lock;
+
+    // stats make the embedded Fmutex cache line aligned, which malloc does not guarantee
+    memory = aligned_alloc(_Alignof(Fseqlock), fseqlock_advise());
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    if(fseqlock_init(&lock, memory) != 0) {
+        free(memory);
+        memory = NULL;
+        return NULL;
+    }
+
+    return lock;
+}
+
+size_t fseqlock_advise(void) {
+    return 1 * sizeof(Fseqlock);
+}
+
+size_t fseqlock_advisev(size_t num_locks) {
+    return num_locks * (1 * sizeof(Fseqlock));
+}
+
+int fseqlock_init(Fseqlock **dest, void *memory) {
+    Fseqlock *lock;
+    Fmutex *mutex;
+    if(dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fseqlock_advise()) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    lock = *dest;
+    if(fmutex_init(&mutex, &(lock->mutex)) != 0) {
+        return EINVAL;
+    }
+    atomic_store_explicit(&(lock->seq), 0, memory_order_release);
+
+    return 0;
+}
+
+int fseqlock_initv(size_t num_locks, Fseqlock *dest[], void *memory) {
+    Fseqlock *locks;
+    Fmutex *mutex;
+    if(num_locks == 0 || dest == NULL || memory == NULL) {
+        return EINVAL;
+    }
+
+    if(memset(memory, 0, fseqlock_advisev(num_locks)) != memory) {
+        return ENOTRECOVERABLE;
+    }
+    *dest = memory;
+    locks = *dest;
+    for(size_t i = 0; i < num_locks; i++) {
+        if(fmutex_init(&mutex, &(locks[i].mutex)) != 0) {
+            return EINVAL;
+        }
+        atomic_store_explicit(&(locks[i].seq), 0, memory_order_release);
+    }
+
+    return 0;
+}
+
+void fseqlock_deinit(Fseqlock *lock) {
+    if(lock == NULL) {
+        return;
+    }
+
+    fmutex_deinit(&(lock->mutex));
+    // nothing should be dependent on lock->seq when this is set
+    atomic_store_explicit(&(lock->seq), 0, memory_order_release);
+
+    return;
+}
+
+void fseqlock_destroy(Fseqlock *lock) {
+    if(lock == NULL) {
+        return;
+    }
+
+    fseqlock_deinit(lock);
+    free(lock);
+
+    return;
+}
+
+uint32_t fseqlock_read_begin(Fseqlock *lock) {
+    uint32_t seq;
+
+    if(lock == NULL) {
+        return 0;
+    }
+
+    // writers only hold the lock briefly, but may have been preempted while holding it
+    // so stop burning the time slice after a while
+    for(size_t i = 0; ((seq = atomic_load_explicit(&(lock->seq), memory_order_acquire)) & 1) != 0; i++) {
+        if(i < FMUTEX_SPIN) {
+            FMUTEX_PAUSE();
+        } else {
+            sched_yield();
+        }
+    }
+
+    return seq;
+}
+
+bool fseqlock_read_retry(Fseqlock *lock, uint32_t start) {
+    if(lock == NULL) {
+        return false;
+    }
+
+    // keep the reads of the data from moving after the second read of seq
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&(lock->seq), memory_order_relaxed) != start;
+}
+
+int fseqlock_write_lock(Fseqlock *lock) {
+    int res;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    res = fmutex_lock(&(lock->mutex));
+    if(res != 0) {
+        return res;
+    }
+
+    // only the writer changes seq, and the mutex orders writers
+    // the fence keeps the writes to the data from moving before seq turns odd
+    atomic_store_explicit(&(lock->seq), atomic_load_explicit(&(lock->seq), memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    return 0;
+}
+
+int fseqlock_write_trylock(Fseqlock *lock) {
+    int res;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    res = fmutex_trylock(&(lock->mutex));
+    if(res != 0) {
+        return res;
+    }
+
+    atomic_store_explicit(&(lock->seq), atomic_load_explicit(&(lock->seq), memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    return 0;
+}
+
+int fseqlock_write_unlock(Fseqlock *lock) {
+    uint32_t seq;
+
+    if(lock == NULL) {
+        return EINVAL;
+    }
+
+    seq = atomic_load_explicit(&(lock->seq), memory_order_relaxed);
+    if((seq & 1) == 0) {
+        return EPERM;
+    }
+
+    atomic_store_explicit(&(lock->seq), seq + 1, memory_order_release);
+    return fmutex_unlock(&(lock->mutex));
+}
+
+// Copy that may race with fseqlock_copy_to, done a word at a time when everything is aligned for it
+// Plain memcpy would be a data race, which the compiler is allowed to assume never happens
+static void fseqlock_copy_from(void *dest, const void *src, size_t size) {
+    if(((((uintptr_t) dest) | ((uintptr_t) src) | size) % sizeof(uint64_t)) == 0) {
+        for(size_t i = 0; i < size / sizeof(uint64_t); i++) {
+            ((uint64_t *) dest)[i] = __atomic_load_n(&(((const uint64_t *) src)[i]), __ATOMIC_RELAXED);
+        }
+    } else {
+        for(size_t i = 0; i < size; i++) {
+            ((unsigned char *) dest)[i] = __atomic_load_n(&(((const unsigned char *) src)[i]), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Counterpart of fseqlock_copy_from for the writer
+static void fseqlock_copy_to(void *dest, const void *src, size_t size) {
+    if(((((uintptr_t) dest) | ((uintptr_t) src) | size) % sizeof(uint64_t)) == 0) {
+        for(size_t i = 0; i < size / sizeof(uint64_t); i++) {
+            __atomic_store_n(&(((uint64_t *) dest)[i]), ((const uint64_t *) src)[i], __ATOMIC_RELAXED);
+        }
+    } else {
+        for(size_t i = 0; i < size; i++) {
+            __atomic_store_n(&(((unsigned char *) dest)[i]), ((const unsigned char *) src)[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+int fseqlock_read(Fseqlock *lock, void *dest, const void *src, size_t size) {
+    uint32_t seq;
+
+    if(lock == NULL || (size != 0 && (dest == NULL || src == NULL))) {
+        return EINVAL;
+    }
+
+    do {
+        seq = fseqlock_read_begin(lock);
+        fseqlock_copy_from(dest, src, size);
+    } while(fseqlock_read_retry(lock, seq));
+
+    return 0;
+}
+
+int fseqlock_write(Fseqlock *lock, void *dest, const void *src, size_t size) {
+    int res;
+
+    if(lock == NULL || (size != 0 && (dest == NULL || src == NULL))) {
+        return EINVAL;
+    }
+
+    res = fseqlock_write_lock(lock);
+    if(res != 0) {
+        return res;
+    }
+    fseqlock_copy_to(dest, src, size);
+
+    return fseqlock_write_unlock(lock);
+}
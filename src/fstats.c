@@ -0,0 +1,105 @@
+#include <fstats.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+// Stripe this thread updates, 0 until the thread first records anything
+static __thread size_t fstats_stripe_index = 0;
+
+// Hands out stripes to threads in turn
+static _Atomic size_t fstats_stripe_next = 0;
+
+static struct fstats_stripe *fstats_stripe(Fstats_stripes *stats) {
+    if(fstats_stripe_index == 0) {
+        fstats_stripe_index = (atomic_fetch_add_explicit(&fstats_stripe_next, 1, memory_order_relaxed) % FSTATS_STRIPES) + 1;
+    }
+
+    return &(stats->stripes[fstats_stripe_index - 1]);
+}
+
+// Raise *max to at least value
+static void fstats_max_raise(_Atomic uint64_t *max, uint64_t value) {
+    uint64_t expected = atomic_load_explicit(max, memory_order_relaxed);
+
+    while(expected < value && !atomic_compare_exchange_weak_explicit(max, &expected, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+uint64_t fstats_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (((uint64_t) now.tv_sec) * 1000000000) + ((uint64_t) now.tv_nsec);
+}
+
+uint64_t fstats_acquire(Fstats_stripes *stats, uint64_t wait_start_ns) {
+    struct fstats_stripe *stripe = fstats_stripe(stats);
+    uint64_t now = fstats_now();
+
+    // other threads sharing the stripe are rare, so these stay uncontended atomics
+    atomic_fetch_add_explicit(&(stripe->acquisitions), 1, memory_order_relaxed);
+    if(wait_start_ns != 0) {
+        atomic_fetch_add_explicit(&(stripe->contended), 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&(stripe->wait_ns), now - wait_start_ns, memory_order_relaxed);
+        fstats_max_raise(&(stripe->wait_max_ns), now - wait_start_ns);
+    }
+
+    return now;
+}
+
+void fstats_futex_wait(Fstats_stripes *stats) {
+    atomic_fetch_add_explicit(&(fstats_stripe(stats)->futex_waits), 1, memory_order_relaxed);
+}
+
+void fstats_release(Fstats_stripes *stats, uint64_t acquired_ns) {
+    uint64_t held = fstats_now() - acquired_ns;
+    size_t bucket = 0;
+
+    if(held != 0) {
+        bucket = 64 - __builtin_clzll(held);
+    }
+    if(bucket >= FSTATS_HISTOGRAM_BUCKETS) {
+        bucket = FSTATS_HISTOGRAM_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&(fstats_stripe(stats)->hold_histogram[bucket]), 1, memory_order_relaxed);
+}
+
+void fstats_sum(Fstats_stripes *stats, Fstats *dest) {
+    struct fstats_stripe *stripe;
+    uint64_t max;
+
+    memset(dest, 0, sizeof(Fstats));
+    for(size_t i = 0; i < FSTATS_STRIPES; i++) {
+        stripe = &(stats->stripes[i]);
+        dest->acquisitions += atomic_load_explicit(&(stripe->acquisitions), memory_order_relaxed);
+        dest->contended += atomic_load_explicit(&(stripe->contended), memory_order_relaxed);
+        dest->futex_waits += atomic_load_explicit(&(stripe->futex_waits), memory_order_relaxed);
+        dest->wait_ns += atomic_load_explicit(&(stripe->wait_ns), memory_order_relaxed);
+        max = atomic_load_explicit(&(stripe->wait_max_ns), memory_order_relaxed);
+        if(max > dest->wait_max_ns) {
+            dest->wait_max_ns = max;
+        }
+        for(size_t j = 0; j < FSTATS_HISTOGRAM_BUCKETS; j++) {
+            dest->hold_histogram[j] += atomic_load_explicit(&(stripe->hold_histogram[j]), memory_order_relaxed);
+        }
+    }
+}
+
+void fstats_clear(Fstats_stripes *stats) {
+    struct fstats_stripe *stripe;
+
+    for(size_t i = 0; i < FSTATS_STRIPES; i++) {
+        stripe = &(stats->stripes[i]);
+        atomic_store_explicit(&(stripe->acquisitions), 0, memory_order_relaxed);
+        atomic_store_explicit(&(stripe->contended), 0, memory_order_relaxed);
+        atomic_store_explicit(&(stripe->futex_waits), 0, memory_order_relaxed);
+        atomic_store_explicit(&(stripe->wait_ns), 0, memory_order_relaxed);
+        atomic_store_explicit(&(stripe->wait_max_ns), 0, memory_order_relaxed);
+        for(size_t j = 0; j < FSTATS_HISTOGRAM_BUCKETS; j++) {
+            atomic_store_explicit(&(stripe->hold_histogram[j]), 0, memory_order_relaxed);
+        }
+    }
+}
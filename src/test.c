@@ -5,11 +5,20 @@
 #include <pointerarith.h>
 
 #include <vpool.h>
+#include <vmalloc.h>
+#include <vmalloc_priv.h>
+#include <vallocator.h>
+#include <vstats.h>
 #include <varena.h>
 #include <varena_priv.h>
+#include <vscratch.h>
 #include <vdll.h>
+#include <vilist.h>
 #include <tbuf.h>
 #include <varray.h>
+#include <varray_parallel.h>
+#include <varray_sort.h>
+#include <vsoa.h>
 #include <vstack.h>
 #include <vqueue.h>
 #include <aqueue.h>
@@ -17,9 +26,17 @@
 #include <tpoolrr.h>
 #include <gtpoolrr.h>
 #include <vht.h>
+#include <vht_priv.h>
 #include <fqueue.h>
 #include <fmutex.h>
+#include <frwlock.h>
+#include <fcond.h>
+#include <fevent.h>
+#include <fbarrier.h>
+#include <fmcs.h>
 #include <fsemaphore.h>
+#include <fstats.h>
+#include <fseqlock.h>
 #include <tree_T.h>
 #include <tree_iterator.h>
 
@@ -30,7 +47,9 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdatomic.h>
 #include <sys/random.h>
+#include <sys/wait.h>
 
 int seed;
 
@@ -54,6 +73,26 @@ int deinit_long(void *ptr) {
     return 0;
 }
 
+#define VARENA_TEST_CONCURRENT_THREADS (8)
+#define VARENA_TEST_CONCURRENT_ALLOCS (4096)
+struct varena_test_concurrent_arg {
+    Varena *arena;
+    uint32_t id;
+    uint32_t *allocs[VARENA_TEST_CONCURRENT_ALLOCS];
+};
+
+void *varena_test_concurrent_thread(void *arg) {
+    struct varena_test_concurrent_arg *work = arg;
+
+    for(size_t i = 0; i < VARENA_TEST_CONCURRENT_ALLOCS; i++) {
+        // mix of sizes so some allocations bypass the thread's chunk
+        work->allocs[i] = varena_alloc_aligned(&(work->arena), (i % 64 == 0) ? 8192 : (i % 7) * 4 + 4, (i % 3 == 0) ? VARENA_CACHE_LINE_SIZE : 4);
+        assert(work->allocs[i] != NULL);
+        *(work->allocs[i]) = work->id * VARENA_TEST_CONCURRENT_ALLOCS + (uint32_t) i;
+    }
+    return NULL;
+}
+
 int varena_test(void) {
 #define FIRST_FRAME_SIZE (0x04)
 #define SECOND_FRAME_SIZE (0x04)
@@ -66,7 +105,7 @@ int varena_test(void) {
 #define F_CONSTANT (0xCCDDEEFF)
 
     int32_t *a, *b, *c, *d, *e, *f;
-    Varena *arena = varena_create(999);
+    Varena *arena = varena_create(999, VARENA_KIND_STATIC);
     assert(arena != NULL);
     assert(varena_arena_used(arena) == 0);
     assert(varena_arena_unused(arena) == 999);
@@ -75,20 +114,23 @@ int varena_test(void) {
     assert(varena_claim(&arena, FIRST_FRAME_SIZE) == 0);
     assert(varena_frame_used(arena) == 0);
     assert(varena_frame_unused(arena) >= FIRST_FRAME_SIZE);
+    assert(((uintptr_t) varena_frame_top(arena)) % VARENA_FRAME_ALIGNMENT == 0);
     a = varena_alloc(&arena, sizeof(int32_t));
     assert(a != NULL);
     assert(varena_frame_used(arena) >= FIRST_FRAME_SIZE);
-    assert(varena_frame_unused(arena) == 0);
+    // only the padding that aligns the frame record is left
+    assert(varena_frame_unused(arena) < VARENA_FRAME_ALIGNMENT);
     assert((void*) a < pointer_literal_addition(arena->bytes, arena->bottom));
     *a = A_CONSTANT;
 
     assert(varena_claim(&arena, SECOND_FRAME_SIZE) == 0);
     assert(varena_frame_used(arena) == 0);
     assert(varena_frame_unused(arena) >= SECOND_FRAME_SIZE);
+    assert(((uintptr_t) varena_frame_top(arena)) % VARENA_FRAME_ALIGNMENT == 0);
     b = varena_alloc(&arena, sizeof(int32_t));
     assert(b != NULL);
     assert(varena_frame_used(arena) >= SECOND_FRAME_SIZE);
-    assert(varena_frame_unused(arena) == 0);
+    assert(varena_frame_unused(arena) < VARENA_FRAME_ALIGNMENT);
     assert((void*) b < pointer_literal_addition(arena->bytes, arena->bottom));
     *b = B_CONSTANT;
 
@@ -104,7 +146,7 @@ int varena_test(void) {
     f = varena_alloc(&arena, sizeof(int32_t));
     *f = F_CONSTANT;
     assert(varena_frame_used(arena) >= THIRD_FRAME_SIZE);
-    assert(varena_frame_unused(arena) == 0);
+    assert(varena_frame_unused(arena) < VARENA_FRAME_ALIGNMENT);
 
     assert(c != NULL);
     assert((*c = C_CONSTANT));
@@ -128,6 +170,202 @@ int varena_test(void) {
     assert(varena_disclaim(&arena) == 0);
 
     varena_destroy(&arena);
+
+    // chained arena links new blocks rather than failing and never moves allocations
+    {
+#define VARENA_TEST_CHAINED_ALLOCS (999)
+        int32_t *allocs[VARENA_TEST_CHAINED_ALLOCS];
+        size_t first_cap;
+
+        arena = varena_create(64, VARENA_KIND_CHAINED);
+        assert(arena != NULL);
+        first_cap = varena_arena_cap(arena);
+        assert(varena_claim(&arena, FIRST_FRAME_SIZE) == 0);
+        a = varena_alloc(&arena, sizeof(int32_t));
+        assert(a != NULL);
+        *a = A_CONSTANT;
+
+        // frame bigger than the first block
+        assert(varena_claim(&arena, 1000) == 0);
+        assert(varena_arena_cap(arena) > first_cap);
+        for(size_t i = 0; i < VARENA_TEST_CHAINED_ALLOCS; i++) {
+            allocs[i] = varena_alloc(&arena, sizeof(int32_t));
+            assert(allocs[i] != NULL);
+            *(allocs[i]) = (int32_t) i;
+        }
+        for(size_t i = 0; i < VARENA_TEST_CHAINED_ALLOCS; i++) {
+            assert(*(allocs[i]) == (int32_t) i);
+        }
+        assert(*a == A_CONSTANT);
+        assert(varena_disclaim(&arena) == 0);
+        assert(varena_arena_cap(arena) == first_cap);
+        assert(*a == A_CONSTANT);
+
+        // released block is reused
+        assert(varena_claim(&arena, 1000) == 0);
+        b = varena_alloc(&arena, 1000);
+        assert(b != NULL);
+        assert(varena_disclaim(&arena) == 0);
+        assert(varena_disclaim(&arena) == 0);
+        assert(varena_disclaim(&arena) != 0);
+        assert(varena_arena_used(arena) == 0);
+        varena_destroy(&arena);
+    }
+
+    // virtual arena reserves address space up front and only commits what frames need
+    {
+#define VARENA_TEST_VIRTUAL_RESERVE ((size_t) 1 << 30)
+#define VARENA_TEST_VIRTUAL_FRAME ((size_t) 8 << 20)
+        char *bytes, *next;
+
+        arena = varena_create(VARENA_TEST_VIRTUAL_RESERVE, VARENA_KIND_VIRTUAL);
+        assert(arena != NULL);
+        assert(varena_arena_cap(arena) == VARENA_TEST_VIRTUAL_RESERVE);
+        assert(arena->committed == 0);
+        assert(varena_retain(arena, 64 * 1024) == 0);
+
+        // pages are committed as allocations reach them rather than when the frame is claimed
+        assert(varena_claim(&arena, VARENA_TEST_VIRTUAL_FRAME) == 0);
+        assert(arena->committed < VARENA_TEST_VIRTUAL_FRAME);
+        bytes = varena_alloc(&arena, 1);
+        assert(bytes != NULL);
+        assert(arena->committed <= VARENA_VIRTUAL_COMMIT_GRANULE);
+        assert(varena_alloc(&arena, VARENA_TEST_VIRTUAL_FRAME - 1) == bytes + 1);
+        assert(arena->committed >= VARENA_TEST_VIRTUAL_FRAME);
+        assert(arena->committed < VARENA_TEST_VIRTUAL_RESERVE);
+        memset(bytes, 0x5a, VARENA_TEST_VIRTUAL_FRAME);
+
+        // allocations in a later frame are contiguous with the earlier one
+        assert(varena_claim(&arena, VARENA_TEST_VIRTUAL_FRAME) == 0);
+        next = varena_alloc(&arena, 1);
+        assert(next != NULL);
+        assert(next > bytes + VARENA_TEST_VIRTUAL_FRAME - 1);
+        assert(next < bytes + 2 * VARENA_TEST_VIRTUAL_FRAME);
+        *next = 1;
+        assert(varena_disclaim(&arena) == 0);
+        assert(bytes[VARENA_TEST_VIRTUAL_FRAME - 1] == 0x5a);
+        assert(varena_disclaim(&arena) == 0);
+        assert(arena->committed <= 64 * 1024);
+
+        // frame larger than the reservation fails instead of growing
+        assert(varena_claim(&arena, VARENA_TEST_VIRTUAL_RESERVE) != 0);
+
+        // decommitted pages can be committed again
+        assert(varena_claim(&arena, VARENA_TEST_VIRTUAL_FRAME) == 0);
+        bytes = varena_alloc(&arena, VARENA_TEST_VIRTUAL_FRAME);
+        assert(bytes != NULL);
+        memset(bytes, 0xa5, VARENA_TEST_VIRTUAL_FRAME);
+        assert(varena_disclaim(&arena) == 0);
+        varena_destroy(&arena);
+    }
+
+    // aligned allocations are aligned by address no matter what was allocated before
+    {
+        char *odd;
+        double *doubles;
+        float *lines;
+
+        arena = varena_create(4096, VARENA_KIND_STATIC);
+        assert(arena != NULL);
+        assert(varena_claim(&arena, 2048) == 0);
+        odd = varena_alloc(&arena, 3);
+        assert(odd != NULL);
+        lines = varena_alloc_aligned(&arena, 100, VARENA_CACHE_LINE_SIZE);
+        assert(lines != NULL);
+        assert(((uintptr_t) lines) % VARENA_CACHE_LINE_SIZE == 0);
+        assert((char*) lines >= odd + 3);
+        assert(varena_alloc_aligned(&arena, 1, 3) == NULL);
+        assert(varena_alloc_aligned(&arena, 1, 0) == NULL);
+        odd = varena_alloc(&arena, 1);
+        doubles = VARENA_ALLOC_ARRAY(&arena, double, 10);
+        assert(doubles != NULL);
+        assert(((uintptr_t) doubles) % _Alignof(double) == 0);
+        doubles[9] = 1.0;
+        lines = VARENA_ALLOC_ARRAY_CACHE_LINE(&arena, float, 16);
+        assert(lines != NULL);
+        assert(((uintptr_t) lines) % VARENA_CACHE_LINE_SIZE == 0);
+        assert(VARENA_ALLOC_ARRAY(&arena, double, SIZE_MAX / 4) == NULL);
+
+        assert(varena_disclaim(&arena) == 0);
+        varena_destroy(&arena);
+
+        // continued frames keep the alignment, and so do the records they store
+        arena = varena_create(61, VARENA_KIND_CHAINED);
+        assert(arena != NULL);
+        assert(varena_claim(&arena, 8) == 0);
+        for(size_t i = 0; i < 64; i++) {
+            odd = varena_alloc(&arena, 5);
+            assert(odd != NULL);
+            lines = varena_alloc_aligned(&arena, 48, VARENA_CACHE_LINE_SIZE);
+            assert(lines != NULL);
+            assert(((uintptr_t) lines) % VARENA_CACHE_LINE_SIZE == 0);
+            assert(((uintptr_t) varena_frame_top(arena)) % VARENA_FRAME_ALIGNMENT == 0);
+            memset(lines, 0, 48);
+        }
+        assert(varena_disclaim(&arena) == 0);
+        varena_destroy(&arena);
+    }
+
+    // concurrent arena is shared by many threads at once and reset as a whole
+    {
+        static struct varena_test_concurrent_arg work[VARENA_TEST_CONCURRENT_THREADS];
+        pthread_t threads[VARENA_TEST_CONCURRENT_THREADS];
+
+        arena = varena_create(64 << 20, VARENA_KIND_CONCURRENT);
+        assert(arena != NULL);
+        assert(varena_claim(&arena, 16) != 0);
+        for(size_t round = 0; round < 2; round++) {
+            for(uint32_t i = 0; i < VARENA_TEST_CONCURRENT_THREADS; i++) {
+                work[i].arena = arena;
+                work[i].id = i;
+                assert(pthread_create(&(threads[i]), NULL, varena_test_concurrent_thread, &(work[i])) == 0);
+            }
+            for(uint32_t i = 0; i < VARENA_TEST_CONCURRENT_THREADS; i++) {
+                assert(pthread_join(threads[i], NULL) == 0);
+            }
+
+            // nothing was handed out twice
+            for(uint32_t i = 0; i < VARENA_TEST_CONCURRENT_THREADS; i++) {
+                for(size_t j = 0; j < VARENA_TEST_CONCURRENT_ALLOCS; j++) {
+                    assert(*(work[i].allocs[j]) == i * VARENA_TEST_CONCURRENT_ALLOCS + (uint32_t) j);
+                    if(j % 3 == 0) {
+                        assert(((uintptr_t) work[i].allocs[j]) % VARENA_CACHE_LINE_SIZE == 0);
+                    }
+                }
+            }
+            assert(varena_arena_used(arena) > 0);
+            assert(varena_reset(arena) == 0);
+            assert(varena_arena_used(arena) == 0);
+        }
+
+        // allocations stop once the arena is full
+        a = varena_alloc(&arena, 1);
+        assert(a != NULL);
+        assert(varena_alloc(&arena, 64 << 20) == NULL);
+        assert(varena_reset(arena) == 0);
+        assert(varena_alloc(&arena, 64 << 20) != NULL);
+        assert(varena_alloc(&arena, 1) == NULL);
+        varena_destroy(&arena);
+
+        // a thread keeps its chunk of each arena while allocating from others
+        {
+            Varena *other;
+            char *first, *second;
+
+            arena = varena_create(1 << 20, VARENA_KIND_CONCURRENT);
+            other = varena_create(1 << 20, VARENA_KIND_CONCURRENT);
+            assert(arena != NULL && other != NULL);
+            first = varena_alloc(&arena, 16);
+            assert(first != NULL);
+            assert(varena_alloc(&other, 16) != NULL);
+            second = varena_alloc(&arena, 16);
+            assert(second == first + 16);
+            assert(varena_arena_used(arena) == VARENA_CONCURRENT_CHUNK_BYTES);
+            varena_destroy(&other);
+            varena_destroy(&arena);
+        }
+    }
+
     return 0;
 }
 
@@ -249,36 +487,765 @@ int vpool_test(void) {
     return 0;
 }
 
+void vmalloc_test_late_free(void *block) {
+    vmalloc_free(block);
+}
+
+void *vmalloc_test_exiting_thread(void *arg) {
+    pthread_key_t *key = arg;
+    void *block;
+
+    block = vmalloc_alloc(20000);
+    assert(block != NULL);
+
+    // freed by a destructor that runs after vmalloc has already flushed this thread
+    assert(pthread_setspecific(*key, block) == 0);
+    return block;
+}
+
+void *vmalloc_test_reusing_thread(void *arg) {
+    void *blocks[VMALLOC_CACHE_DEPTH / 2];
+    bool found = false;
+
+    for(size_t i = 0; i < VMALLOC_CACHE_DEPTH / 2; i++) {
+        blocks[i] = vmalloc_alloc(20000);
+        assert(blocks[i] != NULL);
+        found = found || blocks[i] == arg;
+    }
+    for(size_t i = 0; i < VMALLOC_CACHE_DEPTH / 2; i++) {
+        vmalloc_free(blocks[i]);
+    }
+
+    return found ? arg : NULL;
+}
+
+void *vmalloc_test_churning_thread(void *arg) {
+    atomic_bool *stop = arg;
+    void *blocks[2 * VMALLOC_CACHE_DEPTH];
+
+    // keeps moving blocks between its cache and the size class so fork often lands while the mutex is held
+    while(!atomic_load(stop)) {
+        for(size_t i = 0; i < 2 * VMALLOC_CACHE_DEPTH; i++) {
+            blocks[i] = vmalloc_alloc(100);
+            assert(blocks[i] != NULL);
+        }
+        for(size_t i = 0; i < 2 * VMALLOC_CACHE_DEPTH; i++) {
+            vmalloc_free(blocks[i]);
+        }
+    }
+
+    return NULL;
+}
+
+int vmalloc_test(void) {
+#define VMALLOC_TEST_NUM_ALLOCS (999)
+    unsigned char *small[VMALLOC_TEST_NUM_ALLOCS];
+    unsigned char *large, *grown;
+    void *aligned, *late;
+    pthread_key_t late_key;
+    pthread_t thread;
+    atomic_bool stop = false;
+    pid_t child;
+    int status;
+
+    // each block size maps to the smallest size class that holds it, table lookup included
+    for(size_t b = 1; b <= VMALLOC_CLASS_MAX_BYTES; b++) {
+        assert(vmalloc_class_size(vmalloc_class_index(b)) >= b);
+        assert(vmalloc_class_index(b) == 0 || vmalloc_class_size(vmalloc_class_index(b) - 1) < b);
+    }
+
+    // every size class, reused after being freed
+    for(size_t round = 0; round < 2; round++) {
+        for(size_t i = 0; i < VMALLOC_TEST_NUM_ALLOCS; i++) {
+            small[i] = vmalloc_alloc(i * 33);
+            assert(small[i] != NULL);
+            assert((((size_t) small[i]) % 16) == 0);
+            assert(vmalloc_usable(small[i]) >= i * 33);
+            memset(small[i], (int) i, i * 33);
+        }
+        for(size_t i = 0; i < VMALLOC_TEST_NUM_ALLOCS; i++) {
+            for(size_t j = 0; j < i * 33; j++) {
+                assert(small[i][j] == (unsigned char) i);
+            }
+            vmalloc_free(small[i]);
+        }
+    }
+
+    small[0] = vmalloc_calloc(100, sizeof(long));
+    assert(small[0] != NULL);
+    for(size_t i = 0; i < 100 * sizeof(long); i++) {
+        assert(small[0][i] == 0);
+    }
+    vmalloc_free(small[0]);
+    assert(vmalloc_calloc(SIZE_MAX, 2) == NULL);
+
+    // growing from a size class into its own mapping keeps contents
+    grown = vmalloc_alloc(10);
+    assert(grown != NULL);
+    memcpy(grown, "012345678", 10);
+    grown = vmalloc_realloc(grown, 1 << 20);
+    assert(grown != NULL);
+    assert(!strcmp((char *) grown, "012345678"));
+    grown[(1 << 20) - 1] = 1;
+    grown = vmalloc_realloc(grown, 1 << 24);
+    assert(grown != NULL);
+    assert(!strcmp((char *) grown, "012345678"));
+    assert(grown[(1 << 20) - 1] == 1);
+    grown = vmalloc_realloc(grown, 5);
+    assert(grown != NULL);
+    assert(!memcmp(grown, "01234", 5));
+    vmalloc_free(grown);
+
+    large = vmalloc_calloc(1, 1 << 20);
+    assert(large != NULL);
+    assert(large[12345] == 0);
+    vmalloc_free(large);
+
+    assert(vmalloc_aligned(&aligned, 3, 10) == EINVAL);
+    assert(vmalloc_aligned(&aligned, 4096, 100) == 0);
+    assert((((size_t) aligned) % 4096) == 0);
+    assert(vmalloc_usable(aligned) >= 100);
+    memset(aligned, 1, 100);
+    vmalloc_free(aligned);
+
+    // blocks freed during thread exit go back to the shared size class
+    // the vmalloc key has to exist first so its destructor runs before the one freeing late
+    vmalloc_free(vmalloc_alloc(1));
+    assert(pthread_key_create(&late_key, vmalloc_test_late_free) == 0);
+    assert(pthread_create(&thread, NULL, vmalloc_test_exiting_thread, &late_key) == 0);
+    assert(pthread_join(thread, &late) == 0);
+    assert(pthread_create(&thread, NULL, vmalloc_test_reusing_thread, late) == 0);
+    assert(pthread_join(thread, &late) == 0);
+    assert(late != NULL);
+    assert(pthread_key_delete(late_key) == 0);
+
+    // a child forked while another thread uses a size class can still allocate from it
+    assert(pthread_create(&thread, NULL, vmalloc_test_churning_thread, &stop) == 0);
+    for(size_t i = 0; i < 20; i++) {
+        child = fork();
+        assert(child >= 0);
+        if(child == 0) {
+            for(size_t j = 0; j < 4 * VMALLOC_CACHE_DEPTH; j++) {
+                small[j] = vmalloc_alloc(100);
+                if(small[j] == NULL) {
+                    _exit(1);
+                }
+            }
+            for(size_t j = 0; j < 4 * VMALLOC_CACHE_DEPTH; j++) {
+                vmalloc_free(small[j]);
+            }
+            _exit(0);
+        }
+        assert(waitpid(child, &status, 0) == child);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    atomic_store(&stop, true);
+    assert(pthread_join(thread, NULL) == 0);
+
+    vmalloc_free(NULL);
+    return 0;
+}
+
+void vscratch_test_depth(size_t depth) {
+    VSCRATCH_SCOPE(scratch, 16);
+    size_t used;
+    char *bytes;
+
+    assert(scratch != NULL);
+    bytes = varena_alloc(&scratch, 1000);
+    assert(bytes != NULL);
+    memset(bytes, (int) depth, 1000);
+    if(depth > 0) {
+        used = varena_arena_used(scratch);
+        vscratch_test_depth(depth - 1);
+        assert(varena_arena_used(scratch) == used);
+    }
+    assert(bytes[999] == (char) depth);
+}
+
+void *vscratch_test_thread(void *arg) {
+    Varena **dest = arg;
+
+    *dest = vscratch_arena();
+    assert(*dest != NULL);
+    vscratch_test_depth(10);
+    return NULL;
+}
+
+int vscratch_test(void) {
+    Varena *arena, *other;
+    pthread_t thread;
+
+    arena = vscratch_arena();
+    assert(arena != NULL);
+    assert(vscratch_arena() == arena);
+    assert(varena_arena_used(arena) == 0);
+
+    // frames nest and are all released when their scopes end
+    vscratch_test_depth(100);
+    assert(varena_arena_used(arena) == 0);
+    {
+        VSCRATCH_SCOPE(scratch, 0);
+        assert(scratch == arena);
+        assert(VARENA_ALLOC_ARRAY(&scratch, long, 10000) != NULL);
+    }
+    assert(varena_arena_used(arena) == 0);
+
+    // every thread gets its own arena
+    assert(pthread_create(&thread, NULL, vscratch_test_thread, &other) == 0);
+    assert(pthread_join(thread, NULL) == 0);
+    assert(other != arena);
+
+    vscratch_end(NULL);
+    return 0;
+}
+
+struct vallocator_test_counts {
+    size_t allocs;
+    size_t reallocs;
+    size_t frees;
+    size_t bytes;
+};
+
+void *vallocator_test_alloc(void *ctx, size_t num_bytes) {
+    struct vallocator_test_counts *counts = ctx;
+
+    counts->allocs++;
+    counts->bytes += num_bytes;
+    return malloc(num_bytes);
+}
+
+void *vallocator_test_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+    struct vallocator_test_counts *counts = ctx;
+
+    counts->reallocs++;
+    counts->bytes += new_bytes;
+    counts->bytes -= old_bytes;
+    return realloc(ptr, new_bytes);
+}
+
+void vallocator_test_free(void *ctx, void *ptr, size_t num_bytes) {
+    struct vallocator_test_counts *counts = ctx;
+
+    counts->frees++;
+    counts->bytes -= num_bytes;
+    free(ptr);
+}
+
+int vallocator_test(void) {
+    struct vallocator_test_counts counts = { 0 };
+    Vallocator counting = { .alloc = vallocator_test_alloc, .realloc = vallocator_test_realloc, .free = vallocator_test_free, .ctx = &counts };
+    Vallocator from_arena, from_pool;
+    Varray *array;
+    Vht *table;
+    Vdll *dll;
+    Vqueue *queue;
+    Varena *arena;
+    Vpool *pool;
+    long val;
+
+    // every allocation is matched by a free of the same size
+    array = varray_create(sizeof(long), &counting);
+    assert(array != NULL);
+    for(size_t i = 0; i < 100; i++) {
+        assert(varray_resize(array, i + 1) == 0);
+        val = (long) i;
+        assert(varray_set(array, i, &val) == 0);
+    }
+    assert(counts.reallocs > 0);
+    varray_destroy(array);
+    table = vht_create(sizeof(long), sizeof(long), &counting);
+    assert(table != NULL);
+    for(long i = 0; i < 1000; i++) {
+        assert(vht_set(table, &i, &i) == 0);
+    }
+    vht_destroy(table);
+    queue = vqueue_create(sizeof(long), 10, &counting);
+    assert(queue != NULL);
+    vqueue_destroy(queue);
+    assert(counts.allocs > 0);
+    assert(counts.allocs == counts.frees);
+    assert(counts.bytes == 0);
+
+    // hash table growing inside an arena
+    arena = varena_create(1 << 20, VARENA_KIND_CHAINED);
+    assert(arena != NULL);
+    assert(varena_claim(&arena, 1024) == 0);
+    assert(vallocator_varena(&from_arena, &arena) == 0);
+    table = vht_create(sizeof(long), sizeof(long), &from_arena);
+    assert(table != NULL);
+    for(long i = 0; i < 1000; i++) {
+        assert(vht_set(table, &i, &i) == 0);
+    }
+    for(long i = 0; i < 1000; i++) {
+        assert(vht_get(table, &i, &val) == 0);
+        assert(val == i);
+    }
+    vht_destroy(table);
+    array = varray_create(sizeof(long), &from_arena);
+    assert(array != NULL);
+    assert(varray_resize(array, 1000) == 0);
+    assert(varray_get_direct(array, 999) != NULL);
+    varray_destroy(array);
+    assert(varena_disclaim(&arena) == 0);
+    varena_destroy(&arena);
+
+    // growing in place on a virtual arena commits the pages it reaches
+    {
+        unsigned char *grown;
+
+        arena = varena_create(512 << 20, VARENA_KIND_VIRTUAL);
+        assert(arena != NULL);
+        assert(varena_claim(&arena, 256 << 20) == 0);
+        assert(vallocator_varena(&from_arena, &arena) == 0);
+        grown = vallocator_alloc(&from_arena, 100);
+        assert(grown != NULL);
+        memset(grown, 1, 100);
+        assert(vallocator_realloc(&from_arena, grown, 100, 4 << 20) == grown);
+        memset(grown, 2, 4 << 20);
+        assert(vallocator_realloc(&from_arena, grown, 4 << 20, 8 << 20) == grown);
+        assert(grown[(4 << 20) - 1] == 2);
+        memset(grown, 3, 8 << 20);
+        assert(varena_disclaim(&arena) == 0);
+        varena_destroy(&arena);
+    }
+
+    // list nodes drawn from a pool
+    pool = vpool_create(10, sizeof(long) + 3 * sizeof(void*), VPOOL_KIND_DYNAMIC);
+    assert(pool != NULL);
+    assert(vallocator_vpool(&from_pool, pool) == 0);
+    dll = vdll_create(sizeof(long), VDLL_KIND_NODE, NULL, NULL);
+    assert(dll != NULL);
+    vdll_destroy(dll);
+    dll = malloc(sizeof(Vdll));
+    assert(dll != NULL);
+    assert(vdll_init(dll, sizeof(long), VDLL_KIND_NODE, NULL, &from_pool) == 0);
+    assert(vdll_grow(dll, 100) == 0);
+    for(size_t i = 0; i < 100; i++) {
+        val = (long) i;
+        assert(vdll_set(dll, i, &val) == 0);
+    }
+    assert(vdll_get(dll, 50, &val) == 0);
+    assert(val == 50);
+    assert(vdll_shrink(dll, 100) == 0);
+    assert(vdll_grow(dll, 10) == 0);
+    vdll_deinit(dll);
+    free(dll);
+    vpool_destroy(pool);
+
+    // large requests are mappings that stay zeroed past the requested size
+    {
+        unsigned char *big;
+
+        big = vallocator_calloc(NULL, 1, VALLOCATOR_MAP_THRESHOLD + 1);
+        assert(big != NULL);
+        memset(big, 0xff, VALLOCATOR_MAP_THRESHOLD + 1);
+        big = vallocator_realloc(NULL, big, VALLOCATOR_MAP_THRESHOLD + 1, 4 * VALLOCATOR_MAP_THRESHOLD);
+        assert(big != NULL);
+        assert(big[VALLOCATOR_MAP_THRESHOLD] == 0xff);
+        assert(big[VALLOCATOR_MAP_THRESHOLD + 1] == 0);
+        assert(big[4 * VALLOCATOR_MAP_THRESHOLD - 1] == 0);
+        memset(big, 0xff, 4 * VALLOCATOR_MAP_THRESHOLD);
+        big = vallocator_realloc(NULL, big, 4 * VALLOCATOR_MAP_THRESHOLD, VALLOCATOR_MAP_THRESHOLD + 3);
+        assert(big != NULL);
+        big = vallocator_realloc(NULL, big, VALLOCATOR_MAP_THRESHOLD + 3, 2 * VALLOCATOR_MAP_THRESHOLD);
+        assert(big != NULL);
+        assert(big[VALLOCATOR_MAP_THRESHOLD + 2] == 0xff);
+        for(size_t i = VALLOCATOR_MAP_THRESHOLD + 3; i < 2 * VALLOCATOR_MAP_THRESHOLD; i++) {
+            assert(big[i] == 0);
+        }
+
+        // crossing back below the threshold keeps contents
+        big = vallocator_realloc(NULL, big, 2 * VALLOCATOR_MAP_THRESHOLD, 100);
+        assert(big != NULL);
+        assert(big[99] == 0xff);
+        big = vallocator_realloc(NULL, big, 100, 2 * VALLOCATOR_MAP_THRESHOLD);
+        assert(big != NULL);
+        assert(big[99] == 0xff);
+        assert(big[100] == 0);
+        vallocator_free(NULL, big, 2 * VALLOCATOR_MAP_THRESHOLD);
+        assert(vallocator_grows_zeroed(NULL, VALLOCATOR_MAP_THRESHOLD));
+        assert(!vallocator_grows_zeroed(&counting, VALLOCATOR_MAP_THRESHOLD));
+    }
+
+    // NULL behaves like malloc
+    val = 0;
+    assert(vallocator_calloc(NULL, SIZE_MAX, 2) == NULL);
+    assert(vallocator_calloc(&counting, SIZE_MAX, 2) == NULL);
+    vallocator_free(NULL, NULL, 0);
+    return 0;
+}
+
+int vstats_test(void) {
+    Vstats before, after, stats;
+    Varray *array;
+    Vht *table;
+    Vpool *pool;
+    long val;
+    void *elems[100];
+
+    // compiled out unless built with DERT_STATS
+    if(vstats_global(&before) == ENOTSUP) {
+        array = varray_create(sizeof(long), NULL);
+        assert(array != NULL);
+        assert(varray_stats(array, &stats) == ENOTSUP);
+        assert(stats.reserved == 0);
+        varray_destroy(array);
+        return 0;
+    }
+
+    array = varray_create(sizeof(long), NULL);
+    assert(array != NULL);
+    for(size_t i = 0; i < 1000; i++) {
+        assert(varray_resize(array, i + 1) == 0);
+    }
+    assert(varray_stats(array, &stats) == 0);
+    assert(stats.live == 1000 * sizeof(long));
+    assert(stats.reserved >= stats.live);
+    assert(stats.reserved_peak >= stats.reserved);
+    assert(stats.grows > 0);
+    assert(stats.allocs == 1);
+    assert(varray_resize(array, 10) == 0);
+    assert(varray_stats(array, &stats) == 0);
+    assert(stats.live == 10 * sizeof(long));
+    assert(stats.live_peak == 1000 * sizeof(long));
+
+    table = vht_create(sizeof(long), sizeof(long), NULL);
+    assert(table != NULL);
+    for(long i = 0; i < 1000; i++) {
+        assert(vht_set(table, &i, &i) == 0);
+    }
+    val = 5;
+    assert(vht_del(table, &val) == 0);
+    assert(vht_stats(table, &stats) == 0);
+    assert(stats.live == 999 * 2 * sizeof(long));
+    assert(stats.grows > 0);
+    assert(stats.reserved >= vht_cap(table) * 2 * sizeof(long));
+
+    pool = vpool_create(1, sizeof(long), VPOOL_KIND_DYNAMIC);
+    assert(pool != NULL);
+    for(size_t i = 0; i < 100; i++) {
+        elems[i] = vpool_alloc(pool);
+        assert(elems[i] != NULL);
+    }
+    assert(vpool_dealloc(pool, elems[0]) == 0);
+    assert(vpool_stats(pool, &stats) == 0);
+    assert(stats.live == 99 * sizeof(long));
+    assert(stats.grows > 0);
+    assert(stats.reserved >= 100 * sizeof(long));
+
+    assert(vstats_global(&after) == 0);
+    assert(after.reserved > before.reserved);
+    assert(after.allocs > before.allocs);
+
+    // everything is returned once the containers are gone
+    varray_destroy(array);
+    vht_destroy(table);
+    vpool_destroy(pool);
+    assert(vstats_global(&after) == 0);
+    assert(after.reserved == before.reserved);
+    assert(after.live == before.live);
+    return 0;
+}
+
 int vdll_test(void) {
     Vdll_functions functions = { .init = init_long, .deinit = deinit_long };
 #define TEST_VDLL_ARRAY_LEN (99)
-    Vdll *dll = vdll_create(sizeof(long), &functions);
-    assert(dll != NULL);
-    assert(vdll_grow(dll, TEST_VDLL_ARRAY_LEN) == 0);
+#define TEST_VDLL_MODEL_LEN (2000)
+    Vdll_kind kinds[2] = { VDLL_KIND_NODE, VDLL_KIND_UNROLLED };
+
+    for(size_t k = 0; k < 2; k++) {
+        Vdll *dll = vdll_create(sizeof(long), kinds[k], &functions, NULL);
+        assert(dll != NULL);
+        assert(vdll_grow(dll, TEST_VDLL_ARRAY_LEN) == 0);
+
+        long array[TEST_VDLL_ARRAY_LEN];
+        long tmp;
+        for(size_t i = 0; i < TEST_VDLL_ARRAY_LEN; i++) {
+            array[i] = rand();
+            assert(vdll_set(dll, i, &(array[i])) == 0);
+        }
+
+        for(size_t i = 0; i < TEST_VDLL_ARRAY_LEN * 10; i++) {
+            size_t pos = rand() % TEST_VDLL_ARRAY_LEN;
+            array[pos] = rand();
+            assert(vdll_set(dll, pos, &(array[pos])) == 0);
+        }
 
-    long array[TEST_VDLL_ARRAY_LEN];
-    long tmp;
-    for(size_t i = 0; i < TEST_VDLL_ARRAY_LEN; i++) {
-        array[i] = rand();
-        assert(vdll_set(dll, i, &(array[i])) == 0);
+        for(size_t i = 0; i < TEST_VDLL_ARRAY_LEN * 100; i++) {
+            size_t pos = rand() % TEST_VDLL_ARRAY_LEN;
+            assert(vdll_get(dll, pos, &tmp) == 0);
+            assert(tmp == array[pos]);
+        }
+
+        assert(vdll_len(dll) == TEST_VDLL_ARRAY_LEN);
+        assert(vdll_get(dll, TEST_VDLL_ARRAY_LEN, &tmp) != 0);
+        assert(vdll_shrink(dll, 1 + (TEST_VDLL_ARRAY_LEN / 2)) == 0);
+        assert(vdll_len(dll) == TEST_VDLL_ARRAY_LEN - 1 - (TEST_VDLL_ARRAY_LEN / 2));
+        for(size_t i = 0; i < vdll_len(dll); i++) {
+            assert(vdll_get(dll, i, &tmp) == 0);
+            assert(tmp == array[i]);
+        }
+        vdll_destroy(dll);
     }
 
-    for(size_t i = 0; i < TEST_VDLL_ARRAY_LEN * 10; i++) {
-        size_t pos = rand() % TEST_VDLL_ARRAY_LEN;
-        array[pos] = rand();
-        assert(vdll_set(dll, pos, &(array[pos])) == 0);
+    for(size_t k = 0; k < 2; k++) {
+        // indexed lists long enough that distant positions are reached through the index
+#define TEST_VDLL_INDEX_LEN (50000)
+        static long array[TEST_VDLL_INDEX_LEN];
+        long tmp;
+        Vdll *dll = vdll_create(sizeof(long), kinds[k], NULL, NULL);
+        assert(dll != NULL);
+        assert(vdll_index_enable(dll) == 0);
+        assert(vdll_grow(dll, TEST_VDLL_INDEX_LEN) == 0);
+        for(size_t i = 0; i < TEST_VDLL_INDEX_LEN; i++) {
+            array[i] = rand();
+            assert(vdll_set(dll, i, &(array[i])) == 0);
+        }
+        for(size_t i = 0; i < 10000; i++) {
+            size_t pos = rand() % TEST_VDLL_INDEX_LEN;
+            assert(vdll_get(dll, pos, &tmp) == 0);
+            assert(tmp == array[pos]);
+        }
+
+        // removing the middle half shifts everything after it
+        assert(vdll_delete(dll, TEST_VDLL_INDEX_LEN / 4, TEST_VDLL_INDEX_LEN / 2) == 0);
+        memmove(&(array[TEST_VDLL_INDEX_LEN / 4]), &(array[3 * (TEST_VDLL_INDEX_LEN / 4)]), (TEST_VDLL_INDEX_LEN / 4) * sizeof(long));
+        for(size_t i = 0; i < 10000; i++) {
+            size_t pos = rand() % (TEST_VDLL_INDEX_LEN / 2);
+            assert(vdll_get(dll, pos, &tmp) == 0);
+            assert(tmp == array[pos]);
+        }
+        assert(vdll_get(dll, TEST_VDLL_INDEX_LEN / 2, &tmp) != 0);
+
+        vdll_index_disable(dll);
+        for(size_t i = 0; i < TEST_VDLL_INDEX_LEN / 2; i += 97) {
+            assert(vdll_get(dll, i, &tmp) == 0);
+            assert(tmp == array[i]);
+        }
+        vdll_destroy(dll);
     }
 
-    for(size_t i = 0; i < TEST_VDLL_ARRAY_LEN * 100; i++) {
-        size_t pos = rand() % TEST_VDLL_ARRAY_LEN;
-        assert(vdll_get(dll, pos, &tmp) == 0);
-        assert(tmp == array[pos]);
+    {
+        // both kinds, with and without an index, must agree with a plain array under random inserts, deletes, and sets
+        static long model[TEST_VDLL_MODEL_LEN];
+        Vdll *dlls[4];
+        size_t len = 0, pos, num_elems;
+        long tmp;
+
+        for(size_t k = 0; k < 4; k++) {
+            dlls[k] = vdll_create(sizeof(long), kinds[k % 2], &functions, NULL);
+            assert(dlls[k] != NULL);
+        }
+        assert(vdll_index_enable(dlls[2]) == 0);
+        assert(vdll_index_enable(dlls[2]) == 0);
+        for(size_t k = 0; k < 4; k++) {
+            // an empty list has nothing at position 0
+            assert(vdll_get(dlls[k], 0, &tmp) == 2);
+            assert(vdll_get_direct(dlls[k], 0) == NULL);
+            assert(vdll_set(dlls[k], 0, &tmp) == 2);
+        }
+        for(size_t step = 0; step < 3000; step++) {
+            int op = rand() % 5;
+            if(op == 0 && len < TEST_VDLL_MODEL_LEN - 100) {
+                num_elems = 1 + rand() % 70;
+                pos = len == 0 ? 0 : (size_t) rand() % len;
+                for(size_t k = 0; k < 4; k++) {
+                    assert(vdll_insert(dlls[k], pos, num_elems) == 0);
+                }
+                // new elements go after pos
+                size_t at = len == 0 ? 0 : pos + 1;
+                memmove(&(model[at + num_elems]), &(model[at]), (len - at) * sizeof(long));
+                for(size_t i = 0; i < num_elems; i++) {
+                    model[at + i] = 1;
+                }
+                len += num_elems;
+            } else if(op == 1 && len < TEST_VDLL_MODEL_LEN - 100) {
+                num_elems = 1 + rand() % 40;
+                for(size_t k = 0; k < 4; k++) {
+                    assert(vdll_grow(dlls[k], num_elems) == 0);
+                }
+                for(size_t i = 0; i < num_elems; i++) {
+                    model[len + i] = 1;
+                }
+                len += num_elems;
+            } else if(op == 2 && len > 0) {
+                pos = rand() % len;
+                num_elems = 1 + rand() % (len - pos < 60 ? len - pos : 60);
+                for(size_t k = 0; k < 4; k++) {
+                    assert(vdll_delete(dlls[k], pos, num_elems) == 0);
+                }
+                memmove(&(model[pos]), &(model[pos + num_elems]), (len - pos - num_elems) * sizeof(long));
+                len -= num_elems;
+            } else if(op == 3 && len > 0) {
+                num_elems = 1 + rand() % (len < 30 ? len : 30);
+                for(size_t k = 0; k < 4; k++) {
+                    assert(vdll_shrink(dlls[k], num_elems) == 0);
+                }
+                len -= num_elems;
+            } else if(len > 0) {
+                pos = rand() % len;
+                model[pos] = rand();
+                for(size_t k = 0; k < 4; k++) {
+                    assert(vdll_set(dlls[k], pos, &(model[pos])) == 0);
+                }
+            }
+
+            if(step == 1000) {
+                // indexing a list that already holds elements
+                assert(vdll_index_enable(dlls[3]) == 0);
+            }
+            for(size_t k = 0; k < 4; k++) {
+                assert(vdll_len(dlls[k]) == len);
+                if(len > 0) {
+                    pos = rand() % len;
+                    assert(vdll_get(dlls[k], pos, &tmp) == 0);
+                    assert(tmp == model[pos]);
+                } else {
+                    assert(vdll_get(dlls[k], 0, &tmp) == 2);
+                }
+            }
+            if(step % 50 == 0) {
+                for(size_t i = 0; i < len; i++) {
+                    for(size_t k = 0; k < 4; k++) {
+                        assert(vdll_get(dlls[k], i, &tmp) == 0);
+                        assert(tmp == model[i]);
+                    }
+                }
+            }
+        }
+        for(size_t k = 0; k < 4; k++) {
+            vdll_destroy(dlls[k]);
+        }
     }
 
-    assert(vdll_len(dll) == TEST_VDLL_ARRAY_LEN);
-    assert(vdll_shrink(dll, 1 + (TEST_VDLL_ARRAY_LEN / 2)) == 0);
-    vdll_destroy(dll);
+    return 0;
+}
+
+int vilist_test(void) {
+#define TEST_VILIST_ITEMS (200)
+    struct test_vilist_item {
+        long id;
+        Vilist_link link;
+    };
+    static struct test_vilist_item items[TEST_VILIST_ITEMS];
+    // models[l] holds the ids of list l in order
+    static long models[2][TEST_VILIST_ITEMS];
+    size_t lens[2] = { 0, 0 };
+    Vilist lists[2];
+    Vilist_link *link;
+
+    for(size_t i = 0; i < TEST_VILIST_ITEMS; i++) {
+        items[i].id = i;
+        vilist_link_init(&(items[i].link));
+    }
+    for(size_t l = 0; l < 2; l++) {
+        assert(vilist_init(&(lists[l])) == 0);
+        assert(vilist_empty(&(lists[l])));
+        assert(vilist_first(&(lists[l])) == NULL);
+        assert(vilist_pop_back(&(lists[l])) == NULL);
+    }
+
+    // items 0 to 99 start on list 0
+    for(size_t i = 0; i < TEST_VILIST_ITEMS / 2; i++) {
+        assert(vilist_push_back(&(lists[0]), &(items[i].link)) == 0);
+        models[0][lens[0]++] = i;
+    }
+    assert(vilist_push_back(&(lists[1]), &(items[0].link)) == EEXIST);
+    assert(VILIST_ENTRY(vilist_first(&(lists[0])), struct test_vilist_item, link) == &(items[0]));
+    assert(VILIST_ENTRY(vilist_last(&(lists[0])), struct test_vilist_item, link) == &(items[99]));
+
+    for(size_t step = 0; step < 20000; step++) {
+        size_t from = rand() % 2, to = rand() % 2;
+        int op = rand() % 6;
+
+        if(op == 0) {
+            // link an unlinked item somewhere in list to
+            size_t id = rand() % TEST_VILIST_ITEMS;
+            if(vilist_linked(&(items[id].link))) {
+                continue;
+            }
+            size_t at = lens[to] == 0 ? 0 : rand() % (lens[to] + 1);
+            if(at == lens[to]) {
+                assert(vilist_push_back(&(lists[to]), &(items[id].link)) == 0);
+            } else {
+                assert(vilist_insert_before(&(items[models[to][at]].link), &(items[id].link)) == 0);
+            }
+            memmove(&(models[to][at + 1]), &(models[to][at]), (lens[to] - at) * sizeof(long));
+            models[to][at] = id;
+            lens[to]++;
+        } else if(op == 1 && lens[from] > 0) {
+            size_t at = rand() % lens[from];
+            assert(vilist_remove(&(items[models[from][at]].link)) == 0);
+            assert(!vilist_linked(&(items[models[from][at]].link)));
+            memmove(&(models[from][at]), &(models[from][at + 1]), (lens[from] - at - 1) * sizeof(long));
+            lens[from]--;
+        } else if(op == 2 && lens[from] > 0) {
+            // move a run to some place in list to, outside of the run
+            size_t first = rand() % lens[from];
+            size_t last = first + (rand() % (lens[from] - first));
+            size_t run = last - first + 1;
+            long moved[TEST_VILIST_ITEMS];
+            memcpy(moved, &(models[from][first]), run * sizeof(long));
+            memmove(&(models[from][first]), &(models[from][last + 1]), (lens[from] - last - 1) * sizeof(long));
+            lens[from] -= run;
+
+            // after is how many elements of list to (without the run) come before it
+            size_t after = rand() % (lens[to] + 1);
+            Vilist_link *pos = after == 0 ? &(lists[to].head) : &(items[models[to][after - 1]].link);
+            assert(vilist_splice(pos, &(items[moved[0]].link), &(items[moved[run - 1]].link)) == 0);
+            memmove(&(models[to][after + run]), &(models[to][after]), (lens[to] - after) * sizeof(long));
+            memcpy(&(models[to][after]), moved, run * sizeof(long));
+            lens[to] += run;
+        } else if(op == 3 && from != to) {
+            if(rand() % 2) {
+                assert(vilist_splice_front(&(lists[to]), &(lists[from])) == 0);
+                memmove(&(models[to][lens[from]]), models[to], lens[to] * sizeof(long));
+                memcpy(models[to], models[from], lens[from] * sizeof(long));
+            } else {
+                assert(vilist_splice_back(&(lists[to]), &(lists[from])) == 0);
+                memcpy(&(models[to][lens[to]]), models[from], lens[from] * sizeof(long));
+            }
+            lens[to] += lens[from];
+            lens[from] = 0;
+            assert(vilist_empty(&(lists[from])));
+        } else if(op == 4 && from != to && lens[from] > 0) {
+            size_t at = rand() % lens[from];
+            assert(vilist_split(&(lists[to]), &(lists[from]), &(items[models[from][at]].link)) == 0);
+            memcpy(&(models[to][lens[to]]), &(models[from][at]), (lens[from] - at) * sizeof(long));
+            lens[to] += lens[from] - at;
+            lens[from] = at;
+        } else if(op == 5 && lens[from] > 0) {
+            link = vilist_pop_front(&(lists[from]));
+            assert(VILIST_ENTRY(link, struct test_vilist_item, link)->id == models[from][0]);
+            memmove(models[from], &(models[from][1]), (lens[from] - 1) * sizeof(long));
+            lens[from]--;
+        }
+
+        // walk both directions
+        for(size_t l = 0; l < 2; l++) {
+            size_t i = 0;
+            for(link = vilist_first(&(lists[l])); link != NULL; link = vilist_next(&(lists[l]), link)) {
+                assert(VILIST_ENTRY(link, struct test_vilist_item, link)->id == models[l][i]);
+                i++;
+            }
+            assert(i == lens[l]);
+            assert(vilist_len(&(lists[l])) == lens[l]);
+            for(link = vilist_last(&(lists[l])); link != NULL; link = vilist_prev(&(lists[l]), link)) {
+                i--;
+                assert(VILIST_ENTRY(link, struct test_vilist_item, link)->id == models[l][i]);
+            }
+            assert(i == 0);
+        }
+    }
 
+    assert(vilist_splice_back(&(lists[0]), &(lists[0])) == EINVAL);
+    for(size_t l = 0; l < 2; l++) {
+        vilist_deinit(&(lists[l]));
+    }
+    for(size_t i = 0; i < TEST_VILIST_ITEMS; i++) {
+        assert(!vilist_linked(&(items[i].link)));
+    }
     return 0;
 }
 
@@ -361,7 +1328,7 @@ int tbuf_test(void) {
 }
 
 int varray_test(void) {
-    Varray *array = varray_create(sizeof(long));
+    Varray *array = varray_create(sizeof(long), NULL);
     assert(array != NULL);
     assert(varray_len(array) == 0);
     assert(varray_cap(array) == 0);
@@ -405,7 +1372,488 @@ int varray_test(void) {
     assert(b_test == b);
     assert(c_test == c);
 
-    varray_destroy(array);
+    varray_destroy(array);
+
+    // push, pop, and append grow geometrically
+    {
+#define VARRAY_TEST_PUSHES (100000)
+        long chunk[100];
+        size_t reallocs = 0, cap;
+
+        array = varray_create(sizeof(long), NULL);
+        assert(array != NULL);
+        assert(varray_pop(array, &a_test) != 0);
+        cap = varray_cap(array);
+        for(long i = 0; i < VARRAY_TEST_PUSHES; i++) {
+            assert(varray_push(array, &i) == 0);
+            if(varray_cap(array) != cap) {
+                cap = varray_cap(array);
+                reallocs++;
+            }
+        }
+        assert(varray_len(array) == VARRAY_TEST_PUSHES);
+        assert(reallocs < 20);
+        for(long i = VARRAY_TEST_PUSHES - 1; i >= VARRAY_TEST_PUSHES / 2; i--) {
+            assert(varray_pop(array, &a_test) == 0);
+            assert(a_test == i);
+        }
+        assert(varray_pop(array, NULL) == 0);
+        assert(varray_len(array) == VARRAY_TEST_PUSHES / 2 - 1);
+
+        for(long i = 0; i < 100; i++) {
+            chunk[i] = -i;
+        }
+        assert(varray_append_many(array, chunk, 100) == 0);
+        assert(varray_len(array) == VARRAY_TEST_PUSHES / 2 + 99);
+        assert(varray_get(array, VARRAY_TEST_PUSHES / 2 + 98, &a_test) == 0);
+        assert(a_test == -99);
+        assert(varray_get(array, 0, &a_test) == 0);
+        assert(a_test == 0);
+
+        assert(varray_shrink_to_fit(array) == 0);
+        assert(varray_cap(array) == varray_len(array));
+        assert(varray_reserve(array, VARRAY_TEST_PUSHES * 2) == 0);
+        assert(varray_cap(array) == VARRAY_TEST_PUSHES * 2);
+        assert(varray_len(array) == VARRAY_TEST_PUSHES / 2 + 99);
+        assert(varray_reserve(array, 1) == 0);
+        assert(varray_cap(array) == VARRAY_TEST_PUSHES * 2);
+        assert(varray_get(array, 0, &a_test) == 0);
+        assert(a_test == 0);
+
+        assert(varray_resize(array, 0) == 0);
+        assert(varray_shrink_to_fit(array) == 0);
+        assert(varray_cap(array) == 0);
+        assert(varray_push(array, &a) == 0);
+        assert(varray_get(array, 0, &a_test) == 0);
+        assert(a_test == a);
+
+        // growing past the mapping threshold keeps contents and new elements are still zeroed
+        assert(varray_resize(array, VARRAY_TEST_PUSHES * 4) == 0);
+        assert(varray_get(array, 0, &a_test) == 0);
+        assert(a_test == a);
+        for(size_t i = 1; i < VARRAY_TEST_PUSHES * 4; i += 4099) {
+            assert(varray_get(array, i, &a_test) == 0);
+            assert(a_test == 0);
+        }
+        assert(varray_set(array, VARRAY_TEST_PUSHES * 4 - 1, &b) == 0);
+        assert(varray_resize(array, 1) == 0);
+        assert(varray_shrink_to_fit(array) == 0);
+        assert(varray_resize(array, VARRAY_TEST_PUSHES * 4) == 0);
+        assert(varray_get(array, VARRAY_TEST_PUSHES * 4 - 1, &a_test) == 0);
+        assert(a_test == 0);
+        varray_destroy(array);
+    }
+
+    {
+        // inline elements are used until they overflow and again once shrunk
+        VARRAY_INLINE(small, int, 4);
+        int small_test;
+        assert(varray_init_inline(small, sizeof(int), 4, NULL) == 0);
+        void *inline_elems = small->elems;
+        assert(inline_elems == (void *) (small_memory + VARRAY_INLINE_OFFSET));
+        assert(varray_cap(small) == 4);
+        for(int i = 0; i < 4; i++) {
+            assert(varray_push(small, &i) == 0);
+        }
+        assert(small->elems == inline_elems);
+        for(int i = 4; i < 100; i++) {
+            assert(varray_push(small, &i) == 0);
+        }
+        assert(small->elems != inline_elems);
+        for(int i = 0; i < 100; i++) {
+            assert(varray_get(small, i, &small_test) == 0);
+            assert(small_test == i);
+        }
+        assert(varray_resize(small, 3) == 0);
+        assert(varray_shrink_to_fit(small) == 0);
+        assert(small->elems == inline_elems);
+        assert(varray_cap(small) == 4);
+        assert(varray_len(small) == 3);
+        for(int i = 0; i < 3; i++) {
+            assert(varray_get(small, i, &small_test) == 0);
+            assert(small_test == i);
+        }
+        assert(varray_realloc(small, 50) == 0);
+        assert(small->elems != inline_elems);
+        assert(varray_realloc(small, 2) == 0);
+        assert(small->elems == inline_elems);
+        assert(varray_len(small) == 2);
+        varray_deinit(small);
+
+        array = varray_create_inline(sizeof(int), 8, NULL);
+        assert(array != NULL);
+        assert(array->elems == (void *) (((char *) array) + VARRAY_INLINE_OFFSET));
+        for(int i = 0; i < 9; i++) {
+            assert(varray_push(array, &i) == 0);
+        }
+        assert(varray_get(array, 8, &small_test) == 0);
+        assert(small_test == 8);
+        varray_destroy(array);
+    }
+
+    return 0;
+}
+
+#define VARRAY_PARALLEL_TEST_ELEMS (100003)
+
+void varray_parallel_test_fill(void *first, size_t pos, size_t num_elems, void *ctx) {
+    uint64_t *elems = first;
+    (void)(ctx);
+
+    for(size_t i = 0; i < num_elems; i++) {
+        elems[i] = (pos + i) * 3;
+    }
+}
+
+void varray_parallel_test_half(void *dest_first, void *src_first, size_t pos, size_t num_elems, void *ctx) {
+    uint32_t *dest = dest_first;
+    uint64_t *src = src_first;
+    (void)(ctx);
+
+    assert(pos == 0 || ((uintptr_t) dest_first) % 64 == 0);
+
+    for(size_t i = 0; i < num_elems; i++) {
+        dest[i] = src[i] / 3;
+    }
+}
+
+void varray_parallel_test_sum(void *acc, void *first, size_t pos, size_t num_elems, void *ctx) {
+    uint64_t *elems = first;
+    (void)(pos);
+    (void)(ctx);
+
+    for(size_t i = 0; i < num_elems; i++) {
+        *((uint64_t *) acc) += elems[i];
+    }
+}
+
+void varray_parallel_test_add(void *acc, void *other, void *ctx) {
+    (void)(ctx);
+    *((uint64_t *) acc) += *((uint64_t *) other);
+}
+
+// records the position every chunk starts at, relies on chunks being combined in order
+void varray_parallel_test_first(void *acc, void *first, size_t pos, size_t num_elems, void *ctx) {
+    (void)(num_elems);
+    (void)(ctx);
+    assert(pos == 0 || ((uintptr_t) first) % 64 == 0);
+    *((size_t *) acc) = pos;
+}
+
+void varray_parallel_test_ordered(void *acc, void *other, void *ctx) {
+    size_t *prev = acc;
+    size_t next = *((size_t *) other);
+    (void)(ctx);
+
+    assert(*prev == SIZE_MAX || *prev < next);
+    *prev = next;
+}
+
+int varray_parallel_test(void) {
+    Tpoolrr *pools[3];
+    Varray *array, *halves;
+    uint64_t sum, expected = 0, zero = 0, elem;
+    uint32_t half;
+    size_t last, none = SIZE_MAX;
+
+    pools[0] = NULL;
+    pools[1] = tpoolrr_create(4, 8);
+    pools[2] = tpoolrr_create(3, 1);
+    assert(pools[1] != NULL && pools[2] != NULL);
+    for(size_t i = 0; i < VARRAY_PARALLEL_TEST_ELEMS; i++) {
+        expected += i * 3;
+    }
+
+    for(size_t p = 0; p < 3; p++) {
+        array = varray_create(sizeof(uint64_t), NULL);
+        halves = varray_create(sizeof(uint32_t), NULL);
+        assert(array != NULL && halves != NULL);
+
+        // nothing to do yet
+        sum = 1;
+        assert(varray_parallel_reduce(array, pools[p], 0, sizeof(uint64_t), &zero,
+                                      varray_parallel_test_sum, varray_parallel_test_add, NULL, &sum) == 0);
+        assert(sum == 0);
+
+        assert(varray_resize(array, VARRAY_PARALLEL_TEST_ELEMS) == 0);
+        assert(varray_parallel_for(array, pools[p], 0, varray_parallel_test_fill, NULL) == 0);
+        for(size_t i = 0; i < VARRAY_PARALLEL_TEST_ELEMS; i += 997) {
+            assert(varray_get(array, i, &elem) == 0);
+            assert(elem == i * 3);
+        }
+        assert(varray_get(array, VARRAY_PARALLEL_TEST_ELEMS - 1, &elem) == 0);
+        assert(elem == (VARRAY_PARALLEL_TEST_ELEMS - 1) * 3);
+
+        for(size_t grain = 0; grain < 5000; grain += 1001) {
+            sum = 0;
+            assert(varray_parallel_reduce(array, pools[p], grain, sizeof(uint64_t), &zero,
+                                          varray_parallel_test_sum, varray_parallel_test_add, NULL, &sum) == 0);
+            assert(sum == expected);
+        }
+
+        last = none;
+        assert(varray_parallel_reduce(array, pools[p], 1, sizeof(size_t), &none,
+                                      varray_parallel_test_first, varray_parallel_test_ordered, NULL, &last) == 0);
+        // 8 byte elements are chunked 8 at a time to keep chunks on separate cache lines
+        assert(last <= VARRAY_PARALLEL_TEST_ELEMS - 1 && last + 8 > VARRAY_PARALLEL_TEST_ELEMS - 1);
+        assert(((uintptr_t) varray_get_direct(array, last)) % 64 == 0);
+
+        assert(varray_parallel_map(halves, array, pools[p], 0, varray_parallel_test_half, NULL) == 0);
+        assert(varray_len(halves) == VARRAY_PARALLEL_TEST_ELEMS);
+        for(size_t i = 0; i < VARRAY_PARALLEL_TEST_ELEMS; i += 997) {
+            assert(varray_get(halves, i, &half) == 0);
+            assert(half == i);
+        }
+        assert(varray_parallel_map(array, array, pools[p], 0, varray_parallel_test_half, NULL) == EINVAL);
+
+        varray_destroy(halves);
+        varray_destroy(array);
+    }
+
+    tpoolrr_destroy(pools[1]);
+    tpoolrr_destroy(pools[2]);
+    return 0;
+}
+
+struct varray_sort_test_record {
+    uint32_t pos;
+    int32_t signed_key;
+    uint64_t unsigned_key;
+    char bytes_key[12];
+};
+
+int varray_sort_test_check(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind) {
+    struct varray_sort_test_record *prev, *next;
+    int cmp;
+
+    for(size_t i = 1; i < varray_len(array); i++) {
+        prev = varray_get_direct(array, i - 1);
+        next = varray_get_direct(array, i);
+        if(kind == VARRAY_SORT_KEY_SIGNED) {
+            cmp = (prev->signed_key > next->signed_key) - (prev->signed_key < next->signed_key);
+        } else if(kind == VARRAY_SORT_KEY_UNSIGNED) {
+            cmp = (prev->unsigned_key > next->unsigned_key) - (prev->unsigned_key < next->unsigned_key);
+        } else {
+            cmp = memcmp(((char *) prev) + key_offset, ((char *) next) + key_offset, key_width);
+        }
+        // stable, equal keys stay in the order they were added
+        assert(cmp < 0 || (cmp == 0 && prev->pos < next->pos));
+    }
+    return 0;
+}
+
+int varray_sort_test(void) {
+    const size_t lens[] = { 0, 1, 2, 7, 32, 33, 1000, 100000 };
+    const size_t bytes_offset = offsetof(struct varray_sort_test_record, bytes_key);
+    struct varray_sort_test_record record = { 0 };
+    Varray *array;
+
+    for(size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        array = varray_create(sizeof(struct varray_sort_test_record), NULL);
+        assert(array != NULL);
+        for(size_t i = 0; i < lens[l]; i++) {
+            record.pos = i;
+            // few distinct values so stability is exercised
+            record.signed_key = (rand() % 201) - 100;
+            record.unsigned_key = ((uint64_t) (rand() % 50)) << 40;
+            for(size_t j = 0; j < sizeof(record.bytes_key); j++) {
+                record.bytes_key[j] = (j < 9) ? 'a' : (char) (rand() % 4);
+            }
+            assert(varray_push(array, &record) == 0);
+        }
+
+        assert(varray_sort(array, offsetof(struct varray_sort_test_record, signed_key), sizeof(int32_t),
+                           VARRAY_SORT_KEY_SIGNED) == 0);
+        varray_sort_test_check(array, 0, 0, VARRAY_SORT_KEY_SIGNED);
+
+        // renumber so stability is checked against the previous order
+        for(size_t i = 0; i < lens[l]; i++) {
+            ((struct varray_sort_test_record *) varray_get_direct(array, i))->pos = i;
+        }
+        assert(varray_sort(array, offsetof(struct varray_sort_test_record, unsigned_key), sizeof(uint64_t),
+                           VARRAY_SORT_KEY_UNSIGNED) == 0);
+        varray_sort_test_check(array, 0, 0, VARRAY_SORT_KEY_UNSIGNED);
+
+        for(size_t i = 0; i < lens[l]; i++) {
+            ((struct varray_sort_test_record *) varray_get_direct(array, i))->pos = i;
+        }
+        assert(varray_sort(array, bytes_offset, sizeof(record.bytes_key), VARRAY_SORT_KEY_BYTES) == 0);
+        varray_sort_test_check(array, bytes_offset, sizeof(record.bytes_key), VARRAY_SORT_KEY_BYTES);
+
+        for(size_t i = 0; i < lens[l]; i++) {
+            ((struct varray_sort_test_record *) varray_get_direct(array, i))->pos = i;
+        }
+        assert(varray_sort(array, bytes_offset + 8, 3, VARRAY_SORT_KEY_BYTES) == 0);
+        varray_sort_test_check(array, bytes_offset + 8, 3, VARRAY_SORT_KEY_BYTES);
+
+        varray_destroy(array);
+    }
+
+    array = varray_create(sizeof(struct varray_sort_test_record), NULL);
+    assert(array != NULL);
+    assert(varray_sort(array, 0, 0, VARRAY_SORT_KEY_BYTES) == EINVAL);
+    assert(varray_sort(array, sizeof(record) - 2, 4, VARRAY_SORT_KEY_BYTES) == EINVAL);
+    assert(varray_sort(array, bytes_offset, sizeof(record.bytes_key), VARRAY_SORT_KEY_UNSIGNED) == EINVAL);
+    varray_destroy(array);
+
+    return 0;
+}
+
+struct vsoa_test_failing {
+    size_t allocs_left;
+    size_t live;
+};
+
+void *vsoa_test_failing_alloc(void *ctx, size_t num_bytes) {
+    struct vsoa_test_failing *failing = ctx;
+
+    if(failing->allocs_left == 0) {
+        return NULL;
+    }
+    failing->allocs_left--;
+    failing->live++;
+    return malloc(num_bytes);
+}
+
+void *vsoa_test_failing_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+    (void)(ctx);
+    (void)(old_bytes);
+
+    // never called with new_bytes of 0, realloc would free ptr and leave it dangling
+    assert(new_bytes != 0);
+    return realloc(ptr, new_bytes);
+}
+
+void vsoa_test_failing_free(void *ctx, void *ptr, size_t num_bytes) {
+    struct vsoa_test_failing *failing = ctx;
+
+    (void)(num_bytes);
+    if(ptr != NULL) {
+        failing->live--;
+    }
+    free(ptr);
+}
+
+int vsoa_test(void) {
+    size_t column_sizes[3] = { sizeof(double), sizeof(uint8_t), sizeof(uint32_t) };
+    double x, *xs;
+    uint8_t flag;
+    uint32_t id, *ids;
+    void *row[3] = { &x, &flag, &id };
+    void *partial[3] = { NULL, &flag, NULL };
+    Vsoa *soa;
+
+    assert(vsoa_create(0, column_sizes, NULL) == NULL);
+
+    // growing an empty Vsoa frees the columns it managed to allocate when a later column fails
+    {
+        struct vsoa_test_failing failing = { .allocs_left = 2, .live = 0 };
+        Vallocator failing_allocator = { .alloc = vsoa_test_failing_alloc, .realloc = vsoa_test_failing_realloc, .free = vsoa_test_failing_free, .ctx = &failing };
+
+        soa = vsoa_create(3, column_sizes, &failing_allocator);
+        assert(soa != NULL);
+        assert(vsoa_resize(soa, 10) == ENOMEM);
+        assert(vsoa_cap(soa) == 0);
+        assert(failing.live == 1);
+        failing.allocs_left = 3;
+        assert(vsoa_resize(soa, 10) == 0);
+        assert(vsoa_len(soa) == 10);
+        vsoa_destroy(soa);
+        assert(failing.live == 0);
+    }
+
+    soa = vsoa_create(3, column_sizes, NULL);
+    assert(soa != NULL);
+    assert(vsoa_len(soa) == 0);
+    assert(vsoa_num_columns(soa) == 3);
+    assert(vsoa_pop(soa, NULL) == EINVAL);
+
+    for(uint32_t i = 0; i < 1000; i++) {
+        x = i * 0.5;
+        flag = i % 2;
+        id = i * 7;
+        assert(vsoa_push(soa, row) == 0);
+    }
+    assert(vsoa_len(soa) == 1000);
+    assert(vsoa_cap(soa) >= 1000);
+
+    // column loops see every row
+    xs = VSOA_COLUMN(soa, 0, double);
+    ids = VSOA_COLUMN(soa, 2, uint32_t);
+    for(uint32_t i = 0; i < vsoa_len(soa); i++) {
+        assert(xs[i] == i * 0.5);
+        assert(ids[i] == i * 7);
+        xs[i] *= 2;
+    }
+    assert(vsoa_column(soa, 3) == NULL);
+
+    assert(vsoa_row_get(soa, 999, row) == 0);
+    assert(x == 999 && flag == 1 && id == 999 * 7);
+    flag = 9;
+    assert(vsoa_row_set(soa, 10, partial) == 0);
+    assert(vsoa_get(soa, 10, 1, &flag) == 0);
+    assert(flag == 9);
+    assert(vsoa_get(soa, 10, 0, &x) == 0);
+    assert(x == 10);
+    id = 5;
+    assert(vsoa_set(soa, 10, 2, &id) == 0);
+    assert(*((uint32_t *) vsoa_get_direct(soa, 10, 2)) == 5);
+    assert(vsoa_get_direct(soa, 1000, 0) == NULL);
+    assert(vsoa_get(soa, 0, 3, &x) == EINVAL);
+
+    // a missing field is zeroed
+    assert(vsoa_push(soa, partial) == 0);
+    assert(vsoa_get(soa, 1000, 0, &x) == 0);
+    assert(x == 0);
+    assert(vsoa_pop(soa, row) == 0);
+    assert(flag == 9 && id == 0);
+
+    // shrinking then growing gives zeroed rows
+    assert(vsoa_resize(soa, 5) == 0);
+    assert(vsoa_resize(soa, 10) == 0);
+    assert(vsoa_get(soa, 9, 2, &id) == 0);
+    assert(id == 0);
+    assert(vsoa_get(soa, 4, 2, &id) == 0);
+    assert(id == 28);
+    assert(vsoa_shrink_to_fit(soa) == 0);
+    assert(vsoa_cap(soa) == 10);
+
+    // rows below the old capacity are zeroed even when growing reallocates
+    assert(vsoa_resize(soa, 2) == 0);
+    assert(vsoa_resize(soa, 100) == 0);
+    assert(vsoa_get(soa, 3, 2, &id) == 0);
+    assert(id == 0);
+    assert(vsoa_get(soa, 1, 2, &id) == 0);
+    assert(id == 7);
+    assert(vsoa_resize(soa, 10) == 0);
+    assert(vsoa_shrink_to_fit(soa) == 0);
+    assert(vsoa_reserve(soa, 100) == 0);
+    assert(vsoa_cap(soa) == 100);
+    assert(vsoa_len(soa) == 10);
+    assert(vsoa_resize(soa, 0) == 0);
+    assert(vsoa_shrink_to_fit(soa) == 0);
+    assert(vsoa_column(soa, 0) == NULL);
+    vsoa_destroy(soa);
+
+    {
+        // arena backed
+        Varena *arena = varena_create(1 << 16, VARENA_KIND_CHAINED);
+        Vallocator allocator;
+        assert(arena != NULL);
+        assert(varena_claim(&arena, 1024) == 0);
+        assert(vallocator_varena(&allocator, &arena) == 0);
+        soa = vsoa_create(3, column_sizes, &allocator);
+        assert(soa != NULL);
+        for(uint32_t i = 0; i < 100; i++) {
+            id = i;
+            assert(vsoa_push(soa, row) == 0);
+        }
+        assert(vsoa_get(soa, 99, 2, &id) == 0);
+        assert(id == 99);
+        vsoa_destroy(soa);
+        assert(varena_disclaim(&arena) == 0);
+        varena_destroy(&arena);
+    }
 
     return 0;
 }
@@ -477,7 +1925,7 @@ int vstack_test(void) {
 }
 
 int vqueue_test_nooverwrite(void) {
-    Vqueue *queue = vqueue_create(sizeof(long), 3);
+    Vqueue *queue = vqueue_create(sizeof(long), 3, NULL);
     assert(queue != NULL);
     assert(vqueue_len(queue) == 0);
     assert(vqueue_cap(queue) == 3);
@@ -509,7 +1957,7 @@ int vqueue_test_nooverwrite(void) {
 }
 
 int vqueue_test_overwrite(void) {
-    Vqueue *queue = vqueue_create(sizeof(long), 3);
+    Vqueue *queue = vqueue_create(sizeof(long), 3, NULL);
     assert(queue != NULL);
     assert(vqueue_len(queue) == 0);
     assert(vqueue_cap(queue) == 3);
@@ -560,7 +2008,7 @@ int vqueue_test_overwrite(void) {
 }
 
 int vqueue_test_some_nooverwrite(void) {
-    Vqueue *queue = vqueue_create(sizeof(long), 3);
+    Vqueue *queue = vqueue_create(sizeof(long), 3, NULL);
     size_t num_enqueued = 0;
     size_t num_dequeued = 0;
     assert(queue != NULL);
@@ -595,7 +2043,7 @@ int vqueue_test_some_nooverwrite(void) {
 }
 
 int vqueue_test_some_overwrite(void) {
-    Vqueue *queue = vqueue_create(sizeof(long), 3);
+    Vqueue *queue = vqueue_create(sizeof(long), 3, NULL);
     size_t num_enqueued = 0;
     size_t num_dequeued = 0;
     assert(queue != NULL);
@@ -882,6 +2330,33 @@ int tpoolrr_test(void) {
         tpoolrr_destroy(pool);
     }
 
+    {
+        // jobs can be queued on a chosen thread
+        int srcs[TPOOLRR_TEST_FUNCTION1_THREADS], dests[TPOOLRR_TEST_FUNCTION1_THREADS];
+        struct tpoolrr_test_arg1 args[TPOOLRR_TEST_FUNCTION1_THREADS];
+        struct tpoolrr_job done_jobs[TPOOLRR_TEST_FUNCTION1_THREADS];
+        uint64_t first_tag = user_tag;
+
+        pool = tpoolrr_create(TPOOLRR_TEST_FUNCTION1_THREADS, TPOOLRR_TEST_FUNCTION1_JOBS);
+        assert(pool != NULL);
+        assert(tpoolrr_jobs_add_to(pool, TPOOLRR_TEST_FUNCTION1_THREADS, user_tag, tpoolrr_test_function1, (void *) &args[0], 0) == EINVAL);
+        for(size_t i = TPOOLRR_TEST_FUNCTION1_THREADS; i > 0; i--) {
+            srcs[i - 1] = (int) i;
+            dests[i - 1] = 0;
+            args[i - 1] = (struct tpoolrr_test_arg1) {&(srcs[i - 1]), &(dests[i - 1])};
+            assert(tpoolrr_jobs_add_to(pool, i - 1, user_tag++, tpoolrr_test_function1, (void *) &(args[i - 1]), 0) == 0);
+        }
+        assert(tpoolrr_join(pool) == 0);
+        assert(tpoolrr_completions_popall(pool, done_jobs, TPOOLRR_TEST_FUNCTION1_THREADS) == 0);
+        for(size_t i = 0; i < TPOOLRR_TEST_FUNCTION1_THREADS; i++) {
+            assert(srcs[i] == dests[i]);
+
+            // tags were handed out from the last thread down to the first
+            assert(done_jobs[i].thread_assigned_to == TPOOLRR_TEST_FUNCTION1_THREADS - 1 - (done_jobs[i].user_tag - first_tag));
+        }
+        tpoolrr_destroy(pool);
+    }
+
     {
         char src1[999] = "foo", src2[999] = "bar", src3[999] = "baz";
         char dest1[999], dest2[999], dest3[999];
@@ -1218,150 +2693,629 @@ int gtpoolrr_test(void) {
     return 0;
 }
 
-int vht_test(void) {
-    Vht *table = vht_create(sizeof(long), sizeof(char));
-    assert(table != NULL);
-    assert(vht_len(table) == 0);
+int vht_test(void) {
+    Vht *table = vht_create(sizeof(long), sizeof(char), NULL);
+    assert(table != NULL);
+    assert(vht_len(table) == 0);
+
+#define TEST_VHT_ARRAY_LEN (257)
+    long keys[TEST_VHT_ARRAY_LEN];
+    char vals[TEST_VHT_ARRAY_LEN];
+    char ptrs[TEST_VHT_ARRAY_LEN];
+    size_t i;
+    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
+        keys[i] = rand();
+        vals[i] = rand();
+    }
+    assert(vht_get_direct(table, &(keys[0])) == NULL);
+
+    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
+        assert(vht_set(table, &(keys[i]), &(vals[i])) == 0);
+    }
+    assert(vht_len(table) == TEST_VHT_ARRAY_LEN);
+
+    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
+        assert(vht_get(table, &(keys[i]), &(ptrs[i])) == 0);
+        assert(ptrs[i] == vals[i]);
+    }
+
+    int64_t vals_sum = 0;
+    long dest_key = 0;
+    char dest_val = 0;
+    Vht_iterator iterator;
+    int64_t vht_sum = 0;
+    int res;
+
+    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
+        vals_sum += vals[i];
+    }
+
+    assert(vht_iterate_start(table, &iterator) == 0);
+    while((res = vht_iterate_next(table, &iterator, &dest_key, &dest_val)) != ENODATA) {
+        assert(res == 0);
+
+        vht_sum += dest_val;
+    }
+    assert(vals_sum == vht_sum);
+
+    vht_destroy(table);
+    return 0;
+}
+
+int fqueue_test(void) {
+    Fqueue *in = fqueue_create(999, "tests/fqueue/fqueue_in.txt", "r");
+    Fqueue *out = fqueue_create(999, "tests/fqueue/fqueue_out.txt", "w");
+    assert(in != NULL);
+    assert(out != NULL);
+
+    // Enqueue / Dequeue test
+    char *dequeue_text = "testing dequeue\n";
+    size_t dequeue_text_len = strlen(dequeue_text);
+    char dequeue_text_check[999] = "";
+    assert(fqueue_enqueue(in, dequeue_text, dequeue_text_len) == 0);
+    assert(fqueue_dequeue(in, dequeue_text_check, fqueue_used(in)) == 0);
+    assert(!strcmp(dequeue_text, dequeue_text_check));
+    // now that all text content in the fqueue in has been consumed fold down
+    assert(fqueue_prev(in) == dequeue_text_len);
+    assert(fqueue_used(in) == 0);
+    assert(in->readCursor > 0);
+    assert(in->writeCursor > 0);
+    assert(fqueue_fold_down(in) == 0);
+    assert(in->readCursor == 0);
+    assert(in->writeCursor == 0);
+
+    // Exchange / Rewind_Read_Cursor test
+    char *exchange_text = "testing exchange\n";
+    size_t exchange_text_len = strlen(exchange_text);
+    char exchange_text_check[999] = "";
+    assert(fqueue_enqueue(in, exchange_text, exchange_text_len) == 0);
+    assert(fqueue_exchange(in, out, fqueue_used(in)) == 0);
+    assert(fqueue_dequeue(out, exchange_text_check, fqueue_used(out)) == 0);
+    assert(!strcmp(exchange_text, exchange_text_check));
+    assert(fqueue_rewind_read_cursor(in, exchange_text_len) == 0);
+    assert(fqueue_exchange(in, out, fqueue_used(in)) == 0);
+    assert(fqueue_dequeue(out, exchange_text_check, fqueue_used(out)) == 0);
+    assert(fqueue_fold_down(in) == 0);
+    assert(fqueue_fold_down(out) == 0);
+
+    // Rewind_Write_Cursor test
+    char *rewind_text = "123456";
+    size_t rewind_text_len = 6;
+    char *rewind_text_partial = "123";
+    char rewind_text_check[999] = "";
+    size_t rewind_text_partial_len = 3;
+    assert(fqueue_enqueue(in, rewind_text, rewind_text_len) == 0);
+    assert(fqueue_rewind_write_cursor(in, rewind_text_len - rewind_text_partial_len) == 0);
+    assert(fqueue_dequeue(in, rewind_text_check, rewind_text_partial_len) == 0);
+    assert(!strcmp(rewind_text_partial, rewind_text_check));
+    assert(fqueue_fold_down(in) == 0);
+
+    // Fenqueue / Fdequeue test
+    size_t fenqueue_text_len = 18;
+    assert(fqueue_fenqueue(in, fenqueue_text_len) == 0);
+    assert(fqueue_exchange(in, out, fenqueue_text_len) == 0);
+    assert(fqueue_fdequeue(out, fqueue_used(out)) == 0);
+
+    fqueue_destroy(in);
+    fqueue_destroy(out);
+    return 0;
+}
+
+struct fmutex_test_worker_arg {
+    Fmutex *mutex;
+    int counter;
+};
+
+void *fmutex_test_worker(void *varg) {
+    struct fmutex_test_worker_arg *arg;
+    assert(varg != NULL);
+
+    arg = (struct fmutex_test_worker_arg *) varg;
+    for(size_t i = 0; i < 1000; i++) {
+        assert(fmutex_lock(arg->mutex) == 0);
+        arg->counter += 1;
+        assert(fmutex_unlock(arg->mutex) == 0);
+    }
+
+    return NULL;
+}
+
+// Absolute CLOCK_MONOTONIC time ms milliseconds from now, as taken by the timed futex functions
+struct timespec test_deadline(long ms) {
+    struct timespec ret;
+
+    clock_gettime(CLOCK_MONOTONIC, &ret);
+    ret.tv_sec += ms / 1000;
+    ret.tv_nsec += (ms % 1000) * 1000000;
+    if(ret.tv_nsec >= 1000000000) {
+        ret.tv_sec += 1;
+        ret.tv_nsec -= 1000000000;
+    } else if(ret.tv_nsec < 0) {
+        ret.tv_sec -= 1;
+        ret.tv_nsec += 1000000000;
+    }
+    return ret;
+}
+
+// Milliseconds from now until deadline, negative once it has passed
+long test_until(struct timespec deadline) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((deadline.tv_sec - now.tv_sec) * 1000) + ((deadline.tv_nsec - now.tv_nsec) / 1000000);
+}
+
+// alternate between every way of taking the mutex
+void *fmutex_test_timed_worker(void *varg) {
+    struct fmutex_test_worker_arg *arg;
+    assert(varg != NULL);
+
+    arg = (struct fmutex_test_worker_arg *) varg;
+    for(size_t i = 0; i < 1000; i++) {
+        if(i % 3 == 0) {
+            struct timespec deadline = test_deadline(60 * 1000);
+            assert(fmutex_timedlock(arg->mutex, &deadline) == 0);
+        } else if(i % 3 == 1) {
+            while(fmutex_trylock(arg->mutex) == EBUSY) {
+                sched_yield();
+            }
+        } else {
+            assert(fmutex_lock(arg->mutex) == 0);
+        }
+        arg->counter += 1;
+        assert(fmutex_unlock(arg->mutex) == 0);
+    }
+
+    return NULL;
+}
+
+void *fmutex_test_hold_worker(void *varg) {
+    Fmutex *mutex = varg;
+
+    assert(fmutex_lock(mutex) == 0);
+    usleep(20 * 1000);
+    assert(fmutex_unlock(mutex) == 0);
+
+    return NULL;
+}
+
+int fmutex_test(void) {
+    void *retval;
+    struct fmutex_test_worker_arg arg;
+    pthread_t threads[200];
+
+    Fmutex *mutex = fmutex_create();
+    assert(mutex != NULL);
+
+    arg.mutex = mutex;
+    arg.counter = 0;
+    for(size_t i = 0; i < 200; i++) {
+        pthread_create(&threads[i], NULL, fmutex_test_worker, &arg);
+    }
+
+    for(size_t i = 0; i < 200; i++) {
+        pthread_join(threads[i], &retval);
+    }
+    assert(arg.counter == 200 * 1000);
+    assert(mutex->locked == FMUTEX_UNLOCKED);
+    assert(fmutex_unlock(mutex) == EPERM);
+
+    // trylock and timedlock
+    {
+        struct timespec deadline;
+
+        assert(fmutex_trylock(mutex) == 0);
+        assert(fmutex_trylock(mutex) == EBUSY);
+
+        deadline = test_deadline(20);
+        assert(fmutex_timedlock(mutex, &deadline) == ETIMEDOUT);
+        assert(test_until(deadline) <= 0);
+        deadline.tv_nsec = 1000000000;
+        assert(fmutex_timedlock(mutex, &deadline) == EINVAL);
+        assert(fmutex_unlock(mutex) == 0);
+
+        // an unlocked mutex is taken even once the deadline has passed
+        deadline = test_deadline(-10);
+        assert(fmutex_timedlock(mutex, &deadline) == 0);
+        assert(fmutex_unlock(mutex) == 0);
+
+        // a timedlock that waits is woken by unlock
+        pthread_create(&threads[0], NULL, fmutex_test_hold_worker, mutex);
+        while(atomic_load(&(mutex->locked)) == FMUTEX_UNLOCKED) {
+            sched_yield();
+        }
+        deadline = test_deadline(60 * 1000);
+        assert(fmutex_timedlock(mutex, &deadline) == 0);
+        assert(fmutex_unlock(mutex) == 0);
+        pthread_join(threads[0], &retval);
+    }
+
+    arg.counter = 0;
+    for(size_t i = 0; i < 16; i++) {
+        pthread_create(&threads[i], NULL, fmutex_test_timed_worker, &arg);
+    }
+    for(size_t i = 0; i < 16; i++) {
+        pthread_join(threads[i], &retval);
+    }
+    assert(arg.counter == 16 * 1000);
+    assert(fmutex_unlock(mutex) == EPERM);
+
+    fmutex_destroy(mutex);
+    return 0;
+}
+
+struct frwlock_test_worker_arg {
+    Frwlock *lock;
+    // writers keep both equal while holding the lock
+    long first;
+    long second;
+    _Atomic long writes;
+    _Atomic long writers_inside;
+};
+
+void *frwlock_test_worker(void *varg) {
+    struct frwlock_test_worker_arg *arg = varg;
+
+    for(size_t i = 0; i < 2000; i++) {
+        if(i % 10 == 0) {
+            assert(frwlock_write_lock(arg->lock) == 0);
+            assert(atomic_fetch_add(&(arg->writers_inside), 1) == 0);
+            arg->first++;
+            arg->second++;
+            atomic_fetch_add(&(arg->writes), 1);
+            atomic_fetch_sub(&(arg->writers_inside), 1);
+            assert(frwlock_write_unlock(arg->lock) == 0);
+        } else {
+            assert(frwlock_read_lock(arg->lock) == 0);
+            assert(atomic_load(&(arg->writers_inside)) == 0);
+            assert(arg->first == arg->second);
+            assert(frwlock_read_unlock(arg->lock) == 0);
+        }
+    }
+
+    return NULL;
+}
+
+int frwlock_test(void) {
+    Frwlock_kind kinds[2] = { FRWLOCK_KIND_PREFER_READER, FRWLOCK_KIND_PREFER_WRITER };
+    struct frwlock_test_worker_arg arg;
+    pthread_t threads[16];
+
+    for(size_t k = 0; k < 2; k++) {
+        arg.lock = frwlock_create(kinds[k]);
+        assert(arg.lock != NULL);
+        arg.first = 0;
+        arg.second = 0;
+        atomic_store(&(arg.writes), 0);
+        atomic_store(&(arg.writers_inside), 0);
+
+        // several readers at once
+        assert(frwlock_read_lock(arg.lock) == 0);
+        assert(frwlock_read_lock(arg.lock) == 0);
+        assert(frwlock_write_unlock(arg.lock) == EPERM);
+        assert(frwlock_read_unlock(arg.lock) == 0);
+        assert(frwlock_read_unlock(arg.lock) == 0);
+        assert(frwlock_read_unlock(arg.lock) == EPERM);
+
+        for(size_t i = 0; i < 16; i++) {
+            pthread_create(&(threads[i]), NULL, frwlock_test_worker, &arg);
+        }
+        for(size_t i = 0; i < 16; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        assert(arg.first == 16 * 200);
+        assert(arg.second == 16 * 200);
+        assert(atomic_load(&(arg.writes)) == 16 * 200);
+        assert(arg.lock->state == 0);
+        frwlock_destroy(arg.lock);
+    }
+
+    {
+        Frwlock *locks;
+        void *memory = malloc(frwlock_advisev(3, FRWLOCK_KIND_PREFER_WRITER));
+        assert(memory != NULL);
+        assert(frwlock_initv(3, &locks, memory, FRWLOCK_KIND_PREFER_WRITER) == 0);
+        for(size_t i = 0; i < 3; i++) {
+            assert(frwlock_write_lock(&(locks[i])) == 0);
+        }
+        for(size_t i = 0; i < 3; i++) {
+            assert(frwlock_write_unlock(&(locks[i])) == 0);
+            frwlock_deinit(&(locks[i]));
+        }
+        free(memory);
+    }
+
+    return 0;
+}
+
+struct fcond_test_arg {
+    Fmutex *mutex;
+    Fcond *cond;
+    // items produced but not yet consumed
+    long available;
+    long consumed;
+    bool go;
+    long released;
+};
+
+void *fcond_test_consumer(void *varg) {
+    struct fcond_test_arg *arg = varg;
+
+    for(size_t i = 0; i < 500; i++) {
+        assert(fmutex_lock(arg->mutex) == 0);
+        while(arg->available == 0) {
+            assert(fcond_wait(arg->cond, arg->mutex) == 0);
+        }
+        arg->available--;
+        arg->consumed++;
+        assert(fmutex_unlock(arg->mutex) == 0);
+    }
+
+    return NULL;
+}
+
+void *fcond_test_waiter(void *varg) {
+    struct fcond_test_arg *arg = varg;
+
+    assert(fmutex_lock(arg->mutex) == 0);
+    while(!arg->go) {
+        assert(fcond_wait(arg->cond, arg->mutex) == 0);
+    }
+    arg->released++;
+    assert(fmutex_unlock(arg->mutex) == 0);
+
+    return NULL;
+}
+
+int fcond_test(void) {
+    struct fcond_test_arg arg = { 0 };
+    pthread_t threads[8];
+
+    arg.mutex = fmutex_create();
+    arg.cond = fcond_create();
+    assert(arg.mutex != NULL && arg.cond != NULL);
+
+    // nobody waiting yet
+    assert(fcond_signal(arg.cond) == 0);
+    assert(fcond_broadcast(arg.cond) == 0);
+
+    // one item signalled at a time to 8 consumers
+    for(size_t i = 0; i < 8; i++) {
+        pthread_create(&(threads[i]), NULL, fcond_test_consumer, &arg);
+    }
+    for(size_t i = 0; i < 8 * 500; i++) {
+        assert(fmutex_lock(arg.mutex) == 0);
+        arg.available++;
+        assert(fcond_signal(arg.cond) == 0);
+        assert(fmutex_unlock(arg.mutex) == 0);
+    }
+    for(size_t i = 0; i < 8; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(arg.consumed == 8 * 500);
+    assert(arg.available == 0);
+
+    // broadcast moves waiters onto the mutex, every one of them must still get through
+    for(size_t round = 0; round < 20; round++) {
+        arg.go = false;
+        arg.released = 0;
+        for(size_t i = 0; i < 8; i++) {
+            pthread_create(&(threads[i]), NULL, fcond_test_waiter, &arg);
+        }
+        usleep(1000);
+        assert(fmutex_lock(arg.mutex) == 0);
+        arg.go = true;
+        assert(fcond_broadcast(arg.cond) == 0);
+        assert(fmutex_unlock(arg.mutex) == 0);
+        for(size_t i = 0; i < 8; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        assert(arg.released == 8);
+    }
+
+    fcond_destroy(arg.cond);
+    fmutex_destroy(arg.mutex);
+    return 0;
+}
+
+struct fevent_test_arg {
+    Fevent *event;
+    _Atomic long released;
+};
+
+void *fevent_test_waiter(void *varg) {
+    struct fevent_test_arg *arg = varg;
+
+    assert(fevent_wait(arg->event) == 0);
+    atomic_fetch_add(&(arg->released), 1);
+
+    return NULL;
+}
+
+int fevent_test(void) {
+    struct fevent_test_arg arg;
+    pthread_t threads[8];
+
+    // manual reset releases everyone and stays set
+    arg.event = fevent_create(FEVENT_KIND_MANUAL_RESET, false);
+    assert(arg.event != NULL);
+    atomic_store(&(arg.released), 0);
+    for(size_t i = 0; i < 8; i++) {
+        pthread_create(&(threads[i]), NULL, fevent_test_waiter, &arg);
+    }
+    usleep(1000);
+    assert(atomic_load(&(arg.released)) == 0);
+    assert(fevent_set(arg.event) == 0);
+    for(size_t i = 0; i < 8; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(atomic_load(&(arg.released)) == 8);
+    assert(fevent_is_set(arg.event));
+    assert(fevent_wait(arg.event) == 0);
+    assert(fevent_reset(arg.event) == 0);
+    assert(!fevent_is_set(arg.event));
+    fevent_destroy(arg.event);
+
+    // auto reset releases one waiter per set
+    arg.event = fevent_create(FEVENT_KIND_AUTO_RESET, true);
+    assert(arg.event != NULL);
+    assert(fevent_wait(arg.event) == 0);
+    assert(!fevent_is_set(arg.event));
+    atomic_store(&(arg.released), 0);
+    for(size_t i = 0; i < 8; i++) {
+        pthread_create(&(threads[i]), NULL, fevent_test_waiter, &arg);
+    }
+    for(long i = 0; i < 8; i++) {
+        assert(fevent_set(arg.event) == 0);
+        while(atomic_load(&(arg.released)) != i + 1) {
+            usleep(100);
+        }
+        usleep(100);
+        assert(atomic_load(&(arg.released)) == i + 1);
+    }
+    for(size_t i = 0; i < 8; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(!fevent_is_set(arg.event));
+    fevent_destroy(arg.event);
+
+    return 0;
+}
+
+#define FBARRIER_TEST_THREADS (8)
+#define FBARRIER_TEST_ROUNDS (200)
+struct fbarrier_test_arg {
+    Fbarrier *barrier;
+    _Atomic long arrivals[FBARRIER_TEST_ROUNDS];
+    _Atomic long serial;
+};
 
-#define TEST_VHT_ARRAY_LEN (257)
-    long keys[TEST_VHT_ARRAY_LEN];
-    char vals[TEST_VHT_ARRAY_LEN];
-    char ptrs[TEST_VHT_ARRAY_LEN];
-    size_t i;
-    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
-        keys[i] = rand();
-        vals[i] = rand();
-    }
-    assert(vht_get_direct(table, &(keys[0])) == NULL);
+void *fbarrier_test_worker(void *varg) {
+    struct fbarrier_test_arg *arg = varg;
+    int res;
 
-    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
-        assert(vht_set(table, &(keys[i]), &(vals[i])) == 0);
+    for(size_t round = 0; round < FBARRIER_TEST_ROUNDS; round++) {
+        atomic_fetch_add(&(arg->arrivals[round]), 1);
+        res = fbarrier_wait(arg->barrier);
+        assert(res == 0 || res == FBARRIER_SERIAL_THREAD);
+        if(res == FBARRIER_SERIAL_THREAD) {
+            atomic_fetch_add(&(arg->serial), 1);
+        }
+        // nobody gets past a round before everyone arrived
+        assert(atomic_load(&(arg->arrivals[round])) == FBARRIER_TEST_THREADS);
     }
-    assert(vht_len(table) == TEST_VHT_ARRAY_LEN);
 
-    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
-        assert(vht_get(table, &(keys[i]), &(ptrs[i])) == 0);
-        assert(ptrs[i] == vals[i]);
-    }
+    return NULL;
+}
 
-    int64_t vals_sum = 0;
-    long dest_key = 0;
-    char dest_val = 0;
-    Vht_iterator iterator;
-    int64_t vht_sum = 0;
-    int res;
+int fbarrier_test(void) {
+    static struct fbarrier_test_arg arg;
+    pthread_t threads[FBARRIER_TEST_THREADS];
 
-    for(i = 0; i < TEST_VHT_ARRAY_LEN; i++) {
-        vals_sum += vals[i];
+    assert(fbarrier_create(0) == NULL);
+    arg.barrier = fbarrier_create(FBARRIER_TEST_THREADS);
+    assert(arg.barrier != NULL);
+    for(size_t round = 0; round < FBARRIER_TEST_ROUNDS; round++) {
+        atomic_store(&(arg.arrivals[round]), 0);
     }
+    atomic_store(&(arg.serial), 0);
 
-    assert(vht_iterate_start(table, &iterator) == 0);
-    while((res = vht_iterate_next(table, &iterator, &dest_key, &dest_val)) != ENODATA) {
-        assert(res == 0);
-
-        vht_sum += dest_val;
+    for(size_t i = 0; i < FBARRIER_TEST_THREADS; i++) {
+        pthread_create(&(threads[i]), NULL, fbarrier_test_worker, &arg);
     }
-    assert(vals_sum == vht_sum);
+    for(size_t i = 0; i < FBARRIER_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(atomic_load(&(arg.serial)) == FBARRIER_TEST_ROUNDS);
 
-    vht_destroy(table);
+    fbarrier_destroy(arg.barrier);
     return 0;
 }
 
-int fqueue_test(void) {
-    Fqueue *in = fqueue_create(999, "tests/fqueue/fqueue_in.txt", "r");
-    Fqueue *out = fqueue_create(999, "tests/fqueue/fqueue_out.txt", "w");
-    assert(in != NULL);
-    assert(out != NULL);
-
-    // Enqueue / Dequeue test
-    char *dequeue_text = "testing dequeue\n";
-    size_t dequeue_text_len = strlen(dequeue_text);
-    char dequeue_text_check[999] = "";
-    assert(fqueue_enqueue(in, dequeue_text, dequeue_text_len) == 0);
-    assert(fqueue_dequeue(in, dequeue_text_check, fqueue_used(in)) == 0);
-    assert(!strcmp(dequeue_text, dequeue_text_check));
-    // now that all text content in the fqueue in has been consumed fold down
-    assert(fqueue_prev(in) == dequeue_text_len);
-    assert(fqueue_used(in) == 0);
-    assert(in->readCursor > 0);
-    assert(in->writeCursor > 0);
-    assert(fqueue_fold_down(in) == 0);
-    assert(in->readCursor == 0);
-    assert(in->writeCursor == 0);
+#define FMCS_TEST_THREADS (16)
+struct fmcs_test_arg {
+    Fmcs *lock;
+    long counter;
+    // order in which queued threads got the lock
+    size_t order[FMCS_TEST_THREADS];
+    size_t granted;
+};
 
-    // Exchange / Rewind_Read_Cursor test
-    char *exchange_text = "testing exchange\n";
-    size_t exchange_text_len = strlen(exchange_text);
-    char exchange_text_check[999] = "";
-    assert(fqueue_enqueue(in, exchange_text, exchange_text_len) == 0);
-    assert(fqueue_exchange(in, out, fqueue_used(in)) == 0);
-    assert(fqueue_dequeue(out, exchange_text_check, fqueue_used(out)) == 0);
-    assert(!strcmp(exchange_text, exchange_text_check));
-    assert(fqueue_rewind_read_cursor(in, exchange_text_len) == 0);
-    assert(fqueue_exchange(in, out, fqueue_used(in)) == 0);
-    assert(fqueue_dequeue(out, exchange_text_check, fqueue_used(out)) == 0);
-    assert(fqueue_fold_down(in) == 0);
-    assert(fqueue_fold_down(out) == 0);
+struct fmcs_test_worker_arg {
+    struct fmcs_test_arg *shared;
+    size_t id;
+    Fmcs_node *node;
+};
 
-    // Rewind_Write_Cursor test
-    char *rewind_text = "123456";
-    size_t rewind_text_len = 6;
-    char *rewind_text_partial = "123";
-    char rewind_text_check[999] = "";
-    size_t rewind_text_partial_len = 3;
-    assert(fqueue_enqueue(in, rewind_text, rewind_text_len) == 0);
-    assert(fqueue_rewind_write_cursor(in, rewind_text_len - rewind_text_partial_len) == 0);
-    assert(fqueue_dequeue(in, rewind_text_check, rewind_text_partial_len) == 0);
-    assert(!strcmp(rewind_text_partial, rewind_text_check));
-    assert(fqueue_fold_down(in) == 0);
+void *fmcs_test_worker(void *varg) {
+    struct fmcs_test_arg *arg = varg;
+    Fmcs_node node;
 
-    // Fenqueue / Fdequeue test
-    size_t fenqueue_text_len = 18;
-    assert(fqueue_fenqueue(in, fenqueue_text_len) == 0);
-    assert(fqueue_exchange(in, out, fenqueue_text_len) == 0);
-    assert(fqueue_fdequeue(out, fqueue_used(out)) == 0);
+    for(size_t i = 0; i < 2000; i++) {
+        assert(fmcs_lock(arg->lock, &node) == 0);
+        arg->counter++;
+        assert(fmcs_unlock(arg->lock, &node) == 0);
+    }
 
-    fqueue_destroy(in);
-    fqueue_destroy(out);
-    return 0;
+    return NULL;
 }
 
-struct fmutex_test_worker_arg {
-    Fmutex *mutex;
-    int counter;
-};
-
-void *fmutex_test_worker(void *varg) {
-    struct fmutex_test_worker_arg *arg;
-    assert(varg != NULL);
+void *fmcs_test_queued(void *varg) {
+    struct fmcs_test_worker_arg *arg = varg;
 
-    arg = (struct fmutex_test_worker_arg *) varg;
-    assert(fmutex_lock(arg->mutex) == 0);
-    arg->counter += 1;
-    assert(fmutex_unlock(arg->mutex) == 0);
+    assert(fmcs_lock(arg->shared->lock, arg->node) == 0);
+    arg->shared->order[arg->shared->granted++] = arg->id;
+    assert(fmcs_unlock(arg->shared->lock, arg->node) == 0);
 
     return NULL;
 }
 
-int fmutex_test(void) {
-    void *retval;
-    struct fmutex_test_worker_arg arg;
-    pthread_t threads[200];
+int fmcs_test(void) {
+    static struct fmcs_test_arg arg;
+    static Fmcs_node nodes[FMCS_TEST_THREADS];
+    struct fmcs_test_worker_arg worker_args[FMCS_TEST_THREADS];
+    pthread_t threads[FMCS_TEST_THREADS];
+    Fmcs_node node, other;
 
-    Fmutex *mutex = fmutex_create();
-    assert(mutex != NULL);
+    arg.lock = fmcs_create();
+    assert(arg.lock != NULL);
+    assert(fmcs_unlock(arg.lock, &node) == EPERM);
+    assert(fmcs_trylock(arg.lock, &node) == 0);
+    assert(fmcs_trylock(arg.lock, &other) == EBUSY);
+    assert(fmcs_unlock(arg.lock, &node) == 0);
 
-    arg.mutex = mutex;
     arg.counter = 0;
-    for(size_t i = 0; i < 200; i++) {
-        pthread_create(&threads[i], NULL, fmutex_test_worker, &arg);
+    for(size_t i = 0; i < FMCS_TEST_THREADS; i++) {
+        pthread_create(&(threads[i]), NULL, fmcs_test_worker, &arg);
     }
-
-    for(size_t i = 0; i < 200; i++) {
-        pthread_join(threads[i], &retval);
+    for(size_t i = 0; i < FMCS_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(arg.counter == FMCS_TEST_THREADS * 2000);
+    assert(arg.lock->tail == NULL);
+
+    // threads get the lock in the order they queued for it
+    arg.granted = 0;
+    assert(fmcs_lock(arg.lock, &node) == 0);
+    for(size_t i = 0; i < FMCS_TEST_THREADS; i++) {
+        worker_args[i].shared = &arg;
+        worker_args[i].id = i;
+        worker_args[i].node = &(nodes[i]);
+        pthread_create(&(threads[i]), NULL, fmcs_test_queued, &(worker_args[i]));
+        while(arg.lock->tail != &(nodes[i])) {
+            usleep(100);
+        }
+    }
+    assert(fmcs_unlock(arg.lock, &node) == 0);
+    for(size_t i = 0; i < FMCS_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(arg.granted == FMCS_TEST_THREADS);
+    for(size_t i = 0; i < FMCS_TEST_THREADS; i++) {
+        assert(arg.order[i] == i);
     }
 
-    fmutex_destroy(mutex);
+    fmcs_destroy(arg.lock);
     return 0;
 }
 
@@ -1388,6 +3342,30 @@ void *fsemaphore_test_function(void *varg) {
     return NULL;
 }
 
+#define FSEMAPHORE_BATCH (3)
+void *fsemaphore_test_batch_function(void *varg) {
+    struct fsemaphore_test_function_arg *arg;
+    assert(varg != NULL);
+    arg = varg;
+
+    assert(fsemaphore_wait_n(arg->sem, FSEMAPHORE_BATCH) == 0);
+    __atomic_fetch_add(&(arg->array[arg->index]), arg->index, __ATOMIC_ACQ_REL);
+
+    return NULL;
+}
+
+void *fsemaphore_test_timed_function(void *varg) {
+    struct fsemaphore_test_function_arg *arg;
+    struct timespec deadline = test_deadline(60 * 1000);
+    assert(varg != NULL);
+    arg = varg;
+
+    assert(fsemaphore_timedwait(arg->sem, &deadline) == 0);
+    assert(test_until(deadline) > 0);
+
+    return NULL;
+}
+
 int fsemaphore_test(void) {
     void *retval;
     pthread_t threads[3 * FSEMAPHORE_SEM_MAX];
@@ -1439,6 +3417,11 @@ int fsemaphore_test(void) {
             do {
                 clock_gettime(CLOCK_REALTIME, &timeout);
                 timeout.tv_nsec += 5 * (1 << 20);
+                // an out of range tv_nsec makes pthread_timedjoin_np spin instead of failing
+                if(timeout.tv_nsec >= 1000000000) {
+                    timeout.tv_sec += 1;
+                    timeout.tv_nsec -= 1000000000;
+                }
                 fsemaphore_reset(sem);
             } while(pthread_timedjoin_np(threads[i], &retval, &timeout) != 0);
         }
@@ -1450,6 +3433,102 @@ int fsemaphore_test(void) {
         fsemaphore_destroy(sem);
     }
 
+    // counted posts and waits
+    {
+        Fsemaphore *sem = fsemaphore_create(0, FSEMAPHORE_SEM_MAX);
+        assert(sem != NULL);
+
+        assert(fsemaphore_post_n(sem, FSEMAPHORE_SEM_MAX) == 0);
+        assert(fsemaphore_post(sem) == EDEADLK);
+        assert(fsemaphore_wait_n(sem, 3) == 0);
+        assert(fsemaphore_post_n(sem, 4) == EDEADLK);
+        assert(atomic_load(&(sem->counter)) == FSEMAPHORE_SEM_MAX - 3);
+        assert(fsemaphore_post_n(sem, 3) == 0);
+        assert(fsemaphore_wait_n(sem, FSEMAPHORE_SEM_MAX) == 0);
+        assert(fsemaphore_wait_n(sem, 0) == EINVAL);
+        assert(fsemaphore_wait_n(sem, FSEMAPHORE_SEM_MAX + 1) == EINVAL);
+
+        fsemaphore_destroy(sem);
+    }
+
+    // trywait and timedwait
+    {
+        Fsemaphore *sem = fsemaphore_create(2, FSEMAPHORE_SEM_MAX);
+        struct timespec deadline;
+        assert(sem != NULL);
+
+        assert(fsemaphore_trywait_n(sem, 3) == EAGAIN);
+        assert(fsemaphore_trywait(sem) == 0);
+        assert(fsemaphore_trywait(sem) == 0);
+        assert(fsemaphore_trywait(sem) == EAGAIN);
+
+        deadline = test_deadline(20);
+        assert(fsemaphore_timedwait(sem, &deadline) == ETIMEDOUT);
+        assert(test_until(deadline) <= 0);
+        assert(atomic_load(&(sem->waiters)) == 0);
+        deadline = test_deadline(20);
+        assert(fsemaphore_timedwait_n(sem, 2, &deadline) == ETIMEDOUT);
+        assert(atomic_load(&(sem->batch_waiters)) == 0);
+        deadline.tv_nsec = -1;
+        assert(fsemaphore_timedwait(sem, &deadline) == EINVAL);
+
+        // available permits are taken even once the deadline has passed
+        assert(fsemaphore_post_n(sem, 2) == 0);
+        deadline = test_deadline(-10);
+        assert(fsemaphore_timedwait_n(sem, 2, &deadline) == 0);
+
+        // a timedwait that sleeps is woken by post
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX; i++) {
+            args[i].sem = sem;
+            args[i].array = array;
+            args[i].index = i;
+            pthread_create(&(threads[i]), NULL, fsemaphore_test_timed_function, &(args[i]));
+        }
+        usleep(10 * 1000);
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX; i++) {
+            assert(fsemaphore_post(sem) == 0);
+        }
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX; i++) {
+            pthread_join(threads[i], &retval);
+        }
+        assert(atomic_load(&(sem->counter)) == 0);
+        assert(atomic_load(&(sem->waiters)) == 0);
+
+        fsemaphore_destroy(sem);
+    }
+
+    // waiters after several permits are woken once enough are posted one at a time
+    {
+        Fsemaphore *sem = fsemaphore_create(0, FSEMAPHORE_SEM_MAX);
+        assert(sem != NULL);
+
+        memset(array, 0, 3 * FSEMAPHORE_SEM_MAX * sizeof(int));
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX; i++) {
+            args[i].sem = sem;
+            args[i].array = array;
+            args[i].index = i;
+            pthread_create(&(threads[i]), NULL, fsemaphore_test_batch_function, &(args[i]));
+        }
+
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX * FSEMAPHORE_BATCH; i++) {
+            while(fsemaphore_post(sem) == EDEADLK) {
+                usleep(10);
+            }
+        }
+
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX; i++) {
+            pthread_join(threads[i], &retval);
+        }
+
+        for(int i = 0; i < FSEMAPHORE_SEM_MAX; i++) {
+            assert(array[i] == i);
+        }
+        assert(atomic_load(&(sem->counter)) == 0);
+        assert(atomic_load(&(sem->waiters)) == 0);
+
+        fsemaphore_destroy(sem);
+    }
+
     return 0;
 }
 
@@ -1484,7 +3563,7 @@ int tree_T_test(void) {
 
 #define TREE_T_TEST_MAX_NODE (99)
     {
-        tree = tree_create(TREE_T_TEST_MAX_NODE);
+        tree = tree_create(TREE_T_TEST_MAX_NODE, NULL);
         tree_backup = malloc(tree_advise(TREE_T_TEST_MAX_NODE));
         assert(tree_backup != NULL);
 
@@ -1605,7 +3684,7 @@ int tree_T_test(void) {
     {
 #define TREE_T_TEST_VALUES_LEN (60)
         const uint8_t values[TREE_T_TEST_VALUES_LEN] = { 42, 80, 42, 43, 10, 82, 95, 67, 37, 74, 88, 50, 14, 73, 98, 79, 7, 59, 37, 28, 5, 75, 94, 56, 4, 31, 1, 31, 91, 5, 45, 71, 82, 55, 72, 87, 69, 82, 60, 2, 61, 88, 66, 50, 25, 25, 42, 27, 6, 26, 92, 54, 10, 79, 61, 66, 92, 8, 79, 17 };
-        tree = tree_create(TREE_T_TEST_MAX_NODE);
+        tree = tree_create(TREE_T_TEST_MAX_NODE, NULL);
         tree_backup = malloc(tree_advise(TREE_T_TEST_MAX_NODE));
         assert(tree_backup != NULL);
 
@@ -1698,6 +3777,215 @@ int tree_T_test(void) {
     return 0;
 }
 
+void *fstats_test_worker(void *varg) {
+    Fmutex *mutex = varg;
+
+    for(size_t i = 0; i < 1000; i++) {
+        assert(fmutex_lock(mutex) == 0);
+        assert(fmutex_unlock(mutex) == 0);
+    }
+
+    return NULL;
+}
+
+void *fstats_test_wait_worker(void *varg) {
+    assert(fsemaphore_wait(varg) == 0);
+
+    return NULL;
+}
+
+int fstats_test(void) {
+    Fmutex *mutex;
+    Fsemaphore *sem;
+    Fstats stats;
+    pthread_t threads[8];
+    struct timespec deadline;
+    uint64_t holds;
+
+    mutex = fmutex_create();
+    assert(mutex != NULL);
+    sem = fsemaphore_create(2, 2);
+    assert(sem != NULL);
+    assert(((uintptr_t) mutex) % _Alignof(Fmutex) == 0);
+    assert(((uintptr_t) sem) % _Alignof(Fsemaphore) == 0);
+
+    // compiled out unless built with DERT_STATS
+    if(fmutex_stats(mutex, &stats) == ENOTSUP) {
+        assert(stats.acquisitions == 0);
+        assert(fsemaphore_stats(sem, &stats) == ENOTSUP);
+        fmutex_destroy(mutex);
+        fsemaphore_destroy(sem);
+        return 0;
+    }
+
+    for(size_t i = 0; i < 8; i++) {
+        pthread_create(&threads[i], NULL, fstats_test_worker, mutex);
+    }
+    for(size_t i = 0; i < 8; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(fmutex_stats(mutex, &stats) == 0);
+    assert(stats.acquisitions == 8 * 1000);
+    assert(stats.contended <= stats.acquisitions);
+    assert(stats.wait_max_ns <= stats.wait_ns);
+    holds = 0;
+    for(size_t i = 0; i < FSTATS_HISTOGRAM_BUCKETS; i++) {
+        holds += stats.hold_histogram[i];
+    }
+    assert(holds == 8 * 1000);
+
+    // a timed out wait sleeps without acquiring, and a long hold lands in a high bucket
+    fmutex_stats_reset(mutex);
+    assert(fmutex_lock(mutex) == 0);
+    deadline = test_deadline(20);
+    assert(fmutex_timedlock(mutex, &deadline) == ETIMEDOUT);
+    assert(fmutex_trylock(mutex) == EBUSY);
+    assert(fmutex_unlock(mutex) == 0);
+    assert(fmutex_stats(mutex, &stats) == 0);
+    assert(stats.acquisitions == 1);
+    assert(stats.contended == 0);
+    assert(stats.futex_waits >= 1);
+    holds = 0;
+    // 2^24 nanoseconds is under 17 milliseconds
+    for(size_t i = 25; i < FSTATS_HISTOGRAM_BUCKETS; i++) {
+        holds += stats.hold_histogram[i];
+    }
+    assert(holds == 1);
+
+    assert(fsemaphore_trywait(sem) == 0);
+    assert(fsemaphore_wait(sem) == 0);
+    assert(fsemaphore_trywait(sem) == EAGAIN);
+    pthread_create(&threads[0], NULL, fstats_test_wait_worker, sem);
+    usleep(10 * 1000);
+    assert(fsemaphore_post(sem) == 0);
+    pthread_join(threads[0], NULL);
+    assert(fsemaphore_stats(sem, &stats) == 0);
+    assert(stats.acquisitions == 3);
+    assert(stats.contended == 1);
+    assert(stats.futex_waits >= 1);
+    assert(stats.wait_ns >= stats.wait_max_ns && stats.wait_max_ns > 0);
+    assert(stats.hold_histogram[0] == 0);
+    fsemaphore_stats_reset(sem);
+    assert(fsemaphore_stats(sem, &stats) == 0);
+    assert(stats.acquisitions == 0);
+
+    fmutex_destroy(mutex);
+    fsemaphore_destroy(sem);
+    return 0;
+}
+
+struct fseqlock_test_data {
+    // the writer keeps every field equal
+    uint64_t fields[4];
+};
+
+struct fseqlock_test_arg {
+    Fseqlock *lock;
+    struct fseqlock_test_data data;
+    _Atomic bool done;
+};
+
+void *fseqlock_test_writer(void *varg) {
+    struct fseqlock_test_arg *arg = varg;
+    struct fseqlock_test_data next;
+
+    for(uint64_t i = 1; i <= 20000; i++) {
+        for(size_t j = 0; j < 4; j++) {
+            next.fields[j] = i;
+        }
+        if(i % 2 == 0) {
+            assert(fseqlock_write(arg->lock, &(arg->data), &next, sizeof(next)) == 0);
+        } else {
+            // writing field by field, readers see either every field changed or none
+            assert(fseqlock_write_lock(arg->lock) == 0);
+            for(size_t j = 0; j < 4; j++) {
+                __atomic_store_n(&(arg->data.fields[j]), i, __ATOMIC_RELAXED);
+            }
+            assert(fseqlock_write_unlock(arg->lock) == 0);
+        }
+    }
+    atomic_store(&(arg->done), true);
+
+    return NULL;
+}
+
+void *fseqlock_test_reader(void *varg) {
+    struct fseqlock_test_arg *arg = varg;
+    struct fseqlock_test_data seen;
+    uint64_t last = 0, first;
+    uint32_t seq;
+    bool done = false;
+
+    while(!done) {
+        // check done before reading so the final write is always seen
+        done = atomic_load(&(arg->done));
+        assert(fseqlock_read(arg->lock, &seen, &(arg->data), sizeof(seen)) == 0);
+        for(size_t j = 0; j < 4; j++) {
+            assert(seen.fields[j] == seen.fields[0]);
+        }
+        assert(seen.fields[0] >= last);
+        last = seen.fields[0];
+
+        do {
+            seq = fseqlock_read_begin(arg->lock);
+            first = __atomic_load_n(&(arg->data.fields[0]), __ATOMIC_RELAXED);
+            seen.fields[3] = __atomic_load_n(&(arg->data.fields[3]), __ATOMIC_RELAXED);
+        } while(fseqlock_read_retry(arg->lock, seq));
+        assert(first == seen.fields[3]);
+        assert(first >= last);
+        last = first;
+    }
+    assert(last == 20000);
+
+    return NULL;
+}
+
+int fseqlock_test(void) {
+    static struct fseqlock_test_arg arg;
+    pthread_t threads[5];
+    uint32_t seq;
+
+    arg.lock = fseqlock_create();
+    assert(arg.lock != NULL);
+    assert(fseqlock_write_unlock(arg.lock) == EPERM);
+
+    seq = fseqlock_read_begin(arg.lock);
+    assert(!fseqlock_read_retry(arg.lock, seq));
+    assert(fseqlock_write_trylock(arg.lock) == 0);
+    assert(fseqlock_write_trylock(arg.lock) == EBUSY);
+    assert(fseqlock_write_unlock(arg.lock) == 0);
+    assert(fseqlock_read_retry(arg.lock, seq));
+    assert(fseqlock_write_unlock(arg.lock) == EPERM);
+
+    memset(&(arg.data), 0, sizeof(arg.data));
+    atomic_store(&(arg.done), false);
+    pthread_create(&threads[0], NULL, fseqlock_test_writer, &arg);
+    for(size_t i = 1; i < 5; i++) {
+        pthread_create(&threads[i], NULL, fseqlock_test_reader, &arg);
+    }
+    for(size_t i = 0; i < 5; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    fseqlock_destroy(arg.lock);
+
+    {
+        Fseqlock *locks;
+        void *memory = aligned_alloc(_Alignof(Fseqlock), fseqlock_advisev(3));
+        assert(memory != NULL);
+        assert(fseqlock_initv(3, &locks, memory) == 0);
+        for(size_t i = 0; i < 3; i++) {
+            assert(fseqlock_write_lock(&(locks[i])) == 0);
+        }
+        for(size_t i = 0; i < 3; i++) {
+            assert(fseqlock_write_unlock(&(locks[i])) == 0);
+            fseqlock_deinit(&(locks[i]));
+        }
+        free(memory);
+    }
+
+    return 0;
+}
+
 int main(void) {
     seed = time(NULL);
     printf("seed is %i\n", seed);
@@ -1706,9 +3994,17 @@ int main(void) {
     /*
     varena_test();
     vpool_test();
+    vmalloc_test();
+    vscratch_test();
+    vallocator_test();
+    vstats_test();
     vdll_test();
+    vilist_test();
     tbuf_test();
     varray_test();
+    varray_parallel_test();
+    varray_sort_test();
+    vsoa_test();
     vstack_test();
     vqueue_test_nooverwrite();
     vqueue_test_overwrite();
@@ -1721,7 +4017,14 @@ int main(void) {
     tpoolrr_test();
     gtpoolrr_test();
     fmutex_test();
+    frwlock_test();
+    fcond_test();
+    fevent_test();
+    fbarrier_test();
+    fmcs_test();
     fsemaphore_test();
+    fstats_test();
+    fseqlock_test();
     tree_T_test();
     fqueue_test();
     */
@@ -616,8 +616,7 @@ int tpoolrr_jobs_add(Tpoolrr *pool, uint64_t user_tag, void *(*function)(Tpoolrr
 }
 
 int _tpoolrr_jobs_add(Tpoolrr *pool, struct tpoolrr_job job) {
-    size_t i, index, len, cap;
-    bool locked_mutex_from_here = false;
+    size_t i, index;
     int res;
 
     if(pool == NULL || job.function == NULL || job.arg == NULL) {
@@ -626,43 +625,70 @@ int _tpoolrr_jobs_add(Tpoolrr *pool, struct tpoolrr_job job) {
 
     for(i = 0; i <= pool->threads_total; i++) {
         index = (i + pool->rr_index) % pool->threads_total;
-        len = aqueue_len(&(pool->job_submission_queues[index]));
-        cap = aqueue_cap(&(pool->job_submission_queues[index]));
-        if(len == cap) {
+        res = _tpoolrr_jobs_add_to(pool, index, job);
+        if(res == EBUSY) {
             // cannot push
             continue;
+        } else if(res != 0) {
+            return res;
         }
 
-        // thread may be waiting, send conditional signal
-        res = aqueue_enqueue(&(pool->job_submission_queues[index]), &job);
-        if(res != 0) {
-            goto _tpoolrr_jobs_add_error;
-        }
-        res = pthread_mutex_lock(&(pool->condition_mutexes[index]));
-        if (res != 0) {
-            goto _tpoolrr_jobs_add_error;
-        }
-        locked_mutex_from_here = true;
-        res = pthread_cond_signal(&(pool->conditions[index]));
-        if (res != 0) {
-            goto _tpoolrr_jobs_add_error;
-        }
-        res = pthread_mutex_unlock(&(pool->condition_mutexes[index]));
-        if (res != 0) {
-            goto _tpoolrr_jobs_add_error;
-        }
-        locked_mutex_from_here = false;
-
         pool->rr_index += 1;
         return 0;
     }
 
     // tried to push to all threads and failed
-    res = EBUSY;
+    return EBUSY;
+}
+
+int tpoolrr_jobs_add_to(Tpoolrr *pool, size_t index, uint64_t user_tag, void *(*function)(Tpoolrr*,void*), void *arg, uint64_t expiration) {
+    uint64_t expiration_as_monotonic_time;
+    if(pool == NULL || index >= pool->threads_total || function == NULL || arg == NULL) {
+        return EINVAL;
+    }
+
+    if(expiration == 0) {
+        expiration_as_monotonic_time = 0;
+    } else {
+        expiration_as_monotonic_time = monotonic_time_now() + expiration;
+    }
+
+    struct tpoolrr_job job = tpoolrr_job_construct(user_tag, function, arg, expiration_as_monotonic_time);
+    return _tpoolrr_jobs_add_to(pool, index, job);
+}
+
+int _tpoolrr_jobs_add_to(Tpoolrr *pool, size_t index, struct tpoolrr_job job) {
+    bool locked_mutex_from_here = false;
+    int res;
+
+    if(aqueue_len(&(pool->job_submission_queues[index])) == aqueue_cap(&(pool->job_submission_queues[index]))) {
+        return EBUSY;
+    }
+
+    // thread may be waiting, send conditional signal
+    res = aqueue_enqueue(&(pool->job_submission_queues[index]), &job);
+    if(res != 0) {
+        goto _tpoolrr_jobs_add_to_error;
+    }
+    res = pthread_mutex_lock(&(pool->condition_mutexes[index]));
+    if (res != 0) {
+        goto _tpoolrr_jobs_add_to_error;
+    }
+    locked_mutex_from_here = true;
+    res = pthread_cond_signal(&(pool->conditions[index]));
+    if (res != 0) {
+        goto _tpoolrr_jobs_add_to_error;
+    }
+    res = pthread_mutex_unlock(&(pool->condition_mutexes[index]));
+    if (res != 0) {
+        goto _tpoolrr_jobs_add_to_error;
+    }
+    locked_mutex_from_here = false;
+    return 0;
 
-_tpoolrr_jobs_add_error:
+_tpoolrr_jobs_add_to_error:
     if(locked_mutex_from_here) {
-        pthread_mutex_unlock(&(pool->condition_mutexes[i]));
+        pthread_mutex_unlock(&(pool->condition_mutexes[index]));
         locked_mutex_from_here = false;
     }
     return res;
@@ -1164,3 +1190,39 @@ size_t tpoolrr_submissions_cap(Tpoolrr *pool) {
 
     return pool->threads_total * pool->jobs_per_thread;
 }
+
+size_t tpoolrr_completions_queued(Tpoolrr *pool) {
+    size_t total = 0;
+
+    if(pool == NULL) {
+        return 0;
+    }
+
+    for(size_t i = 0; i < pool->threads_total; i++) {
+        total += aqueue_len(&(pool->job_completion_queues[i]));
+    }
+
+    return total;
+}
+
+size_t tpoolrr_completions_empty(Tpoolrr *pool) {
+    size_t total = 0;
+
+    if(pool == NULL) {
+        return 0;
+    }
+
+    for(size_t i = 0; i < pool->threads_total; i++) {
+        total += aqueue_cap(&(pool->job_completion_queues[i])) - aqueue_len(&(pool->job_completion_queues[i]));
+    }
+
+    return total;
+}
+
+size_t tpoolrr_completions_cap(Tpoolrr *pool) {
+    if(pool == NULL) {
+        return 0;
+    }
+
+    return pool->threads_total * pool->jobs_per_thread;
+}
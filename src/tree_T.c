@@ -7,6 +7,7 @@
 
 #include <tree_T.h>
 #include <tree_iterator.h>
+#include <vallocator.h>
 #include <pointerarith.h>
 
 #include <stdint.h>
@@ -18,22 +19,23 @@
 #include <assert.h>
 
 // Standard API
-Tree_tree *tree_create(size_t max_nodes) {
+Tree_tree *tree_create(size_t max_nodes, Vallocator *allocator) {
     Tree_tree *tree;
     if(max_nodes == 0) {
         return NULL;
     }
 
-    tree = malloc(tree_advise(max_nodes));
+    tree = vallocator_alloc(allocator, tree_advise(max_nodes));
     if(tree == NULL) {
         return NULL;
     }
 
     if(tree_init(&tree, tree, max_nodes) != 0) {
-        free(tree);
+        vallocator_free(allocator, tree, tree_advise(max_nodes));
         tree = NULL;
         return NULL;
     }
+    tree->allocator = allocator;
 
     return tree;
 }
@@ -79,12 +81,17 @@ void tree_deinit(Tree_tree *tree) {
 }
 
 void tree_destroy(Tree_tree *tree) {
+    Vallocator *allocator;
+    size_t max_nodes;
     if(tree == NULL) {
         return;
     }
 
+    // deinit clears everything needed to free tree
+    allocator = tree->allocator;
+    max_nodes = tree->max_nodes;
     tree_deinit(tree);
-    free(tree);
+    vallocator_free(allocator, tree, tree_advise(max_nodes));
 
     return;
 }
@@ -226,7 +233,7 @@ int tree_insert_many(struct tree_tree *tree, uint8_t *vals, size_t num_vals, siz
         }
         // should use alloca instead
         struct tree_insert_many_psuedonode node = { .position = num_vals / 2, .length = num_vals };
-        queue = vqueue_create(sizeof(struct tree_insert_many_psuedonode), num_vals);
+        queue = vqueue_create(sizeof(struct tree_insert_many_psuedonode), num_vals, tree->allocator);
         if(queue == NULL) {
             return ENOMEM;
         }
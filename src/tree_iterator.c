@@ -257,7 +257,7 @@ int tree_puts(
 #include <graphviz/gvc.h>
 
     // You likely will not need this much memory
-    Varena *nodes_arena = varena_create(DERT_TREE_PUTS_ARENA_CAP);
+    Varena *nodes_arena = varena_create(DERT_TREE_PUTS_ARENA_CAP, VARENA_KIND_STATIC);
     assert(nodes_arena != NULL);
 
     // In order to produce a graph that displays correctly always use BFS
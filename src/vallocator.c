@@ -0,0 +1,212 @@
+// needed for mremap
+#define _GNU_SOURCE 1
+
+#include <vallocator.h>
+#include <vallocator_priv.h>
+#include <varena.h>
+#include <varena_priv.h>
+#include <vpool.h>
+#include <pointerarith.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+void *vallocator_alloc(Vallocator *allocator, size_t num_bytes) {
+    if(allocator == NULL) {
+        if(num_bytes >= VALLOCATOR_MAP_THRESHOLD) {
+            return vallocator_map_alloc(num_bytes);
+        }
+        return malloc(num_bytes);
+    }
+
+    return allocator->alloc(allocator->ctx, num_bytes);
+}
+
+void *vallocator_calloc(Vallocator *allocator, size_t num_items, size_t elem_size) {
+    void *ret;
+
+    if(elem_size != 0 && num_items > SIZE_MAX / elem_size) {
+        return NULL;
+    }
+
+    if(allocator == NULL) {
+        // fresh mappings are already zeroed
+        if(num_items * elem_size >= VALLOCATOR_MAP_THRESHOLD) {
+            return vallocator_map_alloc(num_items * elem_size);
+        }
+        return calloc(num_items, elem_size);
+    }
+
+    ret = allocator->alloc(allocator->ctx, num_items * elem_size);
+    if(ret == NULL) {
+        return NULL;
+    }
+    memset(ret, 0, num_items * elem_size);
+    return ret;
+}
+
+void *vallocator_realloc(Vallocator *allocator, void *ptr, size_t old_bytes, size_t new_bytes) {
+    void *ret;
+
+    if(allocator == NULL) {
+        if(ptr == NULL) {
+            return vallocator_alloc(NULL, new_bytes);
+        } else if(old_bytes < VALLOCATOR_MAP_THRESHOLD && new_bytes < VALLOCATOR_MAP_THRESHOLD) {
+            return realloc(ptr, new_bytes);
+        } else if(old_bytes >= VALLOCATOR_MAP_THRESHOLD && new_bytes >= VALLOCATOR_MAP_THRESHOLD) {
+            return vallocator_map_realloc(ptr, old_bytes, new_bytes);
+        }
+
+        // crossing the threshold moves between malloc and a mapping
+        ret = vallocator_alloc(NULL, new_bytes);
+        if(ret == NULL) {
+            return NULL;
+        }
+        memcpy(ret, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+        vallocator_free(NULL, ptr, old_bytes);
+        return ret;
+    }
+
+    if(ptr == NULL) {
+        return allocator->alloc(allocator->ctx, new_bytes);
+    }
+    return allocator->realloc(allocator->ctx, ptr, old_bytes, new_bytes);
+}
+
+void vallocator_free(Vallocator *allocator, void *ptr, size_t num_bytes) {
+    if(ptr == NULL) {
+        return;
+    }
+
+    if(allocator == NULL) {
+        if(num_bytes >= VALLOCATOR_MAP_THRESHOLD) {
+            vallocator_map_free(ptr, num_bytes);
+            return;
+        }
+        free(ptr);
+        return;
+    }
+    allocator->free(allocator->ctx, ptr, num_bytes);
+}
+
+bool vallocator_grows_zeroed(Vallocator *allocator, size_t new_bytes) {
+    return allocator == NULL && new_bytes >= VALLOCATOR_MAP_THRESHOLD;
+}
+
+void *vallocator_map_alloc(size_t num_bytes) {
+    void *ret;
+
+    ret = mmap(NULL, num_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ret == MAP_FAILED) {
+        return NULL;
+    }
+    return ret;
+}
+
+void *vallocator_map_realloc(void *ptr, size_t old_bytes, size_t new_bytes) {
+    size_t page_size, kept;
+    void *ret;
+
+    ret = mremap(ptr, old_bytes, new_bytes, MREMAP_MAYMOVE);
+    if(ret == MAP_FAILED) {
+        return NULL;
+    }
+
+    // keep the rest of the last page zeroed so growing again never exposes old bytes
+    if(new_bytes < old_bytes) {
+        page_size = (size_t) sysconf(_SC_PAGESIZE);
+        kept = (new_bytes + page_size - 1) & ~(page_size - 1);
+        memset(pointer_literal_addition(ret, new_bytes), 0, kept - new_bytes);
+    }
+    return ret;
+}
+
+void vallocator_map_free(void *ptr, size_t num_bytes) {
+    munmap(ptr, num_bytes);
+}
+
+int vallocator_varena(Vallocator *dest, Varena **arena_ptr) {
+    if(dest == NULL || arena_ptr == NULL || *arena_ptr == NULL) {
+        return EINVAL;
+    }
+
+    dest->alloc = vallocator_varena_alloc;
+    dest->realloc = vallocator_varena_realloc;
+    dest->free = vallocator_varena_free;
+    dest->ctx = arena_ptr;
+    return 0;
+}
+
+void *vallocator_varena_alloc(void *ctx, size_t num_bytes) {
+    return varena_alloc_aligned(ctx, num_bytes, _Alignof(max_align_t));
+}
+
+void *vallocator_varena_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+    Varena *arena = *((Varena **) ctx);
+    void *ret;
+
+    // newest allocation of a frame can grow or shrink in place
+    if(arena->kind != VARENA_KIND_CONCURRENT && pointer_literal_addition(ptr, old_bytes) == pointer_literal_addition(arena->bytes, arena->top)) {
+        if(new_bytes <= old_bytes) {
+            arena->top -= old_bytes - new_bytes;
+            return ptr;
+        } else if(varena_bump(arena, new_bytes - old_bytes) == 0) {
+            return ptr;
+        }
+    }
+
+    ret = vallocator_varena_alloc(ctx, new_bytes);
+    if(ret == NULL) {
+        return NULL;
+    }
+    memcpy(ret, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+    return ret;
+}
+
+void vallocator_varena_free(void *ctx, void *ptr, size_t num_bytes) {
+    // released when the frame is disclaimed
+    (void)(ctx);
+    (void)(ptr);
+    (void)(num_bytes);
+}
+
+int vallocator_vpool(Vallocator *dest, Vpool *pool) {
+    if(dest == NULL || pool == NULL) {
+        return EINVAL;
+    }
+
+    dest->alloc = vallocator_vpool_alloc;
+    dest->realloc = vallocator_vpool_realloc;
+    dest->free = vallocator_vpool_free;
+    dest->ctx = pool;
+    return 0;
+}
+
+void *vallocator_vpool_alloc(void *ctx, size_t num_bytes) {
+    Vpool *pool = ctx;
+
+    if(num_bytes > pool->element_size) {
+        return NULL;
+    }
+    return vpool_alloc(pool);
+}
+
+void *vallocator_vpool_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+    Vpool *pool = ctx;
+
+    (void)(old_bytes);
+    if(new_bytes > pool->element_size) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void vallocator_vpool_free(void *ctx, void *ptr, size_t num_bytes) {
+    (void)(num_bytes);
+    vpool_dealloc(ctx, ptr);
+}
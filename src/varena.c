@@ -1,3 +1,6 @@
+// needed for MAP_ANONYMOUS and MAP_NORESERVE
+#define _DEFAULT_SOURCE (1)
+
 #include <varena.h>
 #include <varena_priv.h>
 #include <pointerarith.h>
@@ -5,12 +8,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Epochs are global so a chunk cached for a destroyed arena never matches a new arena at the same address
+static _Atomic uint64_t varena_epoch_counter = 0;
+
+// Chunks of the VARENA_KIND_CONCURRENT arenas the calling thread allocates from
+static __thread struct varena_local varena_locals[VARENA_LOCAL_SLOTS] = { 0 };
+
+// Slot given to the next arena the calling thread holds no chunk for
+static __thread size_t varena_locals_next = 0;
 
-Varena *varena_create(size_t num_bytes){
+Varena *varena_create(size_t num_bytes, Varena_kind kind){
     Varena *ret;
-    void *bytes;
+    struct varena_block *block;
+    void *reserved;
+    size_t page_size;
 
-    if(num_bytes == 0){
+    if(num_bytes == 0 || (kind != VARENA_KIND_STATIC && kind != VARENA_KIND_CHAINED && kind != VARENA_KIND_VIRTUAL && kind != VARENA_KIND_CONCURRENT)){
         return NULL;
     }
 
@@ -19,21 +39,51 @@ Varena *varena_create(size_t num_bytes){
         return NULL;
     }
 
-    bytes = calloc(num_bytes, sizeof(char));
-    if(bytes == NULL){
+    if(kind == VARENA_KIND_VIRTUAL){
+        // reserve address space only, pages become usable through varena_commit
+        page_size = varena_page_size();
+        if(num_bytes > SIZE_MAX - page_size){
+            free(ret);
+            return NULL;
+        }
+        num_bytes = (num_bytes + page_size - 1) & ~(page_size - 1);
+        reserved = mmap(NULL, num_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(reserved == MAP_FAILED){
+            free(ret);
+            return NULL;
+        }
+
+        ret->bytes = reserved;
+        ret->capacity = num_bytes;
+        ret->kind = kind;
+        ret->committed = 0;
+        ret->retain = VARENA_VIRTUAL_RETAIN_DEFAULT;
+        return ret;
+    }
+
+    block = varena_block_create(num_bytes, NULL);
+    if(block == NULL){
         free(ret);
         return NULL;
     }
 
-    ret->bytes = bytes;
+    ret->bytes = pointer_literal_addition(block, sizeof(struct varena_block));
     ret->top = 0;
     ret->bottom = 0;
     ret->capacity = num_bytes;
+    ret->kind = kind;
+    ret->chained = 0;
+    ret->spare = NULL;
+    ret->committed = num_bytes;
+    ret->retain = num_bytes;
+    atomic_init(&(ret->shared), 0);
+    ret->epoch = varena_epoch_next();
     return ret;
 }
 
 void varena_destroy(Varena **arena_ptr){
     Varena *arena;
+    struct varena_block *block, *prev;
     if(arena_ptr == NULL){
         return;
     }
@@ -43,18 +93,361 @@ void varena_destroy(Varena **arena_ptr){
         return;
     }
 
-    free(arena->bytes);
+    if(arena->kind == VARENA_KIND_VIRTUAL){
+        munmap(arena->bytes, arena->capacity);
+        memset(arena, 0, sizeof(Varena));
+        free(arena);
+        return;
+    }
+
+    for(block = varena_block_of(arena->bytes); block != NULL; block = prev){
+        prev = block->prev;
+        free(block);
+    }
+    free(arena->spare);
     memset(arena, 0, sizeof(Varena));
     free(arena);
     return;
 }
 
+struct varena_block *varena_block_create(size_t capacity, struct varena_block *prev){
+    struct varena_block *block;
+
+    if(capacity > SIZE_MAX - sizeof(struct varena_block)){
+        return NULL;
+    }
+
+    block = calloc(1, sizeof(struct varena_block) + capacity);
+    if(block == NULL){
+        return NULL;
+    }
+
+    block->prev = prev;
+    block->capacity = capacity;
+    return block;
+}
+
+struct varena_block *varena_block_of(void *bytes){
+    if(bytes == NULL){
+        return NULL;
+    }
+
+    return (struct varena_block *) (((char *) bytes) - sizeof(struct varena_block));
+}
+
+int varena_chain(Varena *arena, size_t num_bytes){
+    struct varena_block *current, *block;
+    size_t capacity;
+
+    if(arena == NULL || arena->kind != VARENA_KIND_CHAINED){
+        return EINVAL;
+    }
+
+    // geometric growth keeps the number of blocks logarithmic in the peak size
+    current = varena_block_of(arena->bytes);
+    capacity = current->capacity;
+    if(capacity <= SIZE_MAX / 2){
+        capacity *= 2;
+    }
+    if(capacity < num_bytes){
+        capacity = num_bytes;
+    }
+
+    if(arena->spare != NULL && arena->spare->capacity >= num_bytes){
+        block = arena->spare;
+        arena->spare = NULL;
+        block->prev = current;
+    } else {
+        block = varena_block_create(capacity, current);
+        if(block == NULL){
+            return ENOMEM;
+        }
+    }
+
+    arena->chained += current->capacity;
+    arena->bytes = pointer_literal_addition(block, sizeof(struct varena_block));
+    arena->capacity = block->capacity;
+    arena->top = 0;
+    arena->bottom = 0;
+    return 0;
+}
+
+void varena_unchain(Varena *arena, void *bytes){
+    struct varena_block *block, *prev;
+
+    if(arena == NULL || bytes == NULL){
+        return;
+    }
+
+    while(arena->bytes != bytes){
+        block = varena_block_of(arena->bytes);
+        prev = block->prev;
+        if(prev == NULL){
+            return;
+        }
+
+        // keep only the largest released block around
+        if(arena->spare == NULL || arena->spare->capacity < block->capacity){
+            free(arena->spare);
+            arena->spare = block;
+        } else {
+            free(block);
+        }
+
+        arena->chained -= prev->capacity;
+        arena->bytes = pointer_literal_addition(prev, sizeof(struct varena_block));
+        arena->capacity = prev->capacity;
+    }
+}
+
+int varena_frame_continue(Varena *arena, size_t num_bytes){
+    struct varena_frame frame = { 0 };
+
+    if(arena == NULL || arena->kind != VARENA_KIND_CHAINED || varena_frame_top(arena) == NULL){
+        return EINVAL;
+    }
+
+    if(num_bytes > SIZE_MAX - sizeof(struct varena_frame) - (VARENA_FRAME_ALIGNMENT - 1)){
+        return ENOMEM;
+    }
+    num_bytes += sizeof(struct varena_frame) + (VARENA_FRAME_ALIGNMENT - 1);
+
+    frame.top = arena->top;
+    frame.bottom = arena->bottom;
+    frame.bytes = arena->bytes;
+    frame.continued = true;
+
+    // newest block may still have room after the top frame
+    if(num_bytes <= arena->capacity - arena->bottom){
+        arena->top = arena->bottom;
+    } else if(varena_chain(arena, num_bytes) != 0){
+        return ENOMEM;
+    }
+
+    // continued frame gets room to keep growing but leaves the rest of the block to frames claimed later
+    // otherwise every nested claim would link a new block, each double the last
+    if(num_bytes <= (arena->capacity - arena->top) / 2){
+        arena->bottom = arena->top + 2 * num_bytes;
+    } else {
+        arena->bottom = arena->capacity;
+    }
+    arena->bottom = varena_frame_align(arena, arena->bottom);
+    memcpy(varena_frame_top(arena), &frame, sizeof(struct varena_frame));
+    return 0;
+}
+
+size_t varena_page_size(void){
+    static size_t page_size = 0;
+
+    if(page_size == 0){
+        page_size = (size_t) sysconf(_SC_PAGESIZE);
+    }
+    return page_size;
+}
+
+int varena_commit(Varena *arena, size_t num_bytes){
+    size_t page_size, end;
+
+    if(arena == NULL || arena->kind != VARENA_KIND_VIRTUAL || num_bytes > arena->capacity){
+        return EINVAL;
+    }
+
+    if(num_bytes <= arena->committed){
+        return 0;
+    }
+
+    // capacity is a multiple of the page size so this never passes the end of the reservation
+    page_size = varena_page_size();
+    end = (num_bytes + page_size - 1) & ~(page_size - 1);
+    if(mprotect(pointer_literal_addition(arena->bytes, arena->committed), end - arena->committed, PROT_READ | PROT_WRITE) != 0){
+        return errno;
+    }
+    arena->committed = end;
+    return 0;
+}
+
+int varena_commit_record(Varena *arena, size_t bottom){
+    size_t page_size, start, end;
+
+    if(arena == NULL || arena->kind != VARENA_KIND_VIRTUAL || bottom < sizeof(struct varena_frame) || bottom > arena->capacity){
+        return EINVAL;
+    }
+
+    page_size = varena_page_size();
+    start = (bottom - sizeof(struct varena_frame)) & ~(page_size - 1);
+    if(start <= arena->committed){
+        return varena_commit(arena, bottom);
+    }
+
+    // committed pages stay contiguous from the start, the record's pages are committed on their own
+    end = (bottom + page_size - 1) & ~(page_size - 1);
+    if(mprotect(pointer_literal_addition(arena->bytes, start), end - start, PROT_READ | PROT_WRITE) != 0){
+        return errno;
+    }
+    return 0;
+}
+
+int varena_bump(Varena *arena, size_t num_bytes){
+    size_t end;
+
+    if(arena == NULL || num_bytes > varena_frame_unused(arena)){
+        return EINVAL;
+    }
+
+    // commit a granule at a time, never past the frame
+    end = arena->top + num_bytes;
+    if(arena->kind == VARENA_KIND_VIRTUAL && end > arena->committed){
+        end = (end + VARENA_VIRTUAL_COMMIT_GRANULE - 1) & ~((size_t) VARENA_VIRTUAL_COMMIT_GRANULE - 1);
+        if(end > arena->bottom){
+            end = arena->bottom;
+        }
+        if(varena_commit(arena, end) != 0){
+            return ENOMEM;
+        }
+    }
+    arena->top += num_bytes;
+
+    return 0;
+}
+
+int varena_decommit(Varena *arena, size_t end){
+    size_t page_size, keep;
+
+    if(arena == NULL || arena->kind != VARENA_KIND_VIRTUAL){
+        return EINVAL;
+    }
+
+    page_size = varena_page_size();
+    keep = arena->bottom > arena->retain ? arena->bottom : arena->retain;
+    keep = (keep + page_size - 1) & ~(page_size - 1);
+    if(end < arena->committed){
+        end = arena->committed;
+    }
+    end = (end + page_size - 1) & ~(page_size - 1);
+    if(end > arena->capacity){
+        end = arena->capacity;
+    }
+    if(end <= keep){
+        return 0;
+    }
+
+    // pages stay accessible but are no longer resident, touching them again gives zeroed pages
+    if(madvise(pointer_literal_addition(arena->bytes, keep), end - keep, MADV_DONTNEED) != 0){
+        return errno;
+    }
+    if(arena->committed > keep){
+        arena->committed = keep;
+    }
+    return 0;
+}
+
+uint64_t varena_epoch_next(void){
+    return atomic_fetch_add_explicit(&varena_epoch_counter, 1, memory_order_relaxed) + 1;
+}
+
+int varena_concurrent_take(Varena *arena, size_t num_bytes, size_t *offset){
+    if(arena == NULL || offset == NULL){
+        return EINVAL;
+    }
+
+    // a take that does not fit still advances shared, so the arena stays full until varena_reset
+    *offset = atomic_fetch_add_explicit(&(arena->shared), num_bytes, memory_order_relaxed);
+    if(*offset > arena->capacity || num_bytes > arena->capacity - *offset){
+        return ENOMEM;
+    }
+    return 0;
+}
+
+struct varena_local *varena_local_of(Varena *arena){
+    struct varena_local *local;
+
+    for(size_t i = 0; i < VARENA_LOCAL_SLOTS; i++){
+        local = &(varena_locals[i]);
+        if(local->arena == arena && local->epoch == arena->epoch){
+            return local;
+        }
+    }
+
+    // chunks cached for other arenas, or from before varena_reset, are never matched again
+    // the rest of the chunk in the slot taken over is left unused
+    local = &(varena_locals[varena_locals_next]);
+    varena_locals_next = (varena_locals_next + 1) % VARENA_LOCAL_SLOTS;
+    local->arena = arena;
+    local->epoch = arena->epoch;
+    local->next = 0;
+    local->end = 0;
+    return local;
+}
+
+void *varena_concurrent_alloc(Varena *arena, size_t num_bytes, size_t alignment){
+    struct varena_local *local;
+    uintptr_t address;
+    size_t padding, offset, needed;
+
+    if(arena == NULL || num_bytes > arena->capacity || alignment - 1 > arena->capacity - num_bytes){
+        return NULL;
+    }
+    needed = num_bytes + (alignment - 1);
+    local = varena_local_of(arena);
+
+    // small allocations refill the thread's chunk, except near the end where a chunk would not fit
+    if(local->end - local->next < needed && needed <= VARENA_CONCURRENT_CHUNK_BYTES / 4 &&
+            arena->capacity >= VARENA_CONCURRENT_CHUNK_BYTES &&
+            atomic_load_explicit(&(arena->shared), memory_order_relaxed) <= arena->capacity - VARENA_CONCURRENT_CHUNK_BYTES &&
+            varena_concurrent_take(arena, VARENA_CONCURRENT_CHUNK_BYTES, &offset) == 0){
+        local->next = offset;
+        local->end = offset + VARENA_CONCURRENT_CHUNK_BYTES;
+    }
+
+    if(local->end - local->next >= needed){
+        address = (uintptr_t) pointer_literal_addition(arena->bytes, local->next);
+        padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+        offset = local->next + padding;
+        local->next = offset + num_bytes;
+        return pointer_literal_addition(arena->bytes, offset);
+    }
+
+    if(varena_concurrent_take(arena, needed, &offset) != 0){
+        return NULL;
+    }
+    address = (uintptr_t) pointer_literal_addition(arena->bytes, offset);
+    padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    return pointer_literal_addition(arena->bytes, offset + padding);
+}
+
+int varena_reset(Varena *arena){
+    if(arena == NULL || arena->kind != VARENA_KIND_CONCURRENT){
+        return EINVAL;
+    }
+
+    atomic_store_explicit(&(arena->shared), 0, memory_order_relaxed);
+    arena->epoch = varena_epoch_next();
+    return 0;
+}
+
+int varena_retain(Varena *arena, size_t num_bytes){
+    if(arena == NULL || arena->kind != VARENA_KIND_VIRTUAL){
+        return EINVAL;
+    }
+
+    arena->retain = num_bytes;
+    return 0;
+}
+
 size_t varena_arena_used(Varena *arena){
+    size_t shared;
+
     if(arena == NULL){
         return 0;
     }
 
-    return arena->bottom;
+    // includes the unused parts of chunks held by threads
+    if(arena->kind == VARENA_KIND_CONCURRENT){
+        shared = atomic_load_explicit(&(arena->shared), memory_order_relaxed);
+        return shared < arena->capacity ? shared : arena->capacity;
+    }
+
+    return arena->chained + arena->bottom;
 }
 
 size_t varena_arena_unused(Varena *arena){
@@ -62,6 +455,10 @@ size_t varena_arena_unused(Varena *arena){
         return 0;
     }
 
+    if(arena->kind == VARENA_KIND_CONCURRENT){
+        return arena->capacity - varena_arena_used(arena);
+    }
+
     return arena->capacity - arena->bottom;
 }
 
@@ -70,7 +467,7 @@ size_t varena_arena_cap(Varena *arena){
         return 0;
     }
 
-    return arena->capacity;
+    return arena->chained + arena->capacity;
 }
 
 size_t varena_frame_used(Varena *arena){
@@ -80,7 +477,11 @@ size_t varena_frame_used(Varena *arena){
     }
 
     frame = varena_frame_top(arena);
-    return arena->top - frame->bottom;
+    if(frame == NULL){
+        return 0;
+    }
+
+    return arena->top - varena_frame_start(arena, frame);
 }
 
 size_t varena_frame_unused(Varena *arena){
@@ -100,9 +501,30 @@ struct varena_frame *varena_frame_top(Varena *arena){
     return pointer_literal_addition(arena->bytes, arena->bottom - sizeof(struct varena_frame));
 }
 
+size_t varena_frame_align(Varena *arena, size_t bottom){
+    uintptr_t address;
+
+    // alignment is of the actual address, block and mapping starts are not assumed to be aligned
+    address = (uintptr_t) pointer_literal_addition(arena->bytes, bottom - sizeof(struct varena_frame));
+    return bottom - (address & (VARENA_FRAME_ALIGNMENT - 1));
+}
+
+size_t varena_frame_start(Varena *arena, struct varena_frame *frame){
+    if(arena == NULL || frame == NULL){
+        return 0;
+    }
+
+    // frames that caused a new block to be linked start at the beginning of that block
+    if(frame->bytes != arena->bytes){
+        return 0;
+    }
+    return frame->bottom;
+}
+
 int varena_claim(Varena **arena_ptr, size_t num_bytes){
     Varena *arena;
     struct varena_frame frame = { 0 };
+    size_t bottom;
 
     if(arena_ptr == NULL){
         return 1;
@@ -117,23 +539,46 @@ int varena_claim(Varena **arena_ptr, size_t num_bytes){
         return 3;
     }
 
-    // ensure space to store varena_frame in frame
-    num_bytes += sizeof(struct varena_frame);
-    if(arena->bottom + num_bytes > arena->capacity){
+    // concurrent arenas have no frames
+    if(arena->kind == VARENA_KIND_CONCURRENT){
+        return 4;
+    }
+
+    // ensure space to store varena_frame in frame, along with the padding needed to align it
+    if(num_bytes > SIZE_MAX - sizeof(struct varena_frame) - (VARENA_FRAME_ALIGNMENT - 1)){
         return 4;
     }
+    num_bytes += sizeof(struct varena_frame) + (VARENA_FRAME_ALIGNMENT - 1);
     frame.top = arena->top;
     frame.bottom = arena->bottom;
+    frame.bytes = arena->bytes;
+    frame.continued = false;
+    if(num_bytes > arena->capacity - arena->bottom){
+        if(arena->kind != VARENA_KIND_CHAINED){
+            return 4;
+        }
+
+        if(varena_chain(arena, num_bytes) != 0){
+            return 5;
+        }
+    }
+
+    // rest of a virtual frame is committed by the allocations that reach it
+    bottom = varena_frame_align(arena, arena->bottom + num_bytes);
+    if(arena->kind == VARENA_KIND_VIRTUAL && varena_commit_record(arena, bottom) != 0){
+        return 5;
+    }
 
     arena->top = arena->bottom;
-    arena->bottom += num_bytes;
+    arena->bottom = bottom;
     memcpy(varena_frame_top(arena), &frame, sizeof(struct varena_frame));
     return 0;
 }
 
 int varena_disclaim(Varena **arena_ptr){
     Varena *arena;
-    struct varena_frame *frame;
+    struct varena_frame *frame, popped;
+    size_t end;
 
     if(arena_ptr == NULL){
         return 1;
@@ -144,19 +589,46 @@ int varena_disclaim(Varena **arena_ptr){
         return 2;
     }
 
-    frame = varena_frame_top(arena);
-    if(frame == NULL){
-        return 3;
+    end = arena->bottom;
+    do {
+        frame = varena_frame_top(arena);
+        if(frame == NULL){
+            return 3;
+        }
+
+        // frame may live in a block that is about to be released
+        memcpy(&popped, frame, sizeof(struct varena_frame));
+        varena_unchain(arena, popped.bytes);
+        arena->top = popped.top;
+        arena->bottom = popped.bottom;
+    } while(popped.continued);
+
+    if(arena->kind == VARENA_KIND_VIRTUAL){
+        varena_decommit(arena, end);
     }
-
-    arena->top = frame->top;
-    arena->bottom = frame->bottom;
     return 0;
 }
 
 void *varena_alloc(Varena **arena_ptr, size_t num_bytes){
+    return varena_alloc_aligned(arena_ptr, num_bytes, 1);
+}
+
+size_t varena_align_padding(Varena *arena, size_t alignment){
+    uintptr_t address;
+
+    if(arena == NULL || alignment == 0){
+        return 0;
+    }
+
+    // alignment is of the actual address, block and mapping starts are not assumed to be aligned
+    address = (uintptr_t) pointer_literal_addition(arena->bytes, arena->top);
+    return (alignment - (address & (alignment - 1))) & (alignment - 1);
+}
+
+void *varena_alloc_aligned(Varena **arena_ptr, size_t num_bytes, size_t alignment){
     Varena *arena;
     void *ret;
+    size_t padding, unused;
 
     if(arena_ptr == NULL){
         return NULL;
@@ -167,11 +639,44 @@ void *varena_alloc(Varena **arena_ptr, size_t num_bytes){
         return NULL;
     }
 
-    if(arena->top + num_bytes > arena->bottom - sizeof(struct varena_frame)){
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0){
+        return NULL;
+    }
+
+    if(arena->kind == VARENA_KIND_CONCURRENT){
+        return varena_concurrent_alloc(arena, num_bytes, alignment);
+    }
+
+    if(varena_frame_top(arena) == NULL){
+        return NULL;
+    }
+
+    padding = varena_align_padding(arena, alignment);
+    unused = arena->bottom - sizeof(struct varena_frame) - arena->top;
+    if(padding > unused || num_bytes > unused - padding){
+        if(arena->kind != VARENA_KIND_CHAINED || num_bytes > SIZE_MAX - (alignment - 1)){
+            return NULL;
+        }
+
+        // reserve enough for the worst case padding in the new block
+        if(varena_frame_continue(arena, num_bytes + (alignment - 1)) != 0){
+            return NULL;
+        }
+        padding = varena_align_padding(arena, alignment);
+    }
+
+    ret = pointer_literal_addition(arena->bytes, arena->top + padding);
+    if(varena_bump(arena, padding + num_bytes) != 0){
         return NULL;
     }
-    ret = pointer_literal_addition(arena->bytes, arena->top);
-    arena->top += num_bytes;
 
     return ret;
 }
+
+void *varena_alloc_array(Varena **arena_ptr, size_t num_items, size_t elem_size, size_t alignment){
+    if(elem_size != 0 && num_items > SIZE_MAX / elem_size){
+        return NULL;
+    }
+
+    return varena_alloc_aligned(arena_ptr, num_items * elem_size, alignment);
+}
@@ -1,29 +1,32 @@
 #include <varray.h>
 #include <varray_priv.h>
+#include <vallocator.h>
+#include <vstats.h>
 #include <pointerarith.h>
 
+#include <errno.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
-Varray *varray_create(size_t elem_size) {
+Varray *varray_create(size_t elem_size, Vallocator *allocator) {
     if(elem_size == 0) {
         return NULL;
     }
 
-    Varray *ret = calloc(1, sizeof(Varray));
+    Varray *ret = vallocator_calloc(allocator, 1, sizeof(Varray));
     if(ret == NULL) {
         return NULL;
     }
 
-    if(varray_init(ret, elem_size) != 0) {
-        free(ret);
+    if(varray_init(ret, elem_size, allocator) != 0) {
+        vallocator_free(allocator, ret, sizeof(Varray));
         return NULL;
     }
     return ret;
 }
 
-int varray_init(Varray *array, size_t elem_size) {
+int varray_init(Varray *array, size_t elem_size, Vallocator *allocator) {
     if(array == NULL || elem_size == 0) {
         return 1;
     }
@@ -32,6 +35,55 @@ int varray_init(Varray *array, size_t elem_size) {
     array->elem_size = elem_size;
     array->stored = 0;
     array->cap = 0;
+    array->allocator = allocator;
+    array->inline_cap = 0;
+#ifdef DERT_STATS
+    memset(&(array->stats), 0, sizeof(Vstats));
+#endif
+    return 0;
+}
+
+size_t varray_advise_inline(size_t elem_size, size_t inline_cap) {
+    if(elem_size != 0 && inline_cap > (SIZE_MAX - VARRAY_INLINE_OFFSET) / elem_size) {
+        return 0;
+    }
+
+    return VARRAY_INLINE_OFFSET + (elem_size * inline_cap);
+}
+
+Varray *varray_create_inline(size_t elem_size, size_t inline_cap, Vallocator *allocator) {
+    size_t num_bytes = varray_advise_inline(elem_size, inline_cap);
+    if(elem_size == 0 || num_bytes == 0) {
+        return NULL;
+    }
+
+    Varray *ret = vallocator_alloc(allocator, num_bytes);
+    if(ret == NULL) {
+        return NULL;
+    }
+
+    if(varray_init_inline(ret, elem_size, inline_cap, allocator) != 0) {
+        vallocator_free(allocator, ret, num_bytes);
+        return NULL;
+    }
+    return ret;
+}
+
+int varray_init_inline(Varray *array, size_t elem_size, size_t inline_cap, Vallocator *allocator) {
+    if(varray_init(array, elem_size, allocator) != 0) {
+        return 1;
+    }
+    if(varray_advise_inline(elem_size, inline_cap) == 0) {
+        return 2;
+    }
+
+    array->inline_cap = inline_cap;
+    if(inline_cap != 0) {
+        array->elems = varray_inline_elems(array);
+        array->cap = inline_cap;
+        memset(array->elems, 0, inline_cap * elem_size);
+        VSTATS_RESERVE(&(array->stats), 0, inline_cap * elem_size);
+    }
     return 0;
 }
 
@@ -40,21 +92,27 @@ void varray_deinit(Varray *array) {
         return;
     }
 
-    if(array->elems != NULL) {
-        free(array->elems);
+    if(array->elems != NULL && array->elems != varray_inline_elems(array)) {
+        vallocator_free(array->allocator, array->elems, array->cap * array->elem_size);
     }
+    VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, 0);
+    VSTATS_RESERVE(&(array->stats), array->cap * array->elem_size, 0);
     memset(array, 0, sizeof(Varray));
 
     return;
 }
 
 void varray_destroy(Varray *array) {
+    Vallocator *allocator;
+    size_t num_bytes;
     if(array == NULL) {
         return;
     }
 
+    allocator = array->allocator;
+    num_bytes = array->inline_cap == 0 ? sizeof(Varray) : varray_advise_inline(array->elem_size, array->inline_cap);
     varray_deinit(array);
-    free(array);
+    vallocator_free(allocator, array, num_bytes);
 
     return;
 }
@@ -104,16 +162,27 @@ int varray_set(Varray *array, size_t pos, void *src) {
 }
 
 int varray_resize(Varray *array, size_t new_size) {
+    if(array == NULL) {
+        return 1;
+    }
+
     if(new_size == array->stored) {
         return 0;
     } else if(new_size > array->stored) {
         if(new_size > array->cap) {
-            return varray_realloc(array, new_size);
+            if(varray_cap_set(array, varray_cap_next(array, new_size)) != 0) {
+                return 2;
+            }
+            VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, new_size * array->elem_size);
+            array->stored = new_size;
+            return 0;
         } else {
+            VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, new_size * array->elem_size);
             array->stored = new_size;
             return 0;
         }
     } else {
+        VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, new_size * array->elem_size);
         array->stored = new_size;
         return 0;
     }
@@ -138,12 +207,15 @@ int varray_grow(Varray *array, size_t increase) {
         return 3;
     }
 
+    VSTATS_GROW_START(grow_start);
     if(array->elems == NULL) {
-        array->elems = calloc(increase, array->elem_size);
+        array->elems = vallocator_calloc(array->allocator, increase, array->elem_size);
         if(array->elems == NULL) {
             return 4;
         }
 
+        VSTATS_RESERVE(&(array->stats), 0, increase * array->elem_size);
+        VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, (array->stored + increase) * array->elem_size);
         array->stored += increase;
         array->cap += increase;
     } else {
@@ -152,16 +224,21 @@ int varray_grow(Varray *array, size_t increase) {
             new_cap <<= 1;
         }
 
-        void *new_elems = realloc(array->elems, new_cap * array->elem_size);
+        void *new_elems = varray_elems_resize(array, new_cap);
         if(new_elems == NULL) {
             return 5;
         }
         array->elems = new_elems;
-        memset(pointer_literal_addition(array->elems, array->cap * array->elem_size), 0, (new_cap - array->cap) * array->elem_size);
+        if(!vallocator_grows_zeroed(array->allocator, new_cap * array->elem_size)) {
+            memset(pointer_literal_addition(array->elems, array->cap * array->elem_size), 0, (new_cap - array->cap) * array->elem_size);
+        }
 
+        VSTATS_RESERVE(&(array->stats), array->cap * array->elem_size, new_cap * array->elem_size);
+        VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, (array->stored + increase) * array->elem_size);
         array->stored += increase;
         array->cap = new_cap;
     }
+    VSTATS_GROW_END(&(array->stats), grow_start);
 
     return 0;
 }
@@ -179,19 +256,209 @@ int varray_shrink(Varray *array, size_t decrease) {
         return 4;
     }
 
-    void *dest = realloc(array->elems, (array->cap - decrease) * array->elem_size);
-    if(dest == NULL) {
-        return 5;
+    // inline elements are never given back but elements past the requested capacity are still dropped
+    size_t new_stored = array->cap - decrease;
+    size_t new_cap = new_stored < array->inline_cap ? array->inline_cap : new_stored;
+    if(new_cap != array->cap) {
+        void *dest = varray_elems_resize(array, new_cap);
+        if(dest == NULL && new_cap != 0) {
+            return 5;
+        }
+        array->elems = dest;
+        VSTATS_RESERVE(&(array->stats), array->cap * array->elem_size, new_cap * array->elem_size);
+        array->cap = new_cap;
     }
-    array->elems = dest;
-    array->cap -= decrease;
-    if(array->cap < array->stored) {
-        array->stored = array->cap;
+    if(new_stored < array->stored) {
+        VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, new_stored * array->elem_size);
+        array->stored = new_stored;
     }
 
     return 0;
 }
 
+size_t varray_cap_next(Varray *array, size_t num_elems) {
+    size_t new_cap;
+    if(array == NULL) {
+        return num_elems;
+    }
+
+    new_cap = array->cap < VARRAY_MIN_CAP ? VARRAY_MIN_CAP : array->cap;
+    while(new_cap < num_elems) {
+        if(new_cap > SIZE_MAX / 2) {
+            return num_elems;
+        }
+        new_cap <<= 1;
+    }
+
+    return new_cap;
+}
+
+int varray_cap_set(Varray *array, size_t new_cap) {
+    void *new_elems;
+    size_t new_stored;
+    if(array == NULL) {
+        return 1;
+    }
+
+    // inline elements are never given back but elements past the requested capacity are still dropped
+    new_stored = new_cap < array->stored ? new_cap : array->stored;
+    if(new_cap < array->inline_cap) {
+        new_cap = array->inline_cap;
+    }
+
+    if(new_cap == array->cap) {
+        if(new_stored < array->stored) {
+            VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, new_stored * array->elem_size);
+            array->stored = new_stored;
+        }
+        return 0;
+    }
+
+    if(new_cap > SIZE_MAX / array->elem_size) {
+        return 2;
+    }
+
+    VSTATS_GROW_START(grow_start);
+    new_elems = varray_elems_resize(array, new_cap);
+    if(new_elems == NULL && new_cap != 0) {
+        return 3;
+    }
+    array->elems = new_elems;
+    VSTATS_RESERVE(&(array->stats), array->cap * array->elem_size, new_cap * array->elem_size);
+
+    if(new_cap > array->cap) {
+        // large buffers are mappings whose new pages are already zeroed, touching them would fault every page in
+        if(!vallocator_grows_zeroed(array->allocator, new_cap * array->elem_size)) {
+            memset(pointer_literal_addition(array->elems, array->cap * array->elem_size), 0, (new_cap - array->cap) * array->elem_size);
+        }
+        VSTATS_GROW_END(&(array->stats), grow_start);
+    } else if(new_stored < array->stored) {
+        VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, new_stored * array->elem_size);
+        array->stored = new_stored;
+    }
+    array->cap = new_cap;
+
+    return 0;
+}
+
+void *varray_inline_elems(Varray *array) {
+    if(array == NULL || array->inline_cap == 0) {
+        return NULL;
+    }
+
+    return pointer_literal_addition(array, VARRAY_INLINE_OFFSET);
+}
+
+void *varray_elems_resize(Varray *array, size_t new_cap) {
+    void *inline_elems = varray_inline_elems(array), *new_elems;
+    size_t old_bytes = array->cap * array->elem_size;
+    size_t new_bytes = new_cap * array->elem_size;
+
+    if(inline_elems != NULL && array->elems == inline_elems) {
+        if(new_cap == array->inline_cap) {
+            return inline_elems;
+        }
+
+        // overflowing the inline elements
+        new_elems = vallocator_alloc(array->allocator, new_bytes);
+        if(new_elems == NULL) {
+            return NULL;
+        }
+        memcpy(new_elems, inline_elems, old_bytes < new_bytes ? old_bytes : new_bytes);
+        return new_elems;
+    }
+
+    if(inline_elems != NULL && new_cap == array->inline_cap) {
+        // fits inline again
+        memcpy(inline_elems, array->elems, new_bytes);
+        vallocator_free(array->allocator, array->elems, old_bytes);
+        return inline_elems;
+    }
+
+    if(new_cap == 0) {
+        vallocator_free(array->allocator, array->elems, old_bytes);
+        return NULL;
+    }
+    return vallocator_realloc(array->allocator, array->elems, old_bytes, new_bytes);
+}
+
+int varray_push(Varray *array, void *src) {
+    if(array == NULL || src == NULL) {
+        return 1;
+    }
+
+    if(array->stored == array->cap) {
+        if(array->stored == SIZE_MAX || varray_cap_set(array, varray_cap_next(array, array->stored + 1)) != 0) {
+            return 2;
+        }
+    }
+
+    memcpy(pointer_literal_addition(array->elems, array->stored * array->elem_size), src, array->elem_size);
+    VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, (array->stored + 1) * array->elem_size);
+    array->stored++;
+    return 0;
+}
+
+int varray_pop(Varray *array, void *dest) {
+    if(array == NULL) {
+        return 1;
+    }
+
+    if(array->stored == 0) {
+        return 2;
+    }
+
+    array->stored--;
+    VSTATS_LIVE(&(array->stats), (array->stored + 1) * array->elem_size, array->stored * array->elem_size);
+    if(dest != NULL) {
+        memcpy(dest, pointer_literal_addition(array->elems, array->stored * array->elem_size), array->elem_size);
+    }
+    return 0;
+}
+
+int varray_append_many(Varray *array, void *src, size_t num_elems) {
+    if(array == NULL || (src == NULL && num_elems != 0)) {
+        return 1;
+    }
+
+    if(num_elems > SIZE_MAX - array->stored) {
+        return 2;
+    }
+
+    if(array->stored + num_elems > array->cap) {
+        if(varray_cap_set(array, varray_cap_next(array, array->stored + num_elems)) != 0) {
+            return 3;
+        }
+    }
+
+    if(num_elems != 0) {
+        memcpy(pointer_literal_addition(array->elems, array->stored * array->elem_size), src, num_elems * array->elem_size);
+    }
+    VSTATS_LIVE(&(array->stats), array->stored * array->elem_size, (array->stored + num_elems) * array->elem_size);
+    array->stored += num_elems;
+    return 0;
+}
+
+int varray_reserve(Varray *array, size_t num_elems) {
+    if(array == NULL) {
+        return 1;
+    }
+
+    if(num_elems <= array->cap) {
+        return 0;
+    }
+
+    return varray_cap_set(array, num_elems);
+}
+
+int varray_shrink_to_fit(Varray *array) {
+    if(array == NULL) {
+        return 1;
+    }
+
+    return varray_cap_set(array, array->stored);
+}
+
 size_t varray_len(Varray *array) {
     if(array == NULL) {
         return 0;
@@ -207,3 +474,17 @@ size_t varray_cap(Varray *array) {
 
     return array->cap;
 }
+
+int varray_stats(Varray *array, Vstats *dest) {
+    if(array == NULL || dest == NULL) {
+        return EINVAL;
+    }
+
+#ifdef DERT_STATS
+    memcpy(dest, &(array->stats), sizeof(Vstats));
+    return 0;
+#else
+    memset(dest, 0, sizeof(Vstats));
+    return ENOTSUP;
+#endif
+}
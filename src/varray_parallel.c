@@ -0,0 +1,267 @@
+#include <varray_parallel.h>
+#include <varray_parallel_priv.h>
+#include <varray.h>
+#include <tpoolrr.h>
+#include <pointerarith.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int varray_parallel_for(Varray *array, Tpoolrr *pool, size_t grain, Varray_parallel_fn fn, void *ctx) {
+    struct varray_parallel_task task = { 0 };
+
+    if(array == NULL || fn == NULL) {
+        return EINVAL;
+    }
+
+    task.kind = VARRAY_PARALLEL_KIND_FOR;
+    task.array = array;
+    task.for_fn = fn;
+    task.ctx = ctx;
+    return varray_parallel_run(&task, pool, grain, 0, NULL, NULL, NULL);
+}
+
+int varray_parallel_map(Varray *dest, Varray *src, Tpoolrr *pool, size_t grain, Varray_parallel_map_fn fn, void *ctx) {
+    struct varray_parallel_task task = { 0 };
+    int res;
+
+    if(dest == NULL || src == NULL || dest == src || fn == NULL) {
+        return EINVAL;
+    }
+
+    res = varray_resize(dest, varray_len(src));
+    if(res != 0) {
+        return res;
+    }
+
+    task.kind = VARRAY_PARALLEL_KIND_MAP;
+    task.array = src;
+    task.dest = dest;
+    task.map_fn = fn;
+    task.ctx = ctx;
+    return varray_parallel_run(&task, pool, grain, 0, NULL, NULL, NULL);
+}
+
+int varray_parallel_reduce(Varray *array, Tpoolrr *pool, size_t grain, size_t acc_size, void *identity,
+                           Varray_parallel_fold_fn fold, Varray_parallel_combine_fn combine, void *ctx, void *dest) {
+    struct varray_parallel_task task = { 0 };
+
+    if(array == NULL || acc_size == 0 || identity == NULL || fold == NULL || combine == NULL || dest == NULL) {
+        return EINVAL;
+    }
+
+    task.kind = VARRAY_PARALLEL_KIND_REDUCE;
+    task.array = array;
+    task.fold_fn = fold;
+    task.ctx = ctx;
+    return varray_parallel_run(&task, pool, grain, acc_size, identity, combine, dest);
+}
+
+size_t varray_parallel_unit(Varray *array) {
+    size_t a, b, tmp;
+
+    a = VARRAY_PARALLEL_CACHE_LINE_SIZE;
+    b = array->elem_size;
+    while(b != 0) {
+        tmp = a % b;
+        a = b;
+        b = tmp;
+    }
+    return VARRAY_PARALLEL_CACHE_LINE_SIZE / a;
+}
+
+size_t varray_parallel_head(Varray *array) {
+    uintptr_t address = (uintptr_t) array->elems;
+    size_t unit = varray_parallel_unit(array);
+
+    // element starts repeat their offset within a cache line every unit elements
+    for(size_t i = 0; i < unit; i++) {
+        if((address + (i * array->elem_size)) % VARRAY_PARALLEL_CACHE_LINE_SIZE == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+size_t varray_parallel_grain(Varray *array, Tpoolrr *pool, size_t grain) {
+    size_t unit = varray_parallel_unit(array);
+
+    if(grain == 0) {
+        if(pool == NULL) {
+            grain = array->stored;
+        } else {
+            grain = array->stored / (tpoolrr_threads_total(pool) * VARRAY_PARALLEL_CHUNKS_PER_THREAD);
+        }
+    }
+    if(grain < unit) {
+        return unit;
+    }
+    if(grain > SIZE_MAX - unit) {
+        return grain;
+    }
+    return ((grain + unit - 1) / unit) * unit;
+}
+
+int varray_parallel_run(struct varray_parallel_task *task, Tpoolrr *pool, size_t grain,
+                        size_t acc_size, void *identity, Varray_parallel_combine_fn combine, void *dest) {
+    struct varray_parallel_chunk *chunks;
+    Varray *written;
+    void *accs = NULL;
+    size_t len, head, rest, num_chunks, acc_stride = 0;
+    int res = 0;
+
+    if(task->kind == VARRAY_PARALLEL_KIND_REDUCE) {
+        memcpy(dest, identity, acc_size);
+    }
+
+    len = varray_len(task->array);
+    if(len == 0) {
+        return 0;
+    }
+    if(pool != NULL && (tpoolrr_submissions_queued(pool) != 0 || tpoolrr_completions_queued(pool) != 0)) {
+        return EBUSY;
+    }
+
+    // chunk boundaries are placed on cache lines of the Varray workers write to
+    // the first chunk also takes the elements before the first cache line boundary
+    written = (task->kind == VARRAY_PARALLEL_KIND_MAP) ? task->dest : task->array;
+    grain = varray_parallel_grain(written, pool, grain);
+    head = varray_parallel_head(written);
+    if(head >= len) {
+        head = 0;
+    }
+    num_chunks = ((len - head) / grain) + ((len - head) % grain != 0);
+    chunks = calloc(num_chunks, sizeof(struct varray_parallel_chunk));
+    if(chunks == NULL) {
+        return ENOMEM;
+    }
+
+    if(task->kind == VARRAY_PARALLEL_KIND_REDUCE) {
+        // keep accumulators on separate cache lines as workers write them constantly
+        acc_stride = ((acc_size + VARRAY_PARALLEL_CACHE_LINE_SIZE - 1) / VARRAY_PARALLEL_CACHE_LINE_SIZE) *
+                     VARRAY_PARALLEL_CACHE_LINE_SIZE;
+        if(acc_stride < acc_size || num_chunks > SIZE_MAX / acc_stride) {
+            free(chunks);
+            return ENOMEM;
+        }
+        accs = aligned_alloc(VARRAY_PARALLEL_CACHE_LINE_SIZE, num_chunks * acc_stride);
+        if(accs == NULL) {
+            free(chunks);
+            return ENOMEM;
+        }
+    }
+
+    for(size_t i = 0; i < num_chunks; i++) {
+        chunks[i].task = task;
+        chunks[i].pos = (i == 0) ? 0 : head + (i * grain);
+        rest = len - head - (i * grain);
+        chunks[i].num_elems = ((rest < grain) ? rest : grain) + ((i == 0) ? head : 0);
+        if(accs != NULL) {
+            chunks[i].acc = pointer_literal_addition(accs, i * acc_stride);
+            memcpy(chunks[i].acc, identity, acc_size);
+        }
+    }
+
+    if(pool == NULL || num_chunks == 1) {
+        for(size_t i = 0; i < num_chunks; i++) {
+            varray_parallel_chunk_run(&(chunks[i]));
+        }
+    } else {
+        res = varray_parallel_dispatch(pool, chunks, num_chunks);
+    }
+
+    if(res == 0 && accs != NULL) {
+        for(size_t i = 0; i < num_chunks; i++) {
+            combine(dest, chunks[i].acc, task->ctx);
+        }
+    }
+
+    free(accs);
+    free(chunks);
+    return res;
+}
+
+int varray_parallel_dispatch(Tpoolrr *pool, struct varray_parallel_chunk *chunks, size_t num_chunks) {
+    struct tpoolrr_job job;
+    size_t *in_flight;
+    size_t threads, submitted = 0, completed = 0;
+    bool progress;
+    int res, ret = 0;
+
+    // chunks each worker has not yet handed back, never more than its completion queue holds
+    threads = tpoolrr_threads_total(pool);
+    in_flight = calloc(threads, sizeof(size_t));
+    if(in_flight == NULL) {
+        return ENOMEM;
+    }
+
+    while(completed < submitted || (ret == 0 && submitted < num_chunks)) {
+        // deal chunks out one worker at a time so every worker has work
+        progress = true;
+        while(progress && ret == 0 && submitted < num_chunks) {
+            progress = false;
+            for(size_t i = 0; i < threads && submitted < num_chunks; i++) {
+                if(in_flight[i] >= pool->jobs_per_thread) {
+                    continue;
+                }
+
+                res = tpoolrr_jobs_add_to(pool, i, submitted, varray_parallel_job, &(chunks[submitted]), 0);
+                if(res == EBUSY) {
+                    continue;
+                } else if(res != 0) {
+                    // stop submitting but still wait for chunks already submitted
+                    ret = res;
+                    break;
+                }
+                in_flight[i]++;
+                submitted++;
+                progress = true;
+            }
+        }
+
+        res = tpoolrr_completions_pop(pool, &job);
+        if(res == 0) {
+            in_flight[job.thread_assigned_to]--;
+            completed++;
+        } else if(res == EBUSY) {
+            sched_yield();
+        } else {
+            // chunks still running use chunks and accumulators the caller frees once this returns
+            if(ret == 0) {
+                ret = res;
+            }
+            sched_yield();
+        }
+    }
+
+    free(in_flight);
+    return ret;
+}
+
+void varray_parallel_chunk_run(struct varray_parallel_chunk *chunk) {
+    struct varray_parallel_task *task = chunk->task;
+    void *first = varray_get_direct(task->array, chunk->pos);
+
+    switch(task->kind) {
+    case VARRAY_PARALLEL_KIND_FOR:
+        task->for_fn(first, chunk->pos, chunk->num_elems, task->ctx);
+        break;
+    case VARRAY_PARALLEL_KIND_MAP:
+        task->map_fn(varray_get_direct(task->dest, chunk->pos), first, chunk->pos, chunk->num_elems, task->ctx);
+        break;
+    case VARRAY_PARALLEL_KIND_REDUCE:
+        task->fold_fn(chunk->acc, first, chunk->pos, chunk->num_elems, task->ctx);
+        break;
+    }
+}
+
+void *varray_parallel_job(Tpoolrr *pool, void *arg) {
+    (void)(pool);
+    varray_parallel_chunk_run(arg);
+    return NULL;
+}
@@ -0,0 +1,237 @@
+#include <varray_sort.h>
+#include <varray_sort_priv.h>
+#include <varray.h>
+#include <vallocator.h>
+#include <pointerarith.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int varray_sort(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind) {
+    if(array == NULL || key_width == 0 || key_offset > array->elem_size || key_width > array->elem_size - key_offset) {
+        return EINVAL;
+    }
+    if(kind != VARRAY_SORT_KEY_BYTES && key_width > sizeof(uint64_t)) {
+        return EINVAL;
+    }
+
+    if(array->stored < 2) {
+        return 0;
+    }
+    if(array->stored <= VARRAY_SORT_NETWORK_MAX) {
+        if(key_width <= sizeof(uint64_t)) {
+            varray_sort_network(array, key_offset, key_width, kind);
+        } else {
+            varray_sort_insertion(array, key_offset, key_width);
+        }
+        return 0;
+    }
+    return varray_sort_radix(array, key_offset, key_width, kind);
+}
+
+int varray_sort_radix(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind) {
+    const size_t len = array->stored, elem_size = array->elem_size;
+    size_t *counts, *count, offset, total, digit_offset;
+    uint8_t *src, *dest, *tmp, *elem, flip;
+    void *scratch;
+
+    counts = calloc(key_width * VARRAY_SORT_RADIX, sizeof(size_t));
+    if(counts == NULL) {
+        return ENOMEM;
+    }
+    scratch = vallocator_alloc(array->allocator, len * elem_size);
+    if(scratch == NULL) {
+        free(counts);
+        return ENOMEM;
+    }
+
+    // one pass builds the histogram of every digit
+    elem = array->elems;
+    for(size_t i = 0; i < len; i++) {
+        for(size_t digit = 0; digit < key_width; digit++) {
+            counts[(digit * VARRAY_SORT_RADIX) + elem[key_offset + varray_sort_digit_offset(key_width, kind, digit)]]++;
+        }
+        elem += elem_size;
+    }
+
+    src = array->elems;
+    dest = scratch;
+    for(size_t digit = 0; digit < key_width; digit++) {
+        count = &(counts[digit * VARRAY_SORT_RADIX]);
+        digit_offset = key_offset + varray_sort_digit_offset(key_width, kind, digit);
+
+        // sign bit is flipped so negative numbers come first
+        flip = (kind == VARRAY_SORT_KEY_SIGNED && digit == key_width - 1) ? 0x80 : 0;
+
+        // every element has the same value for this digit
+        if(count[src[digit_offset]] == len) {
+            continue;
+        }
+
+        total = 0;
+        for(size_t value = 0; value < VARRAY_SORT_RADIX; value++) {
+            offset = count[value ^ flip];
+            count[value ^ flip] = total;
+            total += offset;
+        }
+
+        elem = src;
+        for(size_t i = 0; i < len; i++) {
+            varray_sort_copy(dest + (count[elem[digit_offset]]++ * elem_size), elem, elem_size);
+            elem += elem_size;
+        }
+
+        tmp = src;
+        src = dest;
+        dest = tmp;
+    }
+
+    if(src != array->elems) {
+        memcpy(array->elems, src, len * elem_size);
+    }
+
+    vallocator_free(array->allocator, scratch, len * elem_size);
+    free(counts);
+    return 0;
+}
+
+void varray_sort_network(Varray *array, size_t key_offset, size_t key_width, enum varray_sort_key kind) {
+    uint64_t keys[VARRAY_SORT_NETWORK_MAX], key_a, key_b, mask;
+    uint8_t order[VARRAY_SORT_NETWORK_MAX], order_a, order_b;
+    size_t len = array->stored, width = 2, a, b, pos;
+
+    while(width < len) {
+        width *= 2;
+    }
+
+    // callers never pass more than VARRAY_SORT_NETWORK_MAX elements, clamping makes the bound visible to the compiler
+    if(width > VARRAY_SORT_NETWORK_MAX) {
+        width = VARRAY_SORT_NETWORK_MAX;
+    }
+
+    // padding sorts after every element, ties are broken by original position to keep the sort stable
+    for(size_t i = 0; i < width; i++) {
+        if(i < len) {
+            keys[i] = varray_sort_key_load(varray_get_direct(array, i), key_offset, key_width, kind);
+        } else {
+            keys[i] = UINT64_MAX;
+        }
+    }
+    for(size_t i = 0; i < VARRAY_SORT_NETWORK_MAX; i++) {
+        order[i] = (uint8_t) i;
+    }
+
+    // Batcher's odd-even merge sort, compare-exchange is branch-free so each layer can be vectorized
+    for(size_t p = 1; p < width; p *= 2) {
+        for(size_t k = p; k >= 1; k /= 2) {
+            for(size_t j = k % p; j + k < width; j += 2 * k) {
+                for(size_t i = 0; i < k && i + j + k < width; i++) {
+                    if((i + j) / (2 * p) != (i + j + k) / (2 * p)) {
+                        continue;
+                    }
+                    a = i + j;
+                    b = i + j + k;
+                    key_a = keys[a];
+                    key_b = keys[b];
+                    order_a = order[a];
+                    order_b = order[b];
+                    mask = -(uint64_t) ((key_a > key_b) | ((key_a == key_b) & (order_a > order_b)));
+                    keys[a] = key_a ^ ((key_a ^ key_b) & mask);
+                    keys[b] = key_b ^ ((key_a ^ key_b) & mask);
+                    order[a] = order_a ^ ((order_a ^ order_b) & (uint8_t) mask);
+                    order[b] = order_b ^ ((order_a ^ order_b) & (uint8_t) mask);
+                }
+            }
+        }
+    }
+
+    // the element at order[i] belongs at i, follow already moved elements to where they went
+    for(size_t i = 0; i < len; i++) {
+        pos = order[i];
+        while(pos < i) {
+            pos = order[pos];
+        }
+        if(pos != i) {
+            varray_sort_swap(varray_get_direct(array, i), varray_get_direct(array, pos), array->elem_size);
+        }
+    }
+}
+
+void varray_sort_insertion(Varray *array, size_t key_offset, size_t key_width) {
+    uint8_t *elem, *prev;
+
+    for(size_t i = 1; i < array->stored; i++) {
+        for(size_t j = i; j > 0; j--) {
+            elem = varray_get_direct(array, j);
+            prev = varray_get_direct(array, j - 1);
+            if(memcmp(prev + key_offset, elem + key_offset, key_width) <= 0) {
+                break;
+            }
+            varray_sort_swap(prev, elem, array->elem_size);
+        }
+    }
+}
+
+size_t varray_sort_digit_offset(size_t key_width, enum varray_sort_key kind, size_t digit) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(kind != VARRAY_SORT_KEY_BYTES) {
+        return digit;
+    }
+#else
+    (void)(kind);
+#endif
+    return key_width - 1 - digit;
+}
+
+uint64_t varray_sort_key_load(void *elem, size_t key_offset, size_t key_width, enum varray_sort_key kind) {
+    uint8_t *key = pointer_literal_addition(elem, key_offset);
+    uint64_t ret = 0;
+
+    for(size_t digit = key_width; digit > 0; digit--) {
+        ret = (ret << 8) | key[varray_sort_digit_offset(key_width, kind, digit - 1)];
+    }
+    if(kind == VARRAY_SORT_KEY_SIGNED) {
+        ret ^= ((uint64_t) 1) << ((key_width * 8) - 1);
+    }
+    return ret;
+}
+
+void varray_sort_copy(void *dest, void *src, size_t elem_size) {
+    // constant sizes let the compiler use plain loads and stores
+    switch(elem_size) {
+    case 4:
+        memcpy(dest, src, 4);
+        break;
+    case 8:
+        memcpy(dest, src, 8);
+        break;
+    case 16:
+        memcpy(dest, src, 16);
+        break;
+    case 32:
+        memcpy(dest, src, 32);
+        break;
+    default:
+        memcpy(dest, src, elem_size);
+        break;
+    }
+}
+
+void varray_sort_swap(void *a, void *b, size_t elem_size) {
+    uint8_t tmp[64];
+    size_t piece;
+
+    while(elem_size > 0) {
+        piece = (elem_size < sizeof(tmp)) ? elem_size : sizeof(tmp);
+        memcpy(tmp, a, piece);
+        memcpy(a, b, piece);
+        memcpy(b, tmp, piece);
+        a = pointer_literal_addition(a, piece);
+        b = pointer_literal_addition(b, piece);
+        elem_size -= piece;
+    }
+}
@@ -1,5 +1,7 @@
 #include <vdll.h>
 #include <vdll_priv.h>
+#include <vallocator.h>
+#include <vpool.h>
 #include <pointerarith.h>
 
 #include <stddef.h>
@@ -7,19 +9,41 @@
 #include <string.h>
 #include <errno.h>
 
-Vdll_node *vdll_node_create(size_t elem_size, int (*init)(void *arg)){
-	if(elem_size == 0){
+void *vdll_node_alloc(Vdll *dll, size_t num_bytes){
+	if(dll->allocator != NULL){
+		return vallocator_alloc(dll->allocator, num_bytes);
+	}
+
+	if(dll->pool == NULL){
+		dll->pool = vpool_create(VDLL_POOL_INITIAL_NODES, num_bytes, VPOOL_KIND_DYNAMIC);
+		if(dll->pool == NULL){
+			return NULL;
+		}
+	}
+	return vpool_alloc(dll->pool);
+}
+
+void vdll_node_free(Vdll *dll, void *node, size_t num_bytes){
+	if(dll->allocator != NULL){
+		vallocator_free(dll->allocator, node, num_bytes);
+	} else {
+		vpool_dealloc(dll->pool, node);
+	}
+}
+
+Vdll_node *vdll_node_create(Vdll *dll, int (*init)(void *arg)){
+	if(dll->elem_size == 0){
 		return NULL;
 	}
 
-	Vdll_node *ret = malloc(elem_size + sizeof(Vdll_node));
+	Vdll_node *ret = vdll_node_alloc(dll, dll->elem_size + sizeof(Vdll_node));
 	if(ret == NULL){
 		return NULL;
 	}
 
 	// pointer addition in this case scales by 1
 	ret->data = pointer_literal_addition(ret, sizeof(Vdll_node));
-    memset(ret->data, 0, elem_size);
+    memset(ret->data, 0, dll->elem_size);
     if(init != NULL){
         init(ret->data);
     }
@@ -29,13 +53,13 @@ Vdll_node *vdll_node_create(size_t elem_size, int (*init)(void *arg)){
 	return ret;
 }
 
-int vdll_node_destroy(Vdll_node *node, size_t elem_size, int (*deinit)(void *arg)){
+int vdll_node_destroy(Vdll *dll, Vdll_node *node, int (*deinit)(void *arg)){
 	if(node != NULL){
         if(deinit != NULL){
             deinit(node->data);
         }
-        memset(node, 0, sizeof(Vdll_node) + elem_size);
-		free(node);
+        memset(node, 0, sizeof(Vdll_node) + dll->elem_size);
+		vdll_node_free(dll, node, sizeof(Vdll_node) + dll->elem_size);
 	}
 
 	return 0;
@@ -53,6 +77,21 @@ int vdll_seek(Vdll *dll, size_t pos){
 	void *orig_ptr = dll->ptr;
 	size_t orig_pos = dll->pos;
 
+	// jump close to pos when it is far from the current position
+	if(dll->index != NULL && (pos > dll->pos ? pos - dll->pos : dll->pos - pos) > VDLL_INDEX_WALK_MAX){
+		size_t entry_pos;
+		Vdll_index_entry *entry = vdll_index_find(dll->index, pos, &entry_pos);
+		if(entry == NULL){
+			// pos comes before every entry, so rewind from the first
+			entry = dll->index->head[0].next;
+			entry_pos = dll->index->head[0].width;
+		}
+		if(entry != NULL){
+			dll->ptr = entry->node;
+			dll->pos = entry_pos;
+		}
+	}
+
 	int check = 0;
 	if(pos > dll->pos){
 		check = vdll_wind(dll, pos - dll->pos);
@@ -105,23 +144,26 @@ int vdll_rewind(Vdll *dll, size_t decrement){
 	return 0;
 }
 
-Vdll *vdll_create(size_t elem_size, Vdll_functions *functions){
-	Vdll *ret = malloc(sizeof(Vdll));
+Vdll *vdll_create(size_t elem_size, Vdll_kind kind, Vdll_functions *functions, Vallocator *allocator){
+	Vdll *ret = vallocator_alloc(allocator, sizeof(Vdll));
 	if(ret == 0){
 		return NULL;
 	}
 
-    if(vdll_init(ret, elem_size, functions) != 0){
-        free(ret);
+    if(vdll_init(ret, elem_size, kind, functions, allocator) != 0){
+        vallocator_free(allocator, ret, sizeof(Vdll));
         return NULL;
     }
 	return ret;
 }
 
-int vdll_init(Vdll *dll, size_t elem_size, Vdll_functions *functions){
+int vdll_init(Vdll *dll, size_t elem_size, Vdll_kind kind, Vdll_functions *functions, Vallocator *allocator){
     if(dll == NULL || elem_size == 0){
         return 1;
     }
+    if(kind != VDLL_KIND_NODE && kind != VDLL_KIND_UNROLLED){
+        return 1;
+    }
 
     if(memset(dll, 0, sizeof(Vdll)) != dll){
         return ENOTRECOVERABLE;
@@ -131,6 +173,13 @@ int vdll_init(Vdll *dll, size_t elem_size, Vdll_functions *functions){
 	dll->pos = 0;
 	dll->cap = 0;
 	dll->functions = functions;
+	dll->allocator = allocator;
+	dll->kind = kind;
+	if(kind == VDLL_KIND_UNROLLED){
+		dll->chunk_cap = vdll_unrolled_node_cap(elem_size);
+	}
+	dll->pool = NULL;
+	dll->index = NULL;
     return 0;
 }
 
@@ -139,10 +188,15 @@ void vdll_deinit(Vdll *dll){
         return;
     }
 
-	if(dll->cap != 0){
+	vdll_index_disable(dll);
+	if(dll->kind == VDLL_KIND_UNROLLED){
+		vdll_unrolled_clear(dll);
+	} else if(dll->cap != 0){
 		vdll_shrink(dll, dll->cap);
 	}
 
+	vpool_destroy(dll->pool);
+	dll->pool = NULL;
     return;
 }
 
@@ -153,7 +207,7 @@ void vdll_destroy(Vdll *dll){
 
     vdll_deinit(dll);
 
-	free(dll);
+	vallocator_free(dll->allocator, dll, sizeof(Vdll));
 	return;
 }
 
@@ -164,6 +218,9 @@ int vdll_get(Vdll *dll, size_t pos, void *dest){
 	}
 
     src = vdll_get_direct(dll, pos);
+	if(src == NULL){
+		return 2;
+	}
 	if(memcpy(dest, src, dll->elem_size) != dest){
 		return 3;
 	}
@@ -176,7 +233,15 @@ void *vdll_get_direct(Vdll *dll, size_t pos){
         return NULL;
     }
 
-	if(vdll_seek(dll, pos) != 0){
+	if(dll->kind == VDLL_KIND_UNROLLED){
+		if(pos >= dll->cap || vdll_unrolled_seek(dll, pos) != 0){
+			return NULL;
+		}
+		return vdll_unrolled_elem(dll, dll->chunk, pos - dll->pos);
+	}
+
+	// vdll_seek accepts position 0 of an empty list, which has no node to read
+	if(pos >= dll->cap || vdll_seek(dll, pos) != 0){
 		return NULL;
 	}
 
@@ -188,7 +253,16 @@ int vdll_set(Vdll *dll, size_t pos, void *src){
 		return 1;
 	}
 
-	if(vdll_seek(dll, pos) != 0){
+	if(dll->kind == VDLL_KIND_UNROLLED){
+		void *dest = vdll_get_direct(dll, pos);
+		if(dest == NULL){
+			return 2;
+		}
+		memcpy(dest, src, dll->elem_size);
+		return 0;
+	}
+
+	if(pos >= dll->cap || vdll_seek(dll, pos) != 0){
 		return 2;
 	}
 
@@ -208,6 +282,19 @@ size_t vdll_len(Vdll *dll){
 }
 
 int vdll_insert(Vdll *dll, size_t pos, size_t num_elems){
+	if(dll != NULL && dll->kind == VDLL_KIND_UNROLLED){
+		if(num_elems == 0){
+			return 1;
+		}
+		if(dll->cap == 0){
+			return pos == 0 ? vdll_unrolled_insert(dll, 0, num_elems) : 2;
+		}
+		if(pos >= dll->cap){
+			return 2;
+		}
+		return vdll_unrolled_insert(dll, pos + 1, num_elems);
+	}
+
     return _vdll_insert(dll, pos, num_elems, false);
 }
 
@@ -225,10 +312,10 @@ int _vdll_insert(Vdll *dll, size_t pos, size_t num_elems, bool after){
         if(dll->functions != NULL && dll->functions->init != NULL){
             init = dll->functions->init;
         }
-        Vdll_node *new = vdll_node_create(dll->elem_size, init);
+        Vdll_node *new = vdll_node_create(dll, init);
 
 		if(new == NULL){
-			if(i > 1){
+			if(i > 0){
 				// deallocate everything added prior to failure
 				vdll_delete(dll, pos + 1, i);
 			}
@@ -236,6 +323,7 @@ int _vdll_insert(Vdll *dll, size_t pos, size_t num_elems, bool after){
 		}
 
         // after controls whether we insert before or after element ptr references.
+		size_t new_pos = dll->pos;
 		if(dll->ptr == NULL){
 			dll->ptr = new;
 		} else if (after){
@@ -255,8 +343,10 @@ int _vdll_insert(Vdll *dll, size_t pos, size_t num_elems, bool after){
 				dll->ptr->next->prev = new;
 			}
 			dll->ptr->next = new;
+			new_pos += 1;
 		}
 
+		vdll_index_add(dll, new, new_pos, 1);
 		dll->cap += 1;
 	}
 
@@ -268,6 +358,13 @@ int vdll_delete(Vdll *dll, size_t pos, size_t num_elems){
 		return 1;
 	}
 
+	if(dll->kind == VDLL_KIND_UNROLLED){
+		if(pos >= dll->cap || num_elems > dll->cap - pos){
+			return 2;
+		}
+		return vdll_unrolled_delete(dll, pos, num_elems);
+	}
+
 	if(vdll_seek(dll, pos) != 0){
 		return 2;
 	}
@@ -286,26 +383,26 @@ int vdll_delete(Vdll *dll, size_t pos, size_t num_elems){
         if(dll->functions != NULL && dll->functions->deinit != NULL){
             deinit = dll->functions->deinit;
         }
-        vdll_node_destroy(current, dll->elem_size, deinit);
+        vdll_index_remove(dll, current, dll->pos, 1);
+        vdll_node_destroy(dll, current, deinit);
 
+		// move on to the next element, which takes over pos, unless the last element was deleted
 		if(prev == NULL && next == NULL){
 			dll->ptr = NULL;
+			dll->pos = 0;
 		} else if(prev == NULL){
 			dll->ptr = next;
 			dll->ptr->prev = NULL;
 		} else if(next == NULL){
 			dll->ptr = prev;
 			dll->ptr->next = NULL;
+			dll->pos--;
 		} else {
 			prev->next = next;
 			next->prev = prev;
-			dll->ptr = prev;
+			dll->ptr = next;
 		}
 
-        if(dll->pos != 0){
-		    dll->pos--;
-        }
-
         if(dll->cap != 0){
 		    dll->cap--;
         }
@@ -319,11 +416,15 @@ int vdll_grow(Vdll *dll, size_t num_elems){
 		return 1;
 	}
 
+	if(dll->kind == VDLL_KIND_UNROLLED){
+		return vdll_unrolled_insert(dll, dll->cap, num_elems) == 0 ? 0 : 2;
+	}
+
 	size_t end = 0;
 	if(dll->cap > 1){
 		end = dll->cap - 1;
 	}
-	if(_vdll_insert(dll, end, num_elems, true) != 0){
+	if(_vdll_insert(dll, end, num_elems, false) != 0){
 		return 2;
 	}
 
@@ -331,7 +432,7 @@ int vdll_grow(Vdll *dll, size_t num_elems){
 }
 
 int vdll_shrink(Vdll *dll, size_t num_elems){
-	if(dll == 0 || num_elems == 0){
+	if(dll == 0 || num_elems == 0 || num_elems > dll->cap){
 		return 1;
 	}
 
@@ -341,3 +442,516 @@ int vdll_shrink(Vdll *dll, size_t num_elems){
 
 	return 0;
 }
+
+size_t vdll_unrolled_node_cap(size_t elem_size){
+	size_t ret = (VDLL_UNROLLED_NODE_BYTES - VDLL_UNROLLED_HEADER_BYTES) / elem_size;
+
+	// large elements still share nodes so the list never degrades into one node per element
+	return ret < 2 ? 2 : ret;
+}
+
+Vdll_unrolled_node *vdll_unrolled_node_create(Vdll *dll){
+	Vdll_unrolled_node *ret = vdll_node_alloc(dll, VDLL_UNROLLED_HEADER_BYTES + (dll->chunk_cap * dll->elem_size));
+	if(ret == NULL){
+		return NULL;
+	}
+
+	ret->prev = NULL;
+	ret->next = NULL;
+	ret->count = 0;
+	return ret;
+}
+
+void vdll_unrolled_node_destroy(Vdll *dll, Vdll_unrolled_node *node){
+	vdll_node_free(dll, node, VDLL_UNROLLED_HEADER_BYTES + (dll->chunk_cap * dll->elem_size));
+}
+
+void *vdll_unrolled_elem(Vdll *dll, Vdll_unrolled_node *node, size_t index){
+	// pointer addition in this case scales by 1
+	return pointer_literal_addition(node, VDLL_UNROLLED_HEADER_BYTES + (index * dll->elem_size));
+}
+
+void vdll_unrolled_elems_init(Vdll *dll, void *first, size_t num_elems){
+	memset(first, 0, num_elems * dll->elem_size);
+	if(dll->functions == NULL || dll->functions->init == NULL){
+		return;
+	}
+
+	for(size_t i = 0; i < num_elems; i++){
+		dll->functions->init(pointer_literal_addition(first, i * dll->elem_size));
+	}
+}
+
+void vdll_unrolled_elems_deinit(Vdll *dll, void *first, size_t num_elems){
+	if(dll->functions == NULL || dll->functions->deinit == NULL){
+		return;
+	}
+
+	for(size_t i = 0; i < num_elems; i++){
+		dll->functions->deinit(pointer_literal_addition(first, i * dll->elem_size));
+	}
+}
+
+void vdll_unrolled_link(Vdll *dll, Vdll_unrolled_node *prev, Vdll_unrolled_node *node){
+	node->prev = prev;
+	if(prev == NULL){
+		node->next = dll->head;
+		dll->head = node;
+	} else {
+		node->next = prev->next;
+		prev->next = node;
+	}
+
+	if(node->next == NULL){
+		dll->tail = node;
+	} else {
+		node->next->prev = node;
+	}
+}
+
+void vdll_unrolled_unlink(Vdll *dll, Vdll_unrolled_node *node){
+	if(node->prev == NULL){
+		dll->head = node->next;
+	} else {
+		node->prev->next = node->next;
+	}
+
+	if(node->next == NULL){
+		dll->tail = node->prev;
+	} else {
+		node->next->prev = node->prev;
+	}
+	node->prev = NULL;
+	node->next = NULL;
+}
+
+int vdll_unrolled_seek(Vdll *dll, size_t pos){
+	Vdll_unrolled_node *node = dll->chunk;
+	size_t start = dll->pos;
+
+	if(node == NULL || pos >= dll->cap){
+		return 1;
+	}
+
+	// jump close to pos when it is many nodes away from the last node used
+	if(dll->index != NULL && (pos > start ? pos - start : start - pos) / dll->chunk_cap > VDLL_INDEX_WALK_MAX){
+		Vdll_index_entry *entry = vdll_index_find(dll->index, pos, &start);
+		node = entry == NULL ? dll->head : entry->node;
+		if(entry == NULL){
+			start = 0;
+		}
+	} else if(pos < start && pos < start - pos){
+		// start from an end of the list when it is closer than the last node used
+		node = dll->head;
+		start = 0;
+	} else if(pos >= start + node->count && dll->cap - pos < pos - start){
+		node = dll->tail;
+		start = dll->cap - node->count;
+	}
+
+	while(pos < start){
+		node = node->prev;
+		start -= node->count;
+	}
+	while(pos >= start + node->count){
+		start += node->count;
+		node = node->next;
+	}
+
+	dll->chunk = node;
+	dll->pos = start;
+	return 0;
+}
+
+int vdll_unrolled_insert(Vdll *dll, size_t index, size_t num_elems){
+	Vdll_unrolled_node *node, *rest = NULL, *spare = NULL, *next, *old_next;
+	size_t offset, start, space, needed = 0, take, old_count;
+	bool created = false;
+
+	if(num_elems == 0 || index > dll->cap){
+		return 1;
+	}
+
+	if(dll->head == NULL){
+		node = vdll_unrolled_node_create(dll);
+		if(node == NULL){
+			return 3;
+		}
+		vdll_unrolled_link(dll, NULL, node);
+		start = 0;
+		created = true;
+	} else if(index == dll->cap){
+		node = dll->tail;
+		start = dll->cap - node->count;
+	} else {
+		vdll_unrolled_seek(dll, index);
+		node = dll->chunk;
+		start = dll->pos;
+	}
+	offset = index - start;
+	old_count = node->count;
+	old_next = node->next;
+
+	if(node->count + num_elems <= dll->chunk_cap){
+		// fits, shift the elements after index
+		memmove(vdll_unrolled_elem(dll, node, offset + num_elems), vdll_unrolled_elem(dll, node, offset),
+		        (node->count - offset) * dll->elem_size);
+		vdll_unrolled_elems_init(dll, vdll_unrolled_elem(dll, node, offset), num_elems);
+		node->count += num_elems;
+		if(created){
+			vdll_index_add(dll, node, start, node->count);
+		} else {
+			vdll_index_adjust(dll, start, old_count, node->count);
+		}
+		dll->cap += num_elems;
+		dll->chunk = node;
+		dll->pos = start;
+		return 0;
+	}
+
+	// allocate every node needed up front so failing leaves the list untouched
+	space = dll->chunk_cap - offset;
+	if(num_elems > space){
+		needed = (num_elems - space + dll->chunk_cap - 1) / dll->chunk_cap;
+	}
+	needed += offset < node->count;
+	for(size_t i = 0; i < needed; i++){
+		next = vdll_unrolled_node_create(dll);
+		if(next == NULL){
+			while(spare != NULL){
+				next = spare->next;
+				vdll_unrolled_node_destroy(dll, spare);
+				spare = next;
+			}
+			if(node->count == 0){
+				// was created for an empty list
+				vdll_unrolled_unlink(dll, node);
+				vdll_unrolled_node_destroy(dll, node);
+			}
+			return 3;
+		}
+		next->next = spare;
+		spare = next;
+	}
+
+	// elements after index move to their own node
+	if(offset < node->count){
+		rest = spare;
+		spare = spare->next;
+		memcpy(vdll_unrolled_elem(dll, rest, 0), vdll_unrolled_elem(dll, node, offset), (node->count - offset) * dll->elem_size);
+		rest->count = node->count - offset;
+		node->count = offset;
+		vdll_unrolled_link(dll, node, rest);
+	}
+
+	take = dll->chunk_cap - node->count < num_elems ? dll->chunk_cap - node->count : num_elems;
+	vdll_unrolled_elems_init(dll, vdll_unrolled_elem(dll, node, node->count), take);
+	node->count += take;
+	dll->cap += take;
+	dll->chunk = node;
+	dll->pos = start;
+
+	while(take < num_elems){
+		next = spare;
+		spare = spare->next;
+		vdll_unrolled_link(dll, node, next);
+		node = next;
+
+		node->count = num_elems - take < dll->chunk_cap ? num_elems - take : dll->chunk_cap;
+		vdll_unrolled_elems_init(dll, vdll_unrolled_elem(dll, node, 0), node->count);
+		take += node->count;
+		dll->cap += node->count;
+	}
+
+	// keep nodes full by merging the moved elements back when they fit
+	if(rest != NULL && node != dll->chunk && node->count + rest->count <= dll->chunk_cap){
+		memcpy(vdll_unrolled_elem(dll, node, node->count), vdll_unrolled_elem(dll, rest, 0), rest->count * dll->elem_size);
+		node->count += rest->count;
+		vdll_unrolled_unlink(dll, rest);
+		vdll_unrolled_node_destroy(dll, rest);
+	}
+
+	// index the first node with its final count, then every node that followed it
+	node = dll->chunk;
+	if(created){
+		vdll_index_add(dll, node, start, node->count);
+	} else {
+		vdll_index_adjust(dll, start, old_count, node->count);
+	}
+	for(size_t pos = start + node->count; node->next != old_next; pos += node->count){
+		node = node->next;
+		vdll_index_add(dll, node, pos, node->count);
+	}
+
+	return 0;
+}
+
+int vdll_unrolled_delete(Vdll *dll, size_t index, size_t num_elems){
+	Vdll_unrolled_node *node, *next, *before, *after;
+	size_t offset, start, take, node_start;
+	bool first_kept = true;
+
+	if(num_elems == 0 || index >= dll->cap || num_elems > dll->cap - index){
+		return 1;
+	}
+
+	vdll_unrolled_seek(dll, index);
+	node = dll->chunk;
+	start = dll->pos;
+	offset = index - start;
+	before = node->prev;
+	node_start = start;
+
+	for(size_t remaining = num_elems; remaining > 0; remaining -= take){
+		take = node->count - offset < remaining ? node->count - offset : remaining;
+		vdll_unrolled_elems_deinit(dll, vdll_unrolled_elem(dll, node, offset), take);
+		memmove(vdll_unrolled_elem(dll, node, offset), vdll_unrolled_elem(dll, node, offset + take),
+		        (node->count - offset - take) * dll->elem_size);
+		node->count -= take;
+		dll->cap -= take;
+
+		next = node->next;
+		if(node->count == 0){
+			if(node == dll->chunk){
+				first_kept = false;
+			}
+			vdll_index_remove(dll, node, node_start, take);
+			vdll_unrolled_unlink(dll, node);
+			vdll_unrolled_node_destroy(dll, node);
+		} else {
+			vdll_index_adjust(dll, node_start, node->count + take, node->count);
+		}
+		node = next;
+		offset = 0;
+
+		// every node after the first now starts where the deleted elements did
+		node_start = index;
+	}
+
+	// the node before the deleted elements, and where it starts
+	if(first_kept){
+		before = dll->chunk;
+	} else if(before != NULL){
+		start -= before->count;
+	} else {
+		start = 0;
+	}
+
+	// keep nodes full by merging the nodes on either side of the deleted elements when they fit
+	after = before == NULL ? dll->head : before->next;
+	if(before != NULL && after != NULL && before->count + after->count <= dll->chunk_cap){
+		vdll_index_remove(dll, after, start + before->count, after->count);
+		vdll_index_adjust(dll, start, before->count, before->count + after->count);
+		memcpy(vdll_unrolled_elem(dll, before, before->count), vdll_unrolled_elem(dll, after, 0), after->count * dll->elem_size);
+		before->count += after->count;
+		vdll_unrolled_unlink(dll, after);
+		vdll_unrolled_node_destroy(dll, after);
+	}
+
+	dll->chunk = before == NULL ? dll->head : before;
+	dll->pos = start;
+	return 0;
+}
+
+void vdll_unrolled_clear(Vdll *dll){
+	Vdll_unrolled_node *node = dll->head, *next;
+
+	vdll_index_clear(dll);
+	while(node != NULL){
+		next = node->next;
+		vdll_unrolled_elems_deinit(dll, vdll_unrolled_elem(dll, node, 0), node->count);
+		vdll_unrolled_node_destroy(dll, node);
+		node = next;
+	}
+
+	dll->head = NULL;
+	dll->tail = NULL;
+	dll->chunk = NULL;
+	dll->pos = 0;
+	dll->cap = 0;
+}
+
+int vdll_index_enable(Vdll *dll){
+	if(dll == NULL){
+		return 1;
+	}
+	if(dll->index != NULL){
+		return 0;
+	}
+
+	Vdll_index *index = vallocator_alloc(dll->allocator, sizeof(Vdll_index));
+	if(index == NULL){
+		return ENOMEM;
+	}
+	memset(index, 0, sizeof(Vdll_index));
+	index->random = VDLL_INDEX_SEED;
+	dll->index = index;
+
+	// entries are appended one node at a time as if the list was being built from nothing
+	if(dll->kind == VDLL_KIND_UNROLLED){
+		size_t pos = 0;
+		for(Vdll_unrolled_node *node = dll->head; node != NULL; node = node->next){
+			vdll_index_add(dll, node, pos, node->count);
+			pos += node->count;
+		}
+	} else if(dll->cap != 0){
+		vdll_seek(dll, 0);
+		Vdll_node *node = dll->ptr;
+		for(size_t pos = 0; pos < dll->cap; pos++){
+			vdll_index_add(dll, node, pos, 1);
+			node = node->next;
+		}
+	}
+
+	return 0;
+}
+
+void vdll_index_disable(Vdll *dll){
+	if(dll == NULL || dll->index == NULL){
+		return;
+	}
+
+	vdll_index_clear(dll);
+	vallocator_free(dll->allocator, dll->index, sizeof(Vdll_index));
+	dll->index = NULL;
+}
+
+size_t vdll_index_height(Vdll_index *index){
+	uint64_t random = index->random;
+	random ^= random << 13;
+	random ^= random >> 7;
+	random ^= random << 17;
+	index->random = random;
+
+	// each pair of zero bits is a 1 in 4 chance of going up another level
+	size_t height = 0;
+	while(height < VDLL_INDEX_MAX_HEIGHT && (random & 3) == 0){
+		height++;
+		random >>= 2;
+	}
+	return height;
+}
+
+void vdll_index_path(Vdll_index *index, size_t pos, struct vdll_index_link **path, size_t *path_pos){
+	struct vdll_index_link *links = index->head;
+	size_t at = 0;
+
+	for(size_t level = VDLL_INDEX_MAX_HEIGHT; level-- > 0;){
+		while(links[level].next != NULL && at + links[level].width < pos){
+			at += links[level].width;
+			links = links[level].next->links;
+		}
+		path[level] = &(links[level]);
+		path_pos[level] = at;
+	}
+}
+
+Vdll_index_entry *vdll_index_find(Vdll_index *index, size_t pos, size_t *entry_pos){
+	struct vdll_index_link *links = index->head;
+	Vdll_index_entry *entry = NULL;
+	size_t at = 0;
+
+	for(size_t level = VDLL_INDEX_MAX_HEIGHT; level-- > 0;){
+		while(links[level].next != NULL && at + links[level].width <= pos){
+			at += links[level].width;
+			entry = links[level].next;
+			links = entry->links;
+		}
+	}
+
+	*entry_pos = at;
+	return entry;
+}
+
+void vdll_index_add(Vdll *dll, void *node, size_t pos, size_t count){
+	struct vdll_index_link *path[VDLL_INDEX_MAX_HEIGHT];
+	size_t path_pos[VDLL_INDEX_MAX_HEIGHT];
+	Vdll_index_entry *entry = NULL;
+	size_t height;
+
+	if(dll->index == NULL){
+		return;
+	}
+
+	height = vdll_index_height(dll->index);
+	if(height != 0){
+		entry = vallocator_alloc(dll->allocator, sizeof(Vdll_index_entry) + (height * sizeof(struct vdll_index_link)));
+		if(entry == NULL){
+			height = 0;
+		} else {
+			entry->node = node;
+			entry->height = height;
+		}
+	}
+
+	vdll_index_path(dll->index, pos, path, path_pos);
+	for(size_t level = 0; level < VDLL_INDEX_MAX_HEIGHT; level++){
+		if(level < height){
+			entry->links[level].next = path[level]->next;
+			entry->links[level].width = path_pos[level] + path[level]->width + count - pos;
+			path[level]->next = entry;
+			path[level]->width = pos - path_pos[level];
+		} else {
+			path[level]->width += count;
+		}
+	}
+}
+
+void vdll_index_remove(Vdll *dll, void *node, size_t pos, size_t count){
+	struct vdll_index_link *path[VDLL_INDEX_MAX_HEIGHT];
+	size_t path_pos[VDLL_INDEX_MAX_HEIGHT];
+	Vdll_index_entry *entry;
+	size_t height = 0;
+
+	if(dll->index == NULL){
+		return;
+	}
+
+	vdll_index_path(dll->index, pos, path, path_pos);
+	entry = path[0]->next;
+	if(entry != NULL && entry->node == node){
+		height = entry->height;
+	}
+
+	for(size_t level = 0; level < VDLL_INDEX_MAX_HEIGHT; level++){
+		if(level < height){
+			path[level]->width += entry->links[level].width - count;
+			path[level]->next = entry->links[level].next;
+		} else {
+			path[level]->width -= count;
+		}
+	}
+
+	if(height != 0){
+		vallocator_free(dll->allocator, entry, sizeof(Vdll_index_entry) + (height * sizeof(struct vdll_index_link)));
+	}
+}
+
+void vdll_index_adjust(Vdll *dll, size_t pos, size_t old_count, size_t new_count){
+	struct vdll_index_link *path[VDLL_INDEX_MAX_HEIGHT];
+	size_t path_pos[VDLL_INDEX_MAX_HEIGHT];
+
+	if(dll->index == NULL || old_count == new_count){
+		return;
+	}
+
+	// the last entries at or before pos cover the node starting at pos
+	vdll_index_path(dll->index, pos + 1, path, path_pos);
+	for(size_t level = 0; level < VDLL_INDEX_MAX_HEIGHT; level++){
+		path[level]->width = path[level]->width - old_count + new_count;
+	}
+}
+
+void vdll_index_clear(Vdll *dll){
+	Vdll_index_entry *entry, *next;
+
+	if(dll->index == NULL){
+		return;
+	}
+
+	for(entry = dll->index->head[0].next; entry != NULL; entry = next){
+		next = entry->links[0].next;
+		vallocator_free(dll->allocator, entry, sizeof(Vdll_index_entry) + (entry->height * sizeof(struct vdll_index_link)));
+	}
+	memset(dll->index->head, 0, sizeof(dll->index->head));
+}
@@ -1,6 +1,8 @@
 // all from header/
 #include <vht.h>
 #include <vht_priv.h>
+#include <vallocator.h>
+#include <vstats.h>
 #include <pointerarith.h>
 
 // all from SipHash/
@@ -107,28 +109,28 @@ void *vht_hash_val(Vht *table, uint32_t offset) {
     return val;
 }
 
-Vht *vht_create(size_t key_size, size_t val_size) {
-    return _vht_create(key_size, val_size, VHT_INITIAL_NUM_ELEMS);
+Vht *vht_create(size_t key_size, size_t val_size, Vallocator *allocator) {
+    return _vht_create(key_size, val_size, VHT_INITIAL_NUM_ELEMS, allocator);
 }
 
-Vht *_vht_create(size_t key_size, size_t val_size, size_t num_elems) {
-    Vht *ret = calloc(1, sizeof(Vht));
+Vht *_vht_create(size_t key_size, size_t val_size, size_t num_elems, Vallocator *allocator) {
+    Vht *ret = vallocator_calloc(allocator, 1, sizeof(Vht));
     if(ret == NULL) {
         return NULL;
     }
 
-    if(_vht_init(ret, key_size, val_size, num_elems) != 0) {
-        free(ret);
+    if(_vht_init(ret, key_size, val_size, num_elems, allocator) != 0) {
+        vallocator_free(allocator, ret, sizeof(Vht));
         return NULL;
     }
     return ret;
 }
 
-int vht_init(Vht *table, size_t key_size, size_t val_size) {
-    return _vht_init(table, key_size, val_size, VHT_INITIAL_NUM_ELEMS);
+int vht_init(Vht *table, size_t key_size, size_t val_size, Vallocator *allocator) {
+    return _vht_init(table, key_size, val_size, VHT_INITIAL_NUM_ELEMS, allocator);
 }
 
-int _vht_init(Vht *table, size_t key_size, size_t val_size, size_t num_elems) {
+int _vht_init(Vht *table, size_t key_size, size_t val_size, size_t num_elems, Vallocator *allocator) {
     if(table == NULL || key_size == 0 || val_size == 0) {
         return EINVAL;
     }
@@ -139,22 +141,25 @@ int _vht_init(Vht *table, size_t key_size, size_t val_size, size_t num_elems) {
 
     // Need bitfield to store additional information
     table->key_size = key_size;
-    table->keys = calloc(num_elems, sizeof(struct vht_key_bf) + key_size);
+    table->keys = vallocator_calloc(allocator, num_elems, sizeof(struct vht_key_bf) + key_size);
     if(table->keys == NULL) {
-        free(table->keys);
         return ENOMEM;
     }
 
     table->val_size = val_size;
-    table->vals = calloc(num_elems, val_size);
+    table->vals = vallocator_calloc(allocator, num_elems, val_size);
     if(table->vals == NULL) {
-        free(table->keys);
-        free(table->vals);
+        vallocator_free(allocator, table->keys, num_elems * (sizeof(struct vht_key_bf) + key_size));
         return ENOMEM;
     }
 
     table->len = 0;
     table->cap = num_elems;
+    table->allocator = allocator;
+#ifdef DERT_STATS
+    memset(&(table->stats), 0, sizeof(Vstats));
+#endif
+    VSTATS_RESERVE(&(table->stats), 0, num_elems * (sizeof(struct vht_key_bf) + key_size + val_size));
     return 0;
 }
 
@@ -163,8 +168,10 @@ void vht_deinit(Vht *table) {
         return;
     }
 
-    free(table->keys);
-    free(table->vals);
+    vallocator_free(table->allocator, table->keys, table->cap * (sizeof(struct vht_key_bf) + table->key_size));
+    vallocator_free(table->allocator, table->vals, table->cap * table->val_size);
+    VSTATS_LIVE(&(table->stats), table->len * (table->key_size + table->val_size), 0);
+    VSTATS_RESERVE(&(table->stats), table->cap * (sizeof(struct vht_key_bf) + table->key_size + table->val_size), 0);
     return;
 }
 
@@ -174,7 +181,7 @@ void vht_destroy(Vht *table) {
     }
 
     vht_deinit(table);
-    free(table);
+    vallocator_free(table->allocator, table, sizeof(Vht));
     return;
 }
 
@@ -247,6 +254,7 @@ int vht_set(Vht *table, void *key, void *src) {
             memcpy(table_key, key, table->key_size);
             memcpy(table_val, src, table->val_size);
             table->len++;
+            VSTATS_LIVE(&(table->stats), 0, table->key_size + table->val_size);
             return 0;
         } else if(table_bf->occupied && !memcmp(key, table_key, table->key_size)) {
             memcpy(table_val, src, table->val_size);
@@ -282,6 +290,7 @@ int vht_del(Vht *table, void *key) {
             memset(table_key, 0, table->key_size);
             memset(table_val, 0, table->val_size);
             table->len--;
+            VSTATS_LIVE(&(table->stats), table->key_size + table->val_size, 0);
             return 0;
         }
         remaining_guesses--;
@@ -303,12 +312,13 @@ int vht_double(Vht *table) {
         return EINVAL;
     }
 
-    if(_vht_init(&new_table, table->key_size, table->val_size, 4 * table->cap) != 0) {
+    VSTATS_GROW_START(grow_start);
+    if(_vht_init(&new_table, table->key_size, table->val_size, 4 * table->cap, table->allocator) != 0) {
         return ENOMEM;
     }
-    psuedorandom_sequence = malloc(table->key_size);
+    psuedorandom_sequence = vallocator_alloc(table->allocator, table->key_size);
     if(psuedorandom_sequence == NULL) {
-        free(psuedorandom_sequence);
+        vht_deinit(&new_table);
         return ENOMEM;
     }
     for(size_t i = 0; i < table->key_size; i += VHT_HASH_SALT_LEN_EXPECTED) {
@@ -317,10 +327,10 @@ int vht_double(Vht *table) {
 
     remaining_positions = vht_cap(table);
     if(vht_hash_start(table, psuedorandom_sequence, table->key_size, &offset, &iterate, &table_bf, &table_key, &table_val) != 0) {
-        free(psuedorandom_sequence);
+        vallocator_free(table->allocator, psuedorandom_sequence, table->key_size);
         return ENOTRECOVERABLE;
     }
-    free(psuedorandom_sequence);
+    vallocator_free(table->allocator, psuedorandom_sequence, table->key_size);
     while(remaining_positions-- > 0) {
         if(vht_hash_next(table, &offset, &iterate, &table_bf, &table_key, &table_val) != 0) {
             return ENOTRECOVERABLE;
@@ -336,9 +346,14 @@ int vht_double(Vht *table) {
     }
 
     vht_deinit(table);
+#ifdef DERT_STATS
+    // history of the old table carries over to the new one
+    vstats_merge(&(new_table.stats), &(table->stats));
+#endif
     if(memcpy(table, &new_table, sizeof(Vht)) != table) {
         return ENOTRECOVERABLE;
     }
+    VSTATS_GROW_END(&(table->stats), grow_start);
     return 0;
 }
 
@@ -406,3 +421,17 @@ size_t vht_cap(Vht *table) {
 
     return table->cap;
 }
+
+int vht_stats(Vht *table, Vstats *dest) {
+    if(table == NULL || dest == NULL) {
+        return EINVAL;
+    }
+
+#ifdef DERT_STATS
+    memcpy(dest, &(table->stats), sizeof(Vstats));
+    return 0;
+#else
+    memset(dest, 0, sizeof(Vstats));
+    return ENOTSUP;
+#endif
+}
@@ -0,0 +1,238 @@
+#include <vilist.h>
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+
+Vilist *vilist_create(void) {
+    Vilist *ret = calloc(1, sizeof(Vilist));
+    if(ret == NULL) {
+        return NULL;
+    }
+
+    if(vilist_init(ret) != 0) {
+        free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+int vilist_init(Vilist *list) {
+    if(list == NULL) {
+        return EINVAL;
+    }
+
+    list->head.prev = &(list->head);
+    list->head.next = &(list->head);
+    return 0;
+}
+
+void vilist_deinit(Vilist *list) {
+    Vilist_link *link, *next;
+
+    if(list == NULL || list->head.next == NULL) {
+        return;
+    }
+
+    // elements may go on other lists afterwards so they must not keep pointing into this one
+    for(link = list->head.next; link != &(list->head); link = next) {
+        next = link->next;
+        vilist_link_init(link);
+    }
+    vilist_init(list);
+}
+
+void vilist_destroy(Vilist *list) {
+    if(list == NULL) {
+        return;
+    }
+
+    vilist_deinit(list);
+    free(list);
+}
+
+void vilist_link_init(Vilist_link *link) {
+    if(link == NULL) {
+        return;
+    }
+
+    link->prev = NULL;
+    link->next = NULL;
+}
+
+bool vilist_linked(Vilist_link *link) {
+    return link != NULL && link->next != NULL;
+}
+
+bool vilist_empty(Vilist *list) {
+    return list == NULL || list->head.next == &(list->head);
+}
+
+size_t vilist_len(Vilist *list) {
+    size_t ret = 0;
+
+    if(list == NULL) {
+        return 0;
+    }
+
+    for(Vilist_link *link = list->head.next; link != &(list->head); link = link->next) {
+        ret++;
+    }
+    return ret;
+}
+
+Vilist_link *vilist_first(Vilist *list) {
+    if(vilist_empty(list)) {
+        return NULL;
+    }
+
+    return list->head.next;
+}
+
+Vilist_link *vilist_last(Vilist *list) {
+    if(vilist_empty(list)) {
+        return NULL;
+    }
+
+    return list->head.prev;
+}
+
+Vilist_link *vilist_next(Vilist *list, Vilist_link *link) {
+    if(list == NULL || !vilist_linked(link) || link->next == &(list->head)) {
+        return NULL;
+    }
+
+    return link->next;
+}
+
+Vilist_link *vilist_prev(Vilist *list, Vilist_link *link) {
+    if(list == NULL || !vilist_linked(link) || link->prev == &(list->head)) {
+        return NULL;
+    }
+
+    return link->prev;
+}
+
+int vilist_push_front(Vilist *list, Vilist_link *link) {
+    if(list == NULL) {
+        return EINVAL;
+    }
+
+    return vilist_insert_after(&(list->head), link);
+}
+
+int vilist_push_back(Vilist *list, Vilist_link *link) {
+    if(list == NULL) {
+        return EINVAL;
+    }
+
+    return vilist_insert_before(&(list->head), link);
+}
+
+Vilist_link *vilist_pop_front(Vilist *list) {
+    Vilist_link *ret = vilist_first(list);
+
+    if(ret != NULL) {
+        vilist_remove(ret);
+    }
+    return ret;
+}
+
+Vilist_link *vilist_pop_back(Vilist *list) {
+    Vilist_link *ret = vilist_last(list);
+
+    if(ret != NULL) {
+        vilist_remove(ret);
+    }
+    return ret;
+}
+
+int vilist_insert_before(Vilist_link *pos, Vilist_link *link) {
+    if(!vilist_linked(pos) || link == NULL) {
+        return EINVAL;
+    }
+    if(vilist_linked(link)) {
+        return EEXIST;
+    }
+
+    return vilist_insert_after(pos->prev, link);
+}
+
+int vilist_insert_after(Vilist_link *pos, Vilist_link *link) {
+    if(!vilist_linked(pos) || link == NULL) {
+        return EINVAL;
+    }
+    if(vilist_linked(link)) {
+        return EEXIST;
+    }
+
+    link->prev = pos;
+    link->next = pos->next;
+    pos->next->prev = link;
+    pos->next = link;
+    return 0;
+}
+
+int vilist_remove(Vilist_link *link) {
+    if(!vilist_linked(link)) {
+        return EINVAL;
+    }
+
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    vilist_link_init(link);
+    return 0;
+}
+
+int vilist_splice(Vilist_link *pos, Vilist_link *first, Vilist_link *last) {
+    if(!vilist_linked(pos) || !vilist_linked(first) || !vilist_linked(last)) {
+        return EINVAL;
+    }
+
+    // already in place
+    if(pos == first->prev) {
+        return 0;
+    }
+
+    // close the gap the run leaves behind
+    first->prev->next = last->next;
+    last->next->prev = first->prev;
+
+    // and open one after pos
+    first->prev = pos;
+    last->next = pos->next;
+    pos->next->prev = last;
+    pos->next = first;
+    return 0;
+}
+
+int vilist_splice_front(Vilist *dest, Vilist *src) {
+    if(dest == NULL || src == NULL || dest == src) {
+        return EINVAL;
+    }
+    if(vilist_empty(src)) {
+        return 0;
+    }
+
+    return vilist_splice(&(dest->head), src->head.next, src->head.prev);
+}
+
+int vilist_splice_back(Vilist *dest, Vilist *src) {
+    if(dest == NULL || src == NULL || dest == src) {
+        return EINVAL;
+    }
+    if(vilist_empty(src)) {
+        return 0;
+    }
+
+    return vilist_splice(dest->head.prev, src->head.next, src->head.prev);
+}
+
+int vilist_split(Vilist *dest, Vilist *src, Vilist_link *link) {
+    if(dest == NULL || src == NULL || dest == src || link == &(src->head)) {
+        return EINVAL;
+    }
+
+    return vilist_splice(dest->head.prev, link, src->head.prev);
+}
@@ -0,0 +1,492 @@
+// needed for mremap and MAP_ANONYMOUS
+#define _GNU_SOURCE 1
+
+#include <vmalloc.h>
+#include <vmalloc_priv.h>
+#include <vpool.h>
+#include <fmutex.h>
+#include <pointerarith.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+// Zeroed memory is an unlocked Fmutex and an empty size class
+// So, nothing needs to run before the first allocation
+static struct vmalloc_class vmalloc_classes[VMALLOC_NUM_CLASSES] = { 0 };
+
+// initial-exec keeps glibc from calling malloc to set up thread local storage when loaded using LD_PRELOAD
+static __thread struct vmalloc_cache vmalloc_caches[VMALLOC_NUM_CLASSES] __attribute__((tls_model("initial-exec")));
+static __thread bool vmalloc_thread_registered __attribute__((tls_model("initial-exec"))) = false;
+
+static pthread_once_t vmalloc_thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t vmalloc_thread_key;
+
+// Size class for every multiple of 16 up to VMALLOC_SMALL_BYTES, indexed by (block_bytes + 15) / 16
+static const uint8_t vmalloc_small_classes[(VMALLOC_SMALL_BYTES / 16) + 1] = {
+    0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 7, 8, 8, 9, 9, 10,
+    10, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14,
+    14, 15, 15, 15, 15, 15, 15, 15, 15, 16, 16, 16, 16, 16, 16, 16,
+    16, 17, 17, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18,
+    18
+};
+
+uint32_t vmalloc_class_index(size_t block_bytes) {
+    size_t b;
+    uint32_t exponent;
+
+    // most requests are small enough that a table lookup replaces the arithmetic below
+    if(block_bytes <= VMALLOC_SMALL_BYTES) {
+        return vmalloc_small_classes[(block_bytes + 15) / 16];
+    }
+
+    // four classes between each power of two
+    b = block_bytes - 1;
+    exponent = (8 * sizeof(unsigned long long)) - 1 - __builtin_clzll(b);
+    return 7 + ((exponent - 7) * 4) + ((b >> (exponent - 2)) & 0x3);
+}
+
+size_t vmalloc_class_size(uint32_t index) {
+    size_t exponent;
+
+    if(index < 7) {
+        return 16 * (index + 2);
+    }
+
+    exponent = 7 + ((index - 7) / 4);
+    return ((size_t) 1 << exponent) + ((((index - 7) % 4) + 1) * ((size_t) 1 << (exponent - 2)));
+}
+
+void *vmalloc_class_alloc(uint32_t index) {
+    struct vmalloc_cache *cache = &(vmalloc_caches[index]);
+
+    if(cache->count == 0) {
+        if(!vmalloc_thread_registered) {
+            vmalloc_thread_register();
+        }
+
+        if(vmalloc_class_refill(index, cache) != 0) {
+            return NULL;
+        }
+    }
+
+    cache->count--;
+    return cache->blocks[cache->count];
+}
+
+void vmalloc_class_free(uint32_t index, void *block) {
+    struct vmalloc_cache *cache = &(vmalloc_caches[index]);
+
+    // one unsigned comparison catches both an empty cache and a full one
+    if(cache->count - 1 >= VMALLOC_CACHE_DEPTH - 1) {
+        // a thread only needs registering once one of its caches holds blocks
+        if(cache->count == 0 && !vmalloc_thread_registered) {
+            vmalloc_thread_register();
+        }
+
+        vmalloc_class_flush(index, cache, VMALLOC_CACHE_DEPTH / 2);
+    }
+
+    cache->blocks[cache->count] = block;
+    cache->count++;
+}
+
+int vmalloc_class_refill(uint32_t index, struct vmalloc_cache *cache) {
+    struct vmalloc_class *class = &(vmalloc_classes[index]);
+    void *block;
+    int res = 0;
+
+    res = fmutex_lock(&(class->mutex));
+    if(res != 0) {
+        return res;
+    }
+
+    // take several blocks at once so the next allocations do not need to lock
+    while(cache->count < VMALLOC_CACHE_DEPTH / 2) {
+        block = vpool_alloc(class->pool);
+        if(block == NULL) {
+            res = vmalloc_class_extend(class, index);
+            if(res != 0) {
+                break;
+            }
+            continue;
+        }
+
+        cache->blocks[cache->count] = block;
+        cache->count++;
+    }
+    fmutex_unlock(&(class->mutex));
+
+    // running out of memory after getting at least one block still counts as success
+    if(cache->count != 0) {
+        return 0;
+    }
+    return res;
+}
+
+void vmalloc_class_flush(uint32_t index, struct vmalloc_cache *cache, uint32_t keep) {
+    struct vmalloc_class *class = &(vmalloc_classes[index]);
+
+    if(cache->count <= keep) {
+        return;
+    }
+
+    if(fmutex_lock(&(class->mutex)) != 0) {
+        return;
+    }
+    while(cache->count > keep) {
+        cache->count--;
+        vpool_dealloc(class->pool, cache->blocks[cache->count]);
+    }
+    fmutex_unlock(&(class->mutex));
+}
+
+int vmalloc_class_extend(struct vmalloc_class *class, uint32_t index) {
+    void *chunk, *memory;
+    size_t memory_size, elem_size;
+    int res;
+
+    if(class == NULL || index >= VMALLOC_NUM_CLASSES) {
+        return EINVAL;
+    }
+
+    chunk = mmap(NULL, VMALLOC_CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(chunk == MAP_FAILED) {
+        return ENOMEM;
+    }
+
+    elem_size = vmalloc_class_size(index);
+    memory = pointer_literal_addition(chunk, VMALLOC_POOL_PADDING);
+    memory_size = VMALLOC_CHUNK_BYTES - VMALLOC_POOL_PADDING;
+    if(class->pool == NULL) {
+        class->pool = memory;
+        res = vpool_init(&(class->pool), memory, (memory_size - sizeof(Vpool)) / elem_size, elem_size, VPOOL_KIND_GUIDED);
+        if(res != 0) {
+            class->pool = NULL;
+        }
+    } else {
+        res = vpool_guided_extend(class->pool, memory, memory_size);
+    }
+
+    if(res != 0) {
+        munmap(chunk, VMALLOC_CHUNK_BYTES);
+        return res;
+    }
+    return 0;
+}
+
+void *vmalloc_large_alloc(size_t num_bytes) {
+    struct vmalloc_header *header;
+    size_t page_size, mapping_size;
+
+    page_size = (size_t) sysconf(_SC_PAGESIZE);
+    if(num_bytes > SIZE_MAX - sizeof(struct vmalloc_header) - page_size) {
+        return NULL;
+    }
+    mapping_size = (num_bytes + sizeof(struct vmalloc_header) + page_size - 1) & ~(page_size - 1);
+
+    header = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(header == MAP_FAILED) {
+        return NULL;
+    }
+    header->class_index = VMALLOC_CLASS_LARGE;
+    header->bytes = mapping_size;
+
+    return pointer_literal_addition(header, sizeof(struct vmalloc_header));
+}
+
+void *vmalloc_large_realloc(struct vmalloc_header *header, size_t num_bytes) {
+    struct vmalloc_header *moved;
+    size_t page_size, mapping_size;
+
+    page_size = (size_t) sysconf(_SC_PAGESIZE);
+    if(num_bytes > SIZE_MAX - sizeof(struct vmalloc_header) - page_size) {
+        return NULL;
+    }
+    mapping_size = (num_bytes + sizeof(struct vmalloc_header) + page_size - 1) & ~(page_size - 1);
+
+    // kernel moves page table entries rather than copying bytes
+    moved = mremap(header, header->bytes, mapping_size, MREMAP_MAYMOVE);
+    if(moved == MAP_FAILED) {
+        return NULL;
+    }
+    moved->bytes = mapping_size;
+
+    return pointer_literal_addition(moved, sizeof(struct vmalloc_header));
+}
+
+struct vmalloc_header *vmalloc_header_of(void *ptr) {
+    return (struct vmalloc_header *) (((char *) ptr) - sizeof(struct vmalloc_header));
+}
+
+void vmalloc_thread_key_create(void) {
+    pthread_key_create(&vmalloc_thread_key, vmalloc_thread_exit);
+
+    // size class mutexes are only ever locked by threads that registered
+    pthread_atfork(vmalloc_fork_prepare, vmalloc_fork_parent, vmalloc_fork_child);
+}
+
+void vmalloc_thread_register(void) {
+    vmalloc_thread_registered = true;
+    pthread_once(&vmalloc_thread_key_once, vmalloc_thread_key_create);
+
+    // destructor only called for non-NULL values
+    pthread_setspecific(vmalloc_thread_key, &vmalloc_thread_registered);
+}
+
+void vmalloc_thread_exit(void *arg) {
+    (void)(arg);
+
+    for(uint32_t i = 0; i < VMALLOC_NUM_CLASSES; i++) {
+        vmalloc_class_flush(i, &(vmalloc_caches[i]), 0);
+    }
+
+    // destructors for other keys may still free blocks into the caches
+    // registering again makes pthreads call this once more to flush them
+    vmalloc_thread_registered = false;
+}
+
+void vmalloc_fork_prepare(void) {
+    for(uint32_t i = 0; i < VMALLOC_NUM_CLASSES; i++) {
+        fmutex_lock(&(vmalloc_classes[i].mutex));
+    }
+}
+
+void vmalloc_fork_parent(void) {
+    for(uint32_t i = VMALLOC_NUM_CLASSES; i > 0; i--) {
+        fmutex_unlock(&(vmalloc_classes[i - 1].mutex));
+    }
+}
+
+void vmalloc_fork_child(void) {
+    // waiters recorded before fork do not exist in the child, so start again from unlocked mutexes
+    for(uint32_t i = 0; i < VMALLOC_NUM_CLASSES; i++) {
+        memset(&(vmalloc_classes[i].mutex), 0, sizeof(Fmutex));
+    }
+}
+
+void *vmalloc_alloc(size_t num_bytes) {
+    struct vmalloc_header *header;
+    uint32_t index;
+
+    if(num_bytes > VMALLOC_CLASS_MAX_BYTES - sizeof(struct vmalloc_header)) {
+        return vmalloc_large_alloc(num_bytes);
+    }
+
+    index = vmalloc_class_index(num_bytes + sizeof(struct vmalloc_header));
+    header = vmalloc_class_alloc(index);
+    if(header == NULL) {
+        return NULL;
+    }
+    header->class_index = index;
+    header->bytes = num_bytes;
+
+    return pointer_literal_addition(header, sizeof(struct vmalloc_header));
+}
+
+void *vmalloc_calloc(size_t num_items, size_t elem_size) {
+    size_t num_bytes;
+    void *ret;
+
+    if(__builtin_mul_overflow(num_items, elem_size, &num_bytes)) {
+        return NULL;
+    }
+
+    ret = vmalloc_alloc(num_bytes);
+    if(ret == NULL) {
+        return NULL;
+    }
+
+    // fresh mappings are already zeroed and touching them would commit every page
+    if(vmalloc_header_of(ret)->class_index != VMALLOC_CLASS_LARGE) {
+        memset(ret, 0, num_bytes);
+    }
+    return ret;
+}
+
+void *vmalloc_realloc(void *ptr, size_t num_bytes) {
+    struct vmalloc_header *header;
+    size_t usable;
+    void *ret;
+
+    if(ptr == NULL) {
+        return vmalloc_alloc(num_bytes);
+    }
+
+    if(num_bytes == 0) {
+        vmalloc_free(ptr);
+        return NULL;
+    }
+
+    header = vmalloc_header_of(ptr);
+    if(header->class_index == VMALLOC_CLASS_LARGE && num_bytes > VMALLOC_CLASS_MAX_BYTES - sizeof(struct vmalloc_header)) {
+        return vmalloc_large_realloc(header, num_bytes);
+    }
+
+    // keep using the same block unless more than half of it would be wasted
+    usable = vmalloc_usable(ptr);
+    if(num_bytes <= usable && num_bytes > usable / 2 && header->class_index != VMALLOC_CLASS_ALIGNED) {
+        if(header->class_index != VMALLOC_CLASS_LARGE) {
+            header->bytes = num_bytes;
+        }
+        return ptr;
+    }
+
+    ret = vmalloc_alloc(num_bytes);
+    if(ret == NULL) {
+        return NULL;
+    }
+    memcpy(ret, ptr, num_bytes < usable ? num_bytes : usable);
+    vmalloc_free(ptr);
+
+    return ret;
+}
+
+int vmalloc_aligned(void **dest, size_t alignment, size_t num_bytes) {
+    struct vmalloc_header *header;
+    void *allocated, *aligned;
+
+    if(dest == NULL || alignment == 0 || (alignment & (alignment - 1)) != 0 || (alignment % sizeof(void*)) != 0) {
+        return EINVAL;
+    }
+
+    if(alignment <= VMALLOC_ALIGNMENT) {
+        *dest = vmalloc_alloc(num_bytes);
+        return *dest == NULL ? ENOMEM : 0;
+    }
+
+    // leaves room for both the padding and a header directly before the aligned pointer
+    if(num_bytes > SIZE_MAX - alignment) {
+        return ENOMEM;
+    }
+    allocated = vmalloc_alloc(num_bytes + alignment);
+    if(allocated == NULL) {
+        return ENOMEM;
+    }
+
+    aligned = (void *) ((((uintptr_t) allocated) + sizeof(struct vmalloc_header) + alignment - 1) & ~((uintptr_t) alignment - 1));
+    header = vmalloc_header_of(aligned);
+    header->class_index = VMALLOC_CLASS_ALIGNED;
+    header->bytes = ((uintptr_t) aligned) - ((uintptr_t) allocated);
+
+    *dest = aligned;
+    return 0;
+}
+
+void vmalloc_free(void *ptr) {
+    struct vmalloc_header *header;
+
+    if(ptr == NULL) {
+        return;
+    }
+
+    header = vmalloc_header_of(ptr);
+    switch(header->class_index) {
+    case VMALLOC_CLASS_LARGE:
+        munmap(header, header->bytes);
+        break;
+    case VMALLOC_CLASS_ALIGNED:
+        vmalloc_free(((char *) ptr) - header->bytes);
+        break;
+    default:
+        vmalloc_class_free(header->class_index, header);
+        break;
+    }
+}
+
+size_t vmalloc_usable(void *ptr) {
+    struct vmalloc_header *header;
+
+    if(ptr == NULL) {
+        return 0;
+    }
+
+    header = vmalloc_header_of(ptr);
+    switch(header->class_index) {
+    case VMALLOC_CLASS_LARGE:
+        return header->bytes - sizeof(struct vmalloc_header);
+    case VMALLOC_CLASS_ALIGNED:
+        return vmalloc_usable(((char *) ptr) - header->bytes) - header->bytes;
+    default:
+        return vmalloc_class_size(header->class_index) - sizeof(struct vmalloc_header);
+    }
+}
+
+#ifdef VMALLOC_SHIM
+// Standard allocation functions exported when building libdert_malloc.so
+// glibc calls memalign, valloc, and pvalloc internally so all of them must come from the same allocator
+
+// The library is built with -fvisibility=hidden so calls between vmalloc functions skip the PLT and can be inlined
+// Only the standard functions below are exported
+#define VMALLOC_SHIM_EXPORT __attribute__((visibility("default")))
+
+VMALLOC_SHIM_EXPORT void *malloc(size_t size) {
+    void *ret = vmalloc_alloc(size);
+    if(ret == NULL) {
+        errno = ENOMEM;
+    }
+    return ret;
+}
+
+VMALLOC_SHIM_EXPORT void free(void *ptr) {
+    vmalloc_free(ptr);
+}
+
+VMALLOC_SHIM_EXPORT void *calloc(size_t nmemb, size_t size) {
+    void *ret = vmalloc_calloc(nmemb, size);
+    if(ret == NULL) {
+        errno = ENOMEM;
+    }
+    return ret;
+}
+
+VMALLOC_SHIM_EXPORT void *realloc(void *ptr, size_t size) {
+    void *ret = vmalloc_realloc(ptr, size);
+    if(ret == NULL && size != 0) {
+        errno = ENOMEM;
+    }
+    return ret;
+}
+
+VMALLOC_SHIM_EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    return vmalloc_aligned(memptr, alignment, size);
+}
+
+VMALLOC_SHIM_EXPORT void *aligned_alloc(size_t alignment, size_t size) {
+    void *ret = NULL;
+    int res;
+
+    // unlike posix_memalign small alignments are allowed
+    if(alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    res = vmalloc_aligned(&ret, alignment, size);
+    if(res != 0) {
+        errno = res;
+        return NULL;
+    }
+    return ret;
+}
+
+VMALLOC_SHIM_EXPORT void *memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+VMALLOC_SHIM_EXPORT void *valloc(size_t size) {
+    return aligned_alloc((size_t) sysconf(_SC_PAGESIZE), size);
+}
+
+VMALLOC_SHIM_EXPORT void *pvalloc(size_t size) {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    return aligned_alloc(page_size, (size + page_size - 1) & ~(page_size - 1));
+}
+
+VMALLOC_SHIM_EXPORT size_t malloc_usable_size(void *ptr) {
+    return vmalloc_usable(ptr);
+}
+#endif
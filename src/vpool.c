@@ -1,5 +1,6 @@
 #include <vpool.h>
 #include <vpool_priv.h>
+#include <vstats.h>
 #include <pointerarith.h>
 
 #include <stdbool.h>
@@ -82,6 +83,7 @@ int _vpool_init(Vpool **dest, void *memory, size_t num_items, size_t elem_size,
     pool->next_free = NULL;
     pool->kind = kind;
     pool->prev = prev;
+    VSTATS_RESERVE(&(pool->stats), 0, vpool_advise(num_items, elem_size));
 
     return 0;
 }
@@ -93,6 +95,9 @@ int vpool_deinit(Vpool *pool) {
         return 0;
     }
 
+    VSTATS_LIVE(&(pool->stats), pool->stats.live, 0);
+    VSTATS_RESERVE(&(pool->stats), pool->stats.reserved, 0);
+
     // DO NOT FREE THE FIRST VPOOL
     switch(pool->kind) {
     case VPOOL_KIND_DYNAMIC:
@@ -140,9 +145,11 @@ void *vpool_alloc(Vpool *pool) {
         allocated = pool->next_free;
         memcpy(&(pool->next_free), allocated, sizeof(void*));
         memset(allocated, 0, pool->element_size);
+        VSTATS_LIVE(&(pool->stats), 0, pool->element_size);
     } else if(vpool_full(pool)) {
         switch(pool->kind) {
-        case VPOOL_KIND_DYNAMIC:
+        case VPOOL_KIND_DYNAMIC: {
+            VSTATS_GROW_START(grow_start);
             new_pool = calloc(1, vpool_advise(2 * pool->capacity, pool->element_size));
             if(new_pool == NULL) {
                 return NULL;
@@ -156,9 +163,14 @@ void *vpool_alloc(Vpool *pool) {
             memcpy(&tmp, pool, sizeof(Vpool));
             memcpy(pool, new_pool, sizeof(Vpool));
             memcpy(new_pool, &tmp, sizeof(Vpool));
+#ifdef DERT_STATS
+            vstats_merge(&(pool->stats), &(new_pool->stats));
+#endif
+            VSTATS_GROW_END(&(pool->stats), grow_start);
 
             allocated = vpool_alloc(pool);
             break;
+        }
         case VPOOL_KIND_STATIC:
         case VPOOL_KIND_GUIDED:
         default:
@@ -172,6 +184,7 @@ void *vpool_alloc(Vpool *pool) {
         // pointer addition in this case scales by 1
         allocated = pointer_literal_addition(pool->items, pool->stored * pool->element_size);
         pool->stored++;
+        VSTATS_LIVE(&(pool->stats), 0, pool->element_size);
     }
 
     return allocated;
@@ -189,6 +202,7 @@ int vpool_dealloc(Vpool *pool, void *elem) {
         memcpy(elem, &(pool->next_free), sizeof(void*));
     }
     pool->next_free = elem;
+    VSTATS_LIVE(&(pool->stats), pool->element_size, 0);
 
     return 0;
 }
@@ -215,6 +229,23 @@ int vpool_guided_extend(Vpool *pool, void *memory, size_t memory_size) {
     memcpy(&tmp, pool, sizeof(Vpool));
     memcpy(pool, memory, sizeof(Vpool));
     memcpy(memory, &tmp, sizeof(Vpool));
+#ifdef DERT_STATS
+    vstats_merge(&(pool->stats), &(((Vpool *) memory)->stats));
+#endif
+
+    return 0;
+}
+
+int vpool_stats(Vpool *pool, Vstats *dest) {
+    if(pool == NULL || dest == NULL) {
+        return EINVAL;
+    }
 
+#ifdef DERT_STATS
+    memcpy(dest, &(pool->stats), sizeof(Vstats));
     return 0;
+#else
+    memset(dest, 0, sizeof(Vstats));
+    return ENOTSUP;
+#endif
 }
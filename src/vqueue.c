@@ -1,5 +1,6 @@
 #include <vqueue.h>
 #include <vqueue_priv.h>
+#include <vallocator.h>
 #include <pointerarith.h>
 
 #include <errno.h>
@@ -16,7 +17,7 @@ size_t vqueue_wrap(Vqueue *queue, size_t pos) {
     return pos % queue->cap;
 }
 
-Vqueue *vqueue_create(size_t elem_size, size_t num_elems) {
+Vqueue *vqueue_create(size_t elem_size, size_t num_elems, Vallocator *allocator) {
     void *memory;
     Vqueue *ret;
 
@@ -24,15 +25,16 @@ Vqueue *vqueue_create(size_t elem_size, size_t num_elems) {
         return NULL;
     }
 
-    memory = malloc(vqueue_advise(elem_size, num_elems));
+    memory = vallocator_alloc(allocator, vqueue_advise(elem_size, num_elems));
     if(memory == NULL) {
         return NULL;
     }
 
     if(vqueue_init(&ret, memory, elem_size, num_elems) != 0) {
-        free(memory);
+        vallocator_free(allocator, memory, vqueue_advise(elem_size, num_elems));
         return NULL;
     }
+    ret->allocator = allocator;
     return ret;
 }
 
@@ -112,12 +114,17 @@ void vqueue_deinit(Vqueue *queue) {
 }
 
 void vqueue_destroy(Vqueue *queue) {
+    Vallocator *allocator;
+    size_t num_bytes;
     if(queue == NULL) {
         return;
     }
 
+    // deinit clears everything needed to free queue
+    allocator = queue->allocator;
+    num_bytes = vqueue_advise(queue->elem_size, queue->cap);
     vqueue_deinit(queue);
-    free(queue);
+    vallocator_free(allocator, queue, num_bytes);
     return;
 }
 
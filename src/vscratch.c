@@ -0,0 +1,72 @@
+#include <vscratch.h>
+#include <vscratch_priv.h>
+#include <varena.h>
+
+#include <stddef.h>
+#include <pthread.h>
+
+static __thread Varena *vscratch_current = NULL;
+
+static pthread_once_t vscratch_thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t vscratch_thread_key;
+
+void vscratch_thread_key_create(void) {
+    pthread_key_create(&vscratch_thread_key, vscratch_thread_exit);
+}
+
+void vscratch_thread_exit(void *arg) {
+    Varena *arena = arg;
+
+    vscratch_current = NULL;
+    varena_destroy(&arena);
+}
+
+Varena *vscratch_arena(void) {
+    Varena *arena;
+
+    if(vscratch_current != NULL) {
+        return vscratch_current;
+    }
+
+    arena = varena_create(VSCRATCH_INITIAL_BYTES, VARENA_KIND_CHAINED);
+    if(arena == NULL) {
+        return NULL;
+    }
+
+    // destructor is handed the arena since thread local storage may already be gone
+    pthread_once(&vscratch_thread_key_once, vscratch_thread_key_create);
+    if(pthread_setspecific(vscratch_thread_key, arena) != 0) {
+        varena_destroy(&arena);
+        return NULL;
+    }
+
+    vscratch_current = arena;
+    return arena;
+}
+
+Varena *vscratch_begin(size_t num_bytes) {
+    Varena *arena;
+
+    arena = vscratch_arena();
+    if(arena == NULL) {
+        return NULL;
+    }
+
+    // empty frames are still frames so every begin has a matching end
+    if(num_bytes == 0) {
+        num_bytes = 1;
+    }
+
+    if(varena_claim(&arena, num_bytes) != 0) {
+        return NULL;
+    }
+    return arena;
+}
+
+void vscratch_end(Varena **arena_ptr) {
+    if(arena_ptr == NULL || *arena_ptr == NULL) {
+        return;
+    }
+
+    varena_disclaim(arena_ptr);
+}
@@ -0,0 +1,384 @@
+#include <vsoa.h>
+#include <vsoa_priv.h>
+#include <vallocator.h>
+#include <vstats.h>
+#include <pointerarith.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+size_t vsoa_advise(size_t num_columns) {
+    return sizeof(Vsoa) + (num_columns * sizeof(void *)) + (num_columns * sizeof(size_t));
+}
+
+Vsoa *vsoa_create(size_t num_columns, size_t column_sizes[], Vallocator *allocator) {
+    Vsoa *ret;
+    void *memory;
+
+    if(num_columns == 0 || num_columns > (SIZE_MAX - sizeof(Vsoa)) / (sizeof(void *) + sizeof(size_t))) {
+        return NULL;
+    }
+
+    memory = vallocator_alloc(allocator, vsoa_advise(num_columns));
+    if(memory == NULL) {
+        return NULL;
+    }
+
+    if(vsoa_init(&ret, memory, num_columns, column_sizes, allocator) != 0) {
+        vallocator_free(allocator, memory, vsoa_advise(num_columns));
+        return NULL;
+    }
+    return ret;
+}
+
+int vsoa_init(Vsoa **dest, void *memory, size_t num_columns, size_t column_sizes[], Vallocator *allocator) {
+    Vsoa *soa;
+
+    if(dest == NULL || memory == NULL || num_columns == 0 || column_sizes == NULL) {
+        return EINVAL;
+    }
+    for(size_t i = 0; i < num_columns; i++) {
+        if(column_sizes[i] == 0) {
+            return EINVAL;
+        }
+    }
+
+    soa = memory;
+    soa->columns = pointer_literal_addition(memory, sizeof(Vsoa));
+    soa->column_sizes = pointer_literal_addition(memory, sizeof(Vsoa) + (num_columns * sizeof(void *)));
+    for(size_t i = 0; i < num_columns; i++) {
+        soa->columns[i] = NULL;
+        soa->column_sizes[i] = column_sizes[i];
+    }
+    soa->num_columns = num_columns;
+    soa->stored = 0;
+    soa->cap = 0;
+    soa->allocator = allocator;
+#ifdef DERT_STATS
+    memset(&(soa->stats), 0, sizeof(Vstats));
+#endif
+
+    *dest = soa;
+    return 0;
+}
+
+void vsoa_deinit(Vsoa *soa) {
+    if(soa == NULL) {
+        return;
+    }
+
+    for(size_t i = 0; i < soa->num_columns; i++) {
+        vallocator_free(soa->allocator, soa->columns[i], soa->cap * soa->column_sizes[i]);
+        soa->columns[i] = NULL;
+    }
+    VSTATS_LIVE(&(soa->stats), soa->stored * vsoa_row_size(soa), 0);
+    VSTATS_RESERVE(&(soa->stats), soa->cap * vsoa_row_size(soa), 0);
+    soa->stored = 0;
+    soa->cap = 0;
+
+    return;
+}
+
+void vsoa_destroy(Vsoa *soa) {
+    Vallocator *allocator;
+    size_t num_bytes;
+    if(soa == NULL) {
+        return;
+    }
+
+    allocator = soa->allocator;
+    num_bytes = vsoa_advise(soa->num_columns);
+    vsoa_deinit(soa);
+    vallocator_free(allocator, soa, num_bytes);
+
+    return;
+}
+
+void *vsoa_column(Vsoa *soa, size_t column) {
+    if(soa == NULL || column >= soa->num_columns) {
+        return NULL;
+    }
+
+    return soa->columns[column];
+}
+
+void *vsoa_get_direct(Vsoa *soa, size_t row, size_t column) {
+    if(soa == NULL || column >= soa->num_columns || row >= soa->stored) {
+        return NULL;
+    }
+
+    return pointer_literal_addition(soa->columns[column], row * soa->column_sizes[column]);
+}
+
+int vsoa_get(Vsoa *soa, size_t row, size_t column, void *dest) {
+    void *src;
+    if(dest == NULL) {
+        return EINVAL;
+    }
+
+    src = vsoa_get_direct(soa, row, column);
+    if(src == NULL) {
+        return EINVAL;
+    }
+
+    memcpy(dest, src, soa->column_sizes[column]);
+    return 0;
+}
+
+int vsoa_set(Vsoa *soa, size_t row, size_t column, void *src) {
+    void *dest;
+    if(src == NULL) {
+        return EINVAL;
+    }
+
+    dest = vsoa_get_direct(soa, row, column);
+    if(dest == NULL) {
+        return EINVAL;
+    }
+
+    memcpy(dest, src, soa->column_sizes[column]);
+    return 0;
+}
+
+int vsoa_row_get(Vsoa *soa, size_t row, void *dest[]) {
+    if(soa == NULL || dest == NULL || row >= soa->stored) {
+        return EINVAL;
+    }
+
+    for(size_t i = 0; i < soa->num_columns; i++) {
+        if(dest[i] != NULL) {
+            memcpy(dest[i], pointer_literal_addition(soa->columns[i], row * soa->column_sizes[i]), soa->column_sizes[i]);
+        }
+    }
+    return 0;
+}
+
+int vsoa_row_set(Vsoa *soa, size_t row, void *src[]) {
+    if(soa == NULL || src == NULL || row >= soa->stored) {
+        return EINVAL;
+    }
+
+    for(size_t i = 0; i < soa->num_columns; i++) {
+        if(src[i] != NULL) {
+            memcpy(pointer_literal_addition(soa->columns[i], row * soa->column_sizes[i]), src[i], soa->column_sizes[i]);
+        }
+    }
+    return 0;
+}
+
+int vsoa_push(Vsoa *soa, void *src[]) {
+    void *elem;
+    int res;
+
+    if(soa == NULL || src == NULL) {
+        return EINVAL;
+    }
+
+    if(soa->stored == soa->cap) {
+        if(soa->stored == SIZE_MAX) {
+            return ENOMEM;
+        }
+        res = vsoa_cap_set(soa, vsoa_cap_next(soa, soa->stored + 1));
+        if(res != 0) {
+            return res;
+        }
+    }
+
+    for(size_t i = 0; i < soa->num_columns; i++) {
+        elem = pointer_literal_addition(soa->columns[i], soa->stored * soa->column_sizes[i]);
+        if(src[i] == NULL) {
+            memset(elem, 0, soa->column_sizes[i]);
+        } else {
+            memcpy(elem, src[i], soa->column_sizes[i]);
+        }
+    }
+    VSTATS_LIVE(&(soa->stats), soa->stored * vsoa_row_size(soa), (soa->stored + 1) * vsoa_row_size(soa));
+    soa->stored++;
+    return 0;
+}
+
+int vsoa_pop(Vsoa *soa, void *dest[]) {
+    if(soa == NULL || soa->stored == 0) {
+        return EINVAL;
+    }
+
+    if(dest != NULL) {
+        vsoa_row_get(soa, soa->stored - 1, dest);
+    }
+    VSTATS_LIVE(&(soa->stats), soa->stored * vsoa_row_size(soa), (soa->stored - 1) * vsoa_row_size(soa));
+    soa->stored--;
+    return 0;
+}
+
+int vsoa_resize(Vsoa *soa, size_t new_size) {
+    size_t cleared;
+    int res;
+
+    if(soa == NULL) {
+        return EINVAL;
+    }
+
+    // rows past the end keep old values, clear them so growing again gives zeroed rows
+    // vsoa_cap_set already clears rows past the old capacity
+    cleared = (new_size < soa->cap) ? new_size : soa->cap;
+    for(size_t i = 0; cleared > soa->stored && i < soa->num_columns; i++) {
+        memset(pointer_literal_addition(soa->columns[i], soa->stored * soa->column_sizes[i]), 0,
+               (cleared - soa->stored) * soa->column_sizes[i]);
+    }
+
+    if(new_size > soa->cap) {
+        res = vsoa_cap_set(soa, vsoa_cap_next(soa, new_size));
+        if(res != 0) {
+            return res;
+        }
+    }
+
+    VSTATS_LIVE(&(soa->stats), soa->stored * vsoa_row_size(soa), new_size * vsoa_row_size(soa));
+    soa->stored = new_size;
+    return 0;
+}
+
+int vsoa_reserve(Vsoa *soa, size_t num_rows) {
+    if(soa == NULL) {
+        return EINVAL;
+    }
+
+    if(num_rows <= soa->cap) {
+        return 0;
+    }
+
+    return vsoa_cap_set(soa, num_rows);
+}
+
+int vsoa_shrink_to_fit(Vsoa *soa) {
+    if(soa == NULL) {
+        return EINVAL;
+    }
+
+    return vsoa_cap_set(soa, soa->stored);
+}
+
+size_t vsoa_len(Vsoa *soa) {
+    if(soa == NULL) {
+        return 0;
+    }
+
+    return soa->stored;
+}
+
+size_t vsoa_cap(Vsoa *soa) {
+    if(soa == NULL) {
+        return 0;
+    }
+
+    return soa->cap;
+}
+
+size_t vsoa_num_columns(Vsoa *soa) {
+    if(soa == NULL) {
+        return 0;
+    }
+
+    return soa->num_columns;
+}
+
+int vsoa_stats(Vsoa *soa, Vstats *dest) {
+    if(soa == NULL || dest == NULL) {
+        return EINVAL;
+    }
+
+#ifdef DERT_STATS
+    memcpy(dest, &(soa->stats), sizeof(Vstats));
+    return 0;
+#else
+    memset(dest, 0, sizeof(Vstats));
+    return ENOTSUP;
+#endif
+}
+
+size_t vsoa_row_size(Vsoa *soa) {
+    size_t total = 0;
+
+    for(size_t i = 0; i < soa->num_columns; i++) {
+        total += soa->column_sizes[i];
+    }
+    return total;
+}
+
+size_t vsoa_cap_next(Vsoa *soa, size_t num_rows) {
+    size_t new_cap = soa->cap < VSOA_MIN_CAP ? VSOA_MIN_CAP : soa->cap;
+
+    while(new_cap < num_rows) {
+        if(new_cap > SIZE_MAX / 2) {
+            return num_rows;
+        }
+        new_cap <<= 1;
+    }
+    return new_cap;
+}
+
+int vsoa_cap_set(Vsoa *soa, size_t new_cap) {
+    void *new_column;
+    size_t elem_size, i;
+
+    if(new_cap == soa->cap) {
+        return 0;
+    }
+    for(i = 0; i < soa->num_columns; i++) {
+        if(new_cap > SIZE_MAX / soa->column_sizes[i]) {
+            return ENOMEM;
+        }
+    }
+
+    VSTATS_GROW_START(grow_start);
+    for(i = 0; i < soa->num_columns; i++) {
+        elem_size = soa->column_sizes[i];
+        if(new_cap == 0) {
+            vallocator_free(soa->allocator, soa->columns[i], soa->cap * elem_size);
+            soa->columns[i] = NULL;
+            continue;
+        }
+
+        new_column = vallocator_realloc(soa->allocator, soa->columns[i], soa->cap * elem_size, new_cap * elem_size);
+        if(new_column == NULL) {
+            goto vsoa_cap_set_error;
+        }
+        soa->columns[i] = new_column;
+        if(new_cap > soa->cap && !vallocator_grows_zeroed(soa->allocator, new_cap * elem_size)) {
+            memset(pointer_literal_addition(new_column, soa->cap * elem_size), 0, (new_cap - soa->cap) * elem_size);
+        }
+    }
+    VSTATS_RESERVE(&(soa->stats), soa->cap * vsoa_row_size(soa), new_cap * vsoa_row_size(soa));
+
+    if(new_cap > soa->cap) {
+        VSTATS_GROW_END(&(soa->stats), grow_start);
+    } else if(new_cap < soa->stored) {
+        VSTATS_LIVE(&(soa->stats), soa->stored * vsoa_row_size(soa), new_cap * vsoa_row_size(soa));
+        soa->stored = new_cap;
+    }
+    soa->cap = new_cap;
+    return 0;
+
+vsoa_cap_set_error:
+    // give columns that were already resized their previous capacity back so they all agree
+    while(i > 0) {
+        i--;
+        elem_size = soa->column_sizes[i];
+
+        // shrinking to nothing is a free, some allocators would free the column and return NULL
+        if(soa->cap == 0) {
+            vallocator_free(soa->allocator, soa->columns[i], new_cap * elem_size);
+            soa->columns[i] = NULL;
+            continue;
+        }
+
+        new_column = vallocator_realloc(soa->allocator, soa->columns[i], new_cap * elem_size, soa->cap * elem_size);
+        if(new_column != NULL) {
+            soa->columns[i] = new_column;
+        }
+    }
+    return ENOMEM;
+}
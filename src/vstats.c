@@ -0,0 +1,150 @@
+#include <vstats.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+
+// Shared by every container, only ever updated using relaxed atomics
+static struct {
+    _Atomic size_t reserved;
+    _Atomic size_t reserved_peak;
+    _Atomic size_t live;
+    _Atomic size_t live_peak;
+    _Atomic size_t allocs;
+    _Atomic size_t frees;
+    _Atomic size_t grows;
+    _Atomic uint64_t grow_ns;
+} vstats_totals = { 0 };
+
+// Raise *peak to at least value
+static void vstats_peak_raise(_Atomic size_t *peak, size_t value) {
+    size_t expected = atomic_load_explicit(peak, memory_order_relaxed);
+
+    while(expected < value && !atomic_compare_exchange_weak_explicit(peak, &expected, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+uint64_t vstats_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (((uint64_t) now.tv_sec) * 1000000000) + ((uint64_t) now.tv_nsec);
+}
+
+void vstats_reserve(Vstats *stats, size_t old_bytes, size_t new_bytes) {
+    size_t total;
+
+    if(old_bytes == 0 && new_bytes != 0) {
+        atomic_fetch_add_explicit(&(vstats_totals.allocs), 1, memory_order_relaxed);
+    } else if(old_bytes != 0 && new_bytes == 0) {
+        atomic_fetch_add_explicit(&(vstats_totals.frees), 1, memory_order_relaxed);
+    }
+
+    if(new_bytes >= old_bytes) {
+        total = atomic_fetch_add_explicit(&(vstats_totals.reserved), new_bytes - old_bytes, memory_order_relaxed) + (new_bytes - old_bytes);
+        vstats_peak_raise(&(vstats_totals.reserved_peak), total);
+    } else {
+        atomic_fetch_sub_explicit(&(vstats_totals.reserved), old_bytes - new_bytes, memory_order_relaxed);
+    }
+
+    if(stats == NULL) {
+        return;
+    }
+
+    if(old_bytes == 0 && new_bytes != 0) {
+        stats->allocs++;
+    } else if(old_bytes != 0 && new_bytes == 0) {
+        stats->frees++;
+    }
+    stats->reserved = stats->reserved - old_bytes + new_bytes;
+    if(stats->reserved > stats->reserved_peak) {
+        stats->reserved_peak = stats->reserved;
+    }
+}
+
+void vstats_live(Vstats *stats, size_t old_bytes, size_t new_bytes) {
+    size_t total;
+
+    if(new_bytes >= old_bytes) {
+        total = atomic_fetch_add_explicit(&(vstats_totals.live), new_bytes - old_bytes, memory_order_relaxed) + (new_bytes - old_bytes);
+        vstats_peak_raise(&(vstats_totals.live_peak), total);
+    } else {
+        atomic_fetch_sub_explicit(&(vstats_totals.live), old_bytes - new_bytes, memory_order_relaxed);
+    }
+
+    if(stats == NULL) {
+        return;
+    }
+
+    stats->live = stats->live - old_bytes + new_bytes;
+    if(stats->live > stats->live_peak) {
+        stats->live_peak = stats->live;
+    }
+}
+
+void vstats_grow(Vstats *stats, uint64_t start_ns) {
+    uint64_t elapsed = vstats_now() - start_ns;
+
+    atomic_fetch_add_explicit(&(vstats_totals.grows), 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&(vstats_totals.grow_ns), elapsed, memory_order_relaxed);
+    if(stats == NULL) {
+        return;
+    }
+
+    stats->grows++;
+    stats->grow_ns += elapsed;
+}
+
+void vstats_merge(Vstats *dest, Vstats *src) {
+    if(dest == NULL || src == NULL) {
+        return;
+    }
+
+    dest->reserved += src->reserved;
+    dest->live += src->live;
+    dest->reserved_peak = dest->reserved_peak > src->reserved_peak ? dest->reserved_peak : src->reserved_peak;
+    if(dest->reserved > dest->reserved_peak) {
+        dest->reserved_peak = dest->reserved;
+    }
+    dest->live_peak = dest->live_peak > src->live_peak ? dest->live_peak : src->live_peak;
+    if(dest->live > dest->live_peak) {
+        dest->live_peak = dest->live;
+    }
+    dest->allocs += src->allocs;
+    dest->frees += src->frees;
+    dest->grows += src->grows;
+    dest->grow_ns += src->grow_ns;
+}
+
+int vstats_global(Vstats *dest) {
+    if(dest == NULL) {
+        return EINVAL;
+    }
+
+#ifdef DERT_STATS
+    dest->reserved = atomic_load_explicit(&(vstats_totals.reserved), memory_order_relaxed);
+    dest->reserved_peak = atomic_load_explicit(&(vstats_totals.reserved_peak), memory_order_relaxed);
+    dest->live = atomic_load_explicit(&(vstats_totals.live), memory_order_relaxed);
+    dest->live_peak = atomic_load_explicit(&(vstats_totals.live_peak), memory_order_relaxed);
+    dest->allocs = atomic_load_explicit(&(vstats_totals.allocs), memory_order_relaxed);
+    dest->frees = atomic_load_explicit(&(vstats_totals.frees), memory_order_relaxed);
+    dest->grows = atomic_load_explicit(&(vstats_totals.grows), memory_order_relaxed);
+    dest->grow_ns = atomic_load_explicit(&(vstats_totals.grow_ns), memory_order_relaxed);
+    return 0;
+#else
+    memset(dest, 0, sizeof(Vstats));
+    return ENOTSUP;
+#endif
+}
+
+void vstats_global_reset(void) {
+    atomic_store_explicit(&(vstats_totals.allocs), 0, memory_order_relaxed);
+    atomic_store_explicit(&(vstats_totals.frees), 0, memory_order_relaxed);
+    atomic_store_explicit(&(vstats_totals.grows), 0, memory_order_relaxed);
+    atomic_store_explicit(&(vstats_totals.grow_ns), 0, memory_order_relaxed);
+    atomic_store_explicit(&(vstats_totals.reserved_peak), atomic_load_explicit(&(vstats_totals.reserved), memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit(&(vstats_totals.live_peak), atomic_load_explicit(&(vstats_totals.live), memory_order_relaxed), memory_order_relaxed);
+}